@@ -26,6 +26,7 @@
 #undef ID3_ENABLE_DEBUG
 #undef ID3_DISABLE_ASSERT
 #undef ID3_DISABLE_CHECKS
+#undef ID3_ENABLE_STATS
 #undef ID3_ICONV_FORMAT_UTF16BE
 #undef ID3_ICONV_FORMAT_UTF16
 #undef ID3_ICONV_FORMAT_UTF8
@@ -0,0 +1,147 @@
+// -*- C++ -*-
+// $Id$
+
+// The benchmark harness shared by bench_micro and bench_macro.  Each case
+// prints one line:
+//
+//   <name> <iterations> <ns per iteration> <bytes per iteration>
+//
+// separated by tabs, after a header line starting with '#'.  The names are
+// stable from release to release, so that the results can be compared.
+
+#ifndef _ID3LIB_BENCH_H_
+#define _ID3LIB_BENCH_H_
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "id3/globals.h"
+
+namespace bench
+{
+  inline uint64 now()
+  {
+#if defined HAVE_CLOCK_GETTIME
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#else
+    return static_cast<uint64>(::clock()) * (1000000000 / CLOCKS_PER_SEC);
+#endif
+  }
+
+  // One benchmark.  run() does one iteration and returns the bytes it went
+  // through.  A case constructed with reset = true has reset() called before
+  // each iteration, outside of the time measured; the others are timed over
+  // all their iterations at once.
+  class Case
+  {
+    const char* _name;
+    bool _reset;
+  public:
+    Case(const char* name, bool reset = false) : _name(name), _reset(reset) { }
+    virtual ~Case() { }
+
+    const char* name() const { return _name; }
+    bool resets() const { return _reset; }
+
+    virtual void reset() { }
+    virtual size_t run() = 0;
+  };
+
+  class Runner
+  {
+    double _seconds;       // least time spent on each case
+    const char* _filter;   // only run the cases whose name starts with this
+    size_t _maxIterations;
+  public:
+    // -t <seconds>, -f <name prefix> and -n <most iterations>; the other
+    // arguments are left in argv, and their number returned in argc
+    Runner(int& argc, char** argv)
+      : _seconds(0.5), _filter(NULL), _maxIterations(0)
+    {
+      int kept = 1;
+      for (int i = 1; i < argc; ++i)
+      {
+        if (::strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+        {
+          _seconds = ::atof(argv[++i]);
+        }
+        else if (::strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+        {
+          _filter = argv[++i];
+        }
+        else if (::strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+        {
+          _maxIterations = ::atol(argv[++i]);
+        }
+        else
+        {
+          argv[kept++] = argv[i];
+        }
+      }
+      argc = kept;
+      ::printf("# name\titerations\tns_per_iter\tbytes_per_iter\n");
+    }
+
+    bool wanted(const char* name) const
+    {
+      return _filter == NULL || ::strncmp(name, _filter, ::strlen(_filter)) == 0;
+    }
+
+    // Runs the case for at least the time asked for, doubling the number of
+    // iterations from one, and prints its line
+    void run(Case& c)
+    {
+      if (!this->wanted(c.name()))
+      {
+        return;
+      }
+      const uint64 least = static_cast<uint64>(_seconds * 1e9);
+      size_t iterations = 0;
+      uint64 nanos = 0;
+      size_t bytes = 0;
+      for (size_t batch = 1; nanos < least || iterations == 0; batch *= 2)
+      {
+        if (_maxIterations && iterations + batch > _maxIterations)
+        {
+          batch = _maxIterations - iterations;
+        }
+        if (c.resets())
+        {
+          for (size_t i = 0; i < batch; ++i)
+          {
+            c.reset();
+            const uint64 beg = now();
+            bytes = c.run();
+            nanos += now() - beg;
+          }
+        }
+        else
+        {
+          const uint64 beg = now();
+          for (size_t i = 0; i < batch; ++i)
+          {
+            bytes = c.run();
+          }
+          nanos += now() - beg;
+        }
+        iterations += batch;
+        if (_maxIterations && iterations >= _maxIterations)
+        {
+          break;
+        }
+      }
+      ::printf("%s\t%lu\t%.1f\t%lu\n", c.name(), (unsigned long) iterations,
+               static_cast<double>(nanos) / iterations, (unsigned long) bytes);
+      ::fflush(stdout);
+    }
+  };
+}
+
+#endif /* _ID3LIB_BENCH_H_ */
@@ -0,0 +1,257 @@
+// $Id$
+
+// Macrobenchmarks: Link(), Update() in place and with the file rewritten,
+// and Strip(), on files.  The corpus is the .mp3 and .tag files under a
+// directory, the examples directory unless another is given, such as one
+// written by gen_corpus; next to it, files made here of a small and a large
+// tag.
+//
+//   bench_macro [-t seconds] [-f name prefix] [-n most iterations]
+//               [corpus directory] [work directory]
+
+#include <vector>
+#include "bench.h"
+
+#include "id3/tag.h"
+#include "id3/dir_walker.h"
+#include "id3/misc_support.h"
+#include "id3/id3lib_strings.h"
+
+using namespace dami;
+
+namespace
+{
+  size_t fileSize(const char* name)
+  {
+    FILE* f = ::fopen(name, "rb");
+    if (f == NULL)
+    {
+      return 0;
+    }
+    ::fseek(f, 0, SEEK_END);
+    const long size = ::ftell(f);
+    ::fclose(f);
+    return size > 0 ? size : 0;
+  }
+
+  bool copyFile(const String& from, const String& to)
+  {
+    FILE* in = ::fopen(from.c_str(), "rb");
+    if (in == NULL)
+    {
+      return false;
+    }
+    FILE* out = ::fopen(to.c_str(), "wb");
+    if (out == NULL)
+    {
+      ::fclose(in);
+      return false;
+    }
+    char buf[64 * 1024];
+    size_t n;
+    while ((n = ::fread(buf, 1, sizeof(buf), in)) > 0)
+    {
+      ::fwrite(buf, 1, n, out);
+    }
+    ::fclose(in);
+    return ::fclose(out) == 0;
+  }
+
+  // count mpeg 1 layer III frames at 128 kbit/s and 44.1 kHz, then the tags
+  bool makeFile(const String& name, size_t frames, size_t comments,
+                size_t pictureSize)
+  {
+    FILE* f = ::fopen(name.c_str(), "wb");
+    if (f == NULL)
+    {
+      return false;
+    }
+    BString frame(417, 0x55);
+    frame[0] = 0xFF;
+    frame[1] = 0xFB;
+    frame[2] = 0x90;
+    frame[3] = 0x00;
+    for (size_t i = 0; i < frames; ++i)
+    {
+      ::fwrite(frame.data(), 1, frame.size(), f);
+    }
+    ::fclose(f);
+
+    ID3_Tag tag(name.c_str());
+    ID3_AddTitle(&tag, "A title of a reasonable length", true);
+    ID3_AddArtist(&tag, "Some artist", true);
+    ID3_AddAlbum(&tag, "Some album", true);
+    ID3_AddTrack(&tag, 7, 12, true);
+    for (size_t i = 0; i < comments; ++i)
+    {
+      char desc[32];
+      ::sprintf(desc, "comment %u", (unsigned) i);
+      ID3_AddComment(&tag, "Some text of a comment", desc, "eng");
+    }
+    if (pictureSize > 0)
+    {
+      BString picture(pictureSize, 0x33);
+      ID3_Frame* apic = new ID3_Frame(ID3FID_PICTURE);
+      apic->GetField(ID3FN_DATA)->Set(picture.data(), picture.size());
+      tag.AttachFrame(apic);
+    }
+    return tag.Update(ID3TT_ID3V2 | ID3TT_ID3V1) != ID3TT_NONE;
+  }
+
+  class Link : public bench::Case
+  {
+    const std::vector<String>& _files;
+    size_t _bytes;
+  public:
+    Link(const char* name, const std::vector<String>& files)
+      : Case(name), _files(files), _bytes(0)
+    {
+      for (size_t i = 0; i < _files.size(); ++i)
+      {
+        _bytes += fileSize(_files[i].c_str());
+      }
+    }
+    size_t run()
+    {
+      for (size_t i = 0; i < _files.size(); ++i)
+      {
+        ID3_Tag tag;
+        tag.Link(_files[i].c_str());
+      }
+      return _bytes;
+    }
+  };
+
+  // changes the title to one as long, so that the tag is written over the
+  // old one
+  class UpdateInPlace : public bench::Case
+  {
+    ID3_Tag _tag;
+    size_t _count;
+  public:
+    UpdateInPlace(const char* name, const String& file)
+      : Case(name), _tag(file.c_str()), _count(0) { }
+    size_t run()
+    {
+      ID3_AddTitle(&_tag, (++_count % 2) ? "A title of a reasonable length"
+                                         : "Another title, just as long.  ",
+                   true);
+      _tag.Update(ID3TT_ID3V2);
+      return _tag.GetPrependedBytes();
+    }
+  };
+
+  // adds a frame larger than the padding to a fresh copy of the file, so
+  // that the audio has to be moved
+  class UpdateRewrite : public bench::Case
+  {
+    String _original, _copy;
+    ID3_Tag* _tag;
+  public:
+    UpdateRewrite(const char* name, const String& original, const String& copy)
+      : Case(name, true), _original(original), _copy(copy), _tag(NULL) { }
+    ~UpdateRewrite() { delete _tag; }
+    void reset()
+    {
+      delete _tag;
+      copyFile(_original, _copy);
+      _tag = new ID3_Tag(_copy.c_str());
+      BString data(8 * 1024, 0x44);
+      ID3_Frame* frame = new ID3_Frame(ID3FID_GENERALOBJECT);
+      frame->GetField(ID3FN_DATA)->Set(data.data(), data.size());
+      _tag->AttachFrame(frame);
+    }
+    size_t run()
+    {
+      _tag->Update(ID3TT_ID3V2);
+      return _tag->GetFileSize();
+    }
+  };
+
+  class Strip : public bench::Case
+  {
+    String _original, _copy;
+    ID3_Tag* _tag;
+  public:
+    Strip(const char* name, const String& original, const String& copy)
+      : Case(name, true), _original(original), _copy(copy), _tag(NULL) { }
+    ~Strip() { delete _tag; }
+    void reset()
+    {
+      delete _tag;
+      copyFile(_original, _copy);
+      _tag = new ID3_Tag(_copy.c_str());
+    }
+    size_t run()
+    {
+      const size_t size = _tag->GetFileSize();
+      _tag->Strip(ID3TT_ALL);
+      return size;
+    }
+  };
+}
+
+int main(int argc, char** argv)
+{
+  bench::Runner runner(argc, argv);
+  const String examples = (argc > 1) ? argv[1] : "../examples";
+  const String work = (argc > 2) ? argv[2] : ".";
+
+  std::vector<String> corpus;
+  ID3_DirWalker walker;
+  walker.AddExtension("mp3");
+  walker.AddExtension("tag");
+  walker.Walk(examples.c_str());
+  for (size_t i = 0; i < walker.NumFiles(); ++i)
+  {
+    corpus.push_back(walker.GetFileName(i));
+  }
+  if (corpus.empty())
+  {
+    ::fprintf(stderr, "no .mp3 or .tag files in %s\n", examples.c_str());
+    return 1;
+  }
+
+  const String small = work + "/bench-small.mp3";
+  const String large = work + "/bench-large.mp3";
+  const String copy = work + "/bench-copy.mp3";
+  if (!makeFile(small, 500, 4, 0) || !makeFile(large, 2500, 200, 512 * 1024))
+  {
+    ::fprintf(stderr, "couldn't write to %s\n", work.c_str());
+    return 1;
+  }
+
+  Link linkCorpus("link.corpus", corpus);
+  runner.run(linkCorpus);
+  std::vector<String> smallFile(1, small), largeFile(1, large);
+  Link linkSmall("link.synthetic.small", smallFile);
+  runner.run(linkSmall);
+  Link linkLarge("link.synthetic.large", largeFile);
+  runner.run(linkLarge);
+
+  copyFile(small, copy);
+  {
+    UpdateInPlace updateInPlace("update.inplace.small", copy);
+    runner.run(updateInPlace);
+  }
+  copyFile(large, copy);
+  {
+    UpdateInPlace updateInPlace("update.inplace.large", copy);
+    runner.run(updateInPlace);
+  }
+
+  UpdateRewrite rewriteSmall("update.rewrite.small", small, copy);
+  runner.run(rewriteSmall);
+  UpdateRewrite rewriteLarge("update.rewrite.large", large, copy);
+  runner.run(rewriteLarge);
+
+  Strip stripSmall("strip.small", small, copy);
+  runner.run(stripSmall);
+  Strip stripLarge("strip.large", large, copy);
+  runner.run(stripLarge);
+
+  ::remove(small.c_str());
+  ::remove(large.c_str());
+  ::remove(copy.c_str());
+  return 0;
+}
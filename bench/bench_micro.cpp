@@ -0,0 +1,341 @@
+// $Id$
+
+// Microbenchmarks: the readers and decorators, text conversion, finding
+// frames, rendering and parsing a tag in memory.
+//
+//   bench_micro [-t seconds] [-f name prefix] [-n most iterations]
+
+#include "bench.h"
+
+#include <zlib.h>
+#include "id3/tag.h"
+#include "id3/readers.h"
+#include "id3/writers.h"
+#include "id3/io_decorators.h"
+#include "id3/misc_support.h"
+#include "id3/id3lib_strings.h"
+
+using namespace dami;
+
+namespace
+{
+  const size_t BUFFER_SIZE = 64 * 1024;
+
+  // bytes that look like audio, with the odd false sync for the unsync code
+  BString audioBytes(size_t size)
+  {
+    BString data(size, '\0');
+    uint32 seed = 12345;
+    for (size_t i = 0; i < size; ++i)
+    {
+      seed = seed * 1103515245 + 12345;
+      data[i] = static_cast<uchar>(seed >> 16);
+    }
+    return data;
+  }
+
+  BString unsyncBytes(const BString& data)
+  {
+    BString unsynced;
+    unsynced.reserve(data.size() + data.size() / 128);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+      unsynced += data[i];
+      if (data[i] == 0xFF && (i + 1 == data.size() || data[i + 1] == 0x00 ||
+                              data[i + 1] >= 0xE0))
+      {
+        unsynced += static_cast<uchar>(0x00);
+      }
+    }
+    return unsynced;
+  }
+
+  class ReadChar : public bench::Case
+  {
+  protected:
+    const BString& _data;
+  public:
+    ReadChar(const char* name, const BString& data)
+      : Case(name), _data(data) { }
+
+    size_t drain(ID3_Reader& reader)
+    {
+      size_t sum = 0;
+      while (!reader.atEnd())
+      {
+        sum += reader.readChar();
+      }
+      return sum;
+    }
+
+    size_t run()
+    {
+      ID3_MemoryReader mr(_data.data(), _data.size());
+      drain(mr);
+      return _data.size();
+    }
+  };
+
+  class WindowedReadChar : public ReadChar
+  {
+  public:
+    WindowedReadChar(const BString& data)
+      : ReadChar("reader.windowed.readchar", data) { }
+    size_t run()
+    {
+      ID3_MemoryReader mr(_data.data(), _data.size());
+      io::WindowedReader wr(mr, 0, _data.size());
+      drain(wr);
+      return _data.size();
+    }
+  };
+
+  class WindowedReadChars : public ReadChar
+  {
+    size_t _chunk;
+  public:
+    WindowedReadChars(const char* name, const BString& data, size_t chunk)
+      : ReadChar(name, data), _chunk(chunk) { }
+    size_t run()
+    {
+      ID3_MemoryReader mr(_data.data(), _data.size());
+      io::WindowedReader wr(mr, 0, _data.size());
+      uchar buf[4096];
+      while (wr.readChars(buf, _chunk) > 0)
+      {
+        ;
+      }
+      return _data.size();
+    }
+  };
+
+  class UnsyncedReadChar : public ReadChar
+  {
+  public:
+    UnsyncedReadChar(const BString& unsynced)
+      : ReadChar("reader.unsynced.readchar", unsynced) { }
+    size_t run()
+    {
+      ID3_MemoryReader mr(_data.data(), _data.size());
+      io::UnsyncedReader ur(mr);
+      drain(ur);
+      return _data.size();
+    }
+  };
+
+  class UnsyncedReadChars : public ReadChar
+  {
+  public:
+    UnsyncedReadChars(const BString& unsynced)
+      : ReadChar("reader.unsynced.readchars", unsynced) { }
+    size_t run()
+    {
+      ID3_MemoryReader mr(_data.data(), _data.size());
+      io::UnsyncedReader ur(mr);
+      uchar buf[1024];
+      while (ur.readChars(buf, sizeof(buf)) > 0)
+      {
+        ;
+      }
+      return _data.size();
+    }
+  };
+
+  class CompressedRead : public bench::Case
+  {
+    BString _compressed;
+    size_t _size;
+  public:
+    CompressedRead(const BString& data)
+      : Case("reader.compressed.inflate"), _size(data.size())
+    {
+      uLongf size = compressBound(data.size());
+      _compressed.resize(size);
+      ::compress(&_compressed[0], &size, data.data(), data.size());
+      _compressed.resize(size);
+    }
+    size_t run()
+    {
+      ID3_MemoryReader mr(_compressed.data(), _compressed.size());
+      io::CompressedReader cr(mr, _size);
+      return _size;
+    }
+  };
+
+  class Convert : public bench::Case
+  {
+    String _text;
+    ID3_TextEnc _from, _to;
+  public:
+    Convert(const char* name, const String& text, ID3_TextEnc from,
+            ID3_TextEnc to)
+      : Case(name), _text(text), _from(from), _to(to) { }
+    size_t run()
+    {
+      return convert(_text, _from, _to).size() ? _text.size() : 0;
+    }
+  };
+
+  // a tag of many text frames and comments, the last of them the one found
+  class Find : public bench::Case
+  {
+    ID3_Tag& _tag;
+    int _kind;
+  public:
+    enum { BY_ID, BY_TEXT, BY_NUMBER };
+    Find(const char* name, ID3_Tag& tag, int kind)
+      : Case(name), _tag(tag), _kind(kind) { }
+    size_t run()
+    {
+      const ID3_Frame* frame = NULL;
+      switch (_kind)
+      {
+        case BY_ID:
+          frame = _tag.Find(ID3FID_BAND);
+          break;
+        case BY_TEXT:
+          frame = _tag.Find(ID3FID_COMMENT, ID3FN_DESCRIPTION, "comment 199");
+          break;
+        default:
+          frame = _tag.Find(ID3FID_PLAYCOUNTER, ID3FN_COUNTER, 42);
+          break;
+      }
+      return frame != NULL ? 1 : 0;
+    }
+  };
+
+  class Render : public bench::Case
+  {
+    ID3_Tag& _tag;
+    BString _buffer;
+  public:
+    Render(const char* name, ID3_Tag& tag)
+      : Case(name), _tag(tag), _buffer(tag.Size() + 1024, '\0') { }
+    size_t run()
+    {
+      return _tag.Render(&_buffer[0], ID3TT_ID3V2);
+    }
+  };
+
+  class Parse : public bench::Case
+  {
+    BString _rendered;
+  public:
+    Parse(const char* name, const ID3_Tag& tag)
+      : Case(name), _rendered(tag.Size() + 1024, '\0')
+    {
+      _rendered.resize(tag.Render(&_rendered[0], ID3TT_ID3V2));
+    }
+    size_t run()
+    {
+      ID3_Tag tag;
+      ID3_MemoryReader mr(_rendered.data(), _rendered.size());
+      tag.Parse(mr);
+      return _rendered.size();
+    }
+  };
+
+  void fillTag(ID3_Tag& tag, size_t comments)
+  {
+    ID3_AddTitle(&tag, "A title of a reasonable length", true);
+    ID3_AddArtist(&tag, "Some artist", true);
+    ID3_AddAlbum(&tag, "Some album", true);
+    ID3_AddYear(&tag, "2003", true);
+    ID3_AddTrack(&tag, 7, 12, true);
+    ID3_AddGenre(&tag, 17, true);
+    for (size_t i = 0; i < comments; ++i)
+    {
+      char desc[32];
+      sprintf(desc, "comment %u", (unsigned) i);
+      ID3_AddComment(&tag, "Some text of a comment, not short either", desc,
+                     "eng");
+    }
+    ID3_Frame* counter = new ID3_Frame(ID3FID_PLAYCOUNTER);
+    counter->GetField(ID3FN_COUNTER)->Set(42);
+    tag.AttachFrame(counter);
+    ID3_Frame* band = new ID3_Frame(ID3FID_BAND);
+    band->GetField(ID3FN_TEXT)->Set("The band");
+    tag.AttachFrame(band);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  bench::Runner runner(argc, argv);
+
+  const BString data = audioBytes(BUFFER_SIZE);
+  const BString unsynced = unsyncBytes(data);
+
+  ReadChar memoryReadChar("reader.memory.readchar", data);
+  runner.run(memoryReadChar);
+  WindowedReadChar windowedReadChar(data);
+  runner.run(windowedReadChar);
+  WindowedReadChars windowedReadChars16("reader.windowed.readchars.16", data, 16);
+  runner.run(windowedReadChars16);
+  WindowedReadChars windowedReadChars4k("reader.windowed.readchars.4096", data, 4096);
+  runner.run(windowedReadChars4k);
+  UnsyncedReadChar unsyncedReadChar(unsynced);
+  runner.run(unsyncedReadChar);
+  UnsyncedReadChars unsyncedReadChars(unsynced);
+  runner.run(unsyncedReadChars);
+  CompressedRead compressedRead(data);
+  runner.run(compressedRead);
+
+  String latin1;
+  for (size_t i = 0; latin1.size() < 256; ++i)
+  {
+    latin1 += "Caf\xe9 ";
+  }
+  const String utf16 = convert(latin1, ID3TE_ISO8859_1, ID3TE_UTF16BE);
+  const String utf8 = convert(latin1, ID3TE_ISO8859_1, ID3TE_UTF8);
+  Convert latin1ToUtf16("convert.latin1.utf16be", latin1, ID3TE_ISO8859_1, ID3TE_UTF16BE);
+  runner.run(latin1ToUtf16);
+  Convert utf16ToLatin1("convert.utf16be.latin1", utf16, ID3TE_UTF16BE, ID3TE_ISO8859_1);
+  runner.run(utf16ToLatin1);
+  Convert utf8ToUtf16("convert.utf8.utf16be", utf8, ID3TE_UTF8, ID3TE_UTF16BE);
+  runner.run(utf8ToUtf16);
+  Convert utf16ToUtf8("convert.utf16be.utf8", utf16, ID3TE_UTF16BE, ID3TE_UTF8);
+  runner.run(utf16ToUtf8);
+
+  ID3_Tag big;
+  fillTag(big, 200);
+  Find findId("find.id", big, Find::BY_ID);
+  runner.run(findId);
+  Find findText("find.text", big, Find::BY_TEXT);
+  runner.run(findText);
+  Find findNumber("find.number", big, Find::BY_NUMBER);
+  runner.run(findNumber);
+
+  ID3_Tag small;
+  fillTag(small, 2);
+  Render renderSmall("render.v23.small", small);
+  runner.run(renderSmall);
+  Render renderBig("render.v23.large", big);
+  runner.run(renderBig);
+
+  ID3_Tag picture;
+  fillTag(picture, 2);
+  ID3_Frame* apic = new ID3_Frame(ID3FID_PICTURE);
+  apic->GetField(ID3FN_DATA)->Set(data.data(), data.size());
+  picture.AttachFrame(apic);
+  picture.SetUnsync(true);
+  Render renderUnsync("render.v23.unsync", picture);
+  runner.run(renderUnsync);
+  picture.SetUnsync(false);
+  apic->SetCompression(true);
+  Render renderCompressed("render.v23.compressed", picture);
+  runner.run(renderCompressed);
+
+  Parse parseSmall("parse.v23.small", small);
+  runner.run(parseSmall);
+  Parse parseBig("parse.v23.large", big);
+  runner.run(parseBig);
+  Parse parseCompressed("parse.v23.compressed", picture);
+  runner.run(parseCompressed);
+  picture.SetUnsync(true);
+  apic->SetCompression(false);
+  Parse parseUnsync("parse.v23.unsync", picture);
+  runner.run(parseUnsync);
+
+  return 0;
+}
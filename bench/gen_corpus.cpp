@@ -0,0 +1,637 @@
+// $Id$
+
+// Writes a synthetic corpus of mp3 files for the benchmarks and for scaling
+// tests.  A file is a function of the seed, its number and the options
+// only, so that the same command line gives the same corpus byte for byte,
+// and any one file can be made again on its own.  The tags are made with
+// ID3_Tag and ID3_Frame; the audio, the Lyrics3 and MusicMatch trailers and
+// the Xing headers, which id3lib reads but doesn't write, by hand.
+//
+//   gen_corpus [-n files] [-s seed] [-k shape,...] [-a audio frames]
+//              [-t text frames] [-p picture KB] [-P padding KB]
+//              [-d files per directory] directory
+//
+// The files take the shapes asked for in turn, and are written in
+// subdirectories of -d files each (0 for none), as <dir>/<nnnn>/<number>-
+// <shape>.mp3.  The shapes are
+//
+//   text        many small text frames, some of them in UTF-16
+//   picture     a large APIC frame (-p)
+//   compressed  text frames and a GEOB frame marked for compression, which
+//               id3lib only applies to the frames it makes smaller
+//   unsync      an unsynchronised tag, with false syncs in a picture
+//   v22         an ID3v2.2 tag of text frames
+//   lyrics3     an ID3v2 tag, and a Lyrics3 v2.00 and an ID3v1 tag at the end
+//   musicmatch  a MusicMatch and an ID3v1 tag at the end, without ID3v2
+//   padding     no padding, the default, an odd amount or a lot of it (-P)
+//   vbr         frames of varying bitrates, without a vbr header
+//   xing        the same, after a frame with a Xing header and its toc
+
+#include <errno.h>
+#include <vector>
+#include "bench.h"
+
+#if defined WIN32
+#  include <direct.h>
+#else
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#endif
+
+#include "id3/tag.h"
+#include "id3/field.h"
+#include "id3/misc_support.h"
+#include "id3/io_strings.h"
+#include "id3/id3lib_strings.h"
+
+using namespace dami;
+
+namespace
+{
+  enum Shape
+  {
+    TEXT = 0, PICTURE, COMPRESSED, UNSYNC, V22, LYRICS3, MUSICMATCH, PADDING,
+    VBR, XING, NUM_SHAPES
+  };
+
+  const char* const SHAPE_NAMES[NUM_SHAPES] =
+  {
+    "text", "picture", "compressed", "unsync", "v22", "lyrics3", "musicmatch",
+    "padding", "vbr", "xing"
+  };
+
+  struct Options
+  {
+    size_t files;
+    uint32 seed;
+    std::vector<Shape> shapes;
+    size_t audioFrames;
+    size_t textFrames;
+    size_t pictureSize;
+    size_t paddingSize;
+    size_t perDirectory;
+    String directory;
+
+    Options()
+      : files(1000), seed(1), audioFrames(300), textFrames(50),
+        pictureSize(1024 * 1024), paddingSize(64 * 1024), perDirectory(1000)
+    { }
+  };
+
+  // a small generator, seeded from the seed of the corpus and the number of
+  // the file, so that each file can be made on its own
+  class Random
+  {
+    uint32 _state;
+  public:
+    Random(uint32 seed, uint32 file)
+    {
+      _state = seed * 2654435761U ^ (file + 0x9E3779B9U);
+      for (size_t i = 0; i < 4; ++i)
+      {
+        this->next();
+      }
+    }
+    uint32 next()
+    {
+      // xorshift32
+      _state ^= _state << 13;
+      _state ^= _state >> 17;
+      _state ^= _state << 5;
+      return _state;
+    }
+    uint32 below(uint32 n) { return n ? this->next() % n : 0; }
+    BString bytes(size_t size)
+    {
+      BString data(size, '\0');
+      for (size_t i = 0; i < size; ++i)
+      {
+        data[i] = static_cast<uchar>(this->next() >> 24);
+      }
+      return data;
+    }
+  };
+
+  String format(const char* fmt, uint32 n)
+  {
+    char buf[64];
+    ::sprintf(buf, fmt, (unsigned) n);
+    return buf;
+  }
+
+  void appendLE(BString& data, uint32 val, size_t size)
+  {
+    for (size_t i = 0; i < size; ++i)
+    {
+      data += static_cast<uchar>(val >> (8 * i));
+    }
+  }
+
+  void appendBE(BString& data, uint32 val, size_t size)
+  {
+    for (size_t i = size; i > 0; --i)
+    {
+      data += static_cast<uchar>(val >> (8 * (i - 1)));
+    }
+  }
+
+  void append(BString& data, const String& text)
+  {
+    data.append(reinterpret_cast<const uchar*>(text.data()), text.size());
+  }
+
+  // mpeg 1 layer III at 44.1 kHz: the bitrate indexes used, and the size of
+  // their frames without padding
+  const uchar BITRATE_INDEXES[] = { 7, 9, 10, 11, 13 };
+  const size_t FRAME_SIZES[] = { 313, 417, 522, 626, 835 };
+  const size_t NUM_BITRATES = sizeof(FRAME_SIZES) / sizeof(FRAME_SIZES[0]);
+  const size_t CBR = 1; // 128 kbit/s
+
+  BString frameHeader(size_t bitrate)
+  {
+    BString header;
+    header += static_cast<uchar>(0xFF);
+    header += static_cast<uchar>(0xFB);
+    header += static_cast<uchar>(BITRATE_INDEXES[bitrate] << 4);
+    header += static_cast<uchar>(0x00);
+    return header;
+  }
+
+  BString audio(Random& rnd, size_t frames, bool vbr, bool xing)
+  {
+    std::vector<size_t> bitrates(frames, CBR);
+    size_t bytes = xing ? FRAME_SIZES[CBR] : 0;
+    for (size_t i = 0; i < frames; ++i)
+    {
+      if (vbr)
+      {
+        bitrates[i] = rnd.below(NUM_BITRATES);
+      }
+      bytes += FRAME_SIZES[bitrates[i]];
+    }
+
+    BString data;
+    data.reserve(bytes);
+    if (xing)
+    {
+      // the frame flags, number of frames and bytes and the toc, at the
+      // offset for stereo mpeg 1
+      data = frameHeader(CBR);
+      data.append(32, '\0');
+      append(data, "Xing");
+      appendBE(data, 0x07, 4);
+      appendBE(data, frames, 4);
+      appendBE(data, bytes, 4);
+      std::vector<size_t> offsets(frames + 1, FRAME_SIZES[CBR]);
+      for (size_t i = 0; i < frames; ++i)
+      {
+        offsets[i + 1] = offsets[i] + FRAME_SIZES[bitrates[i]];
+      }
+      for (size_t i = 0; i < 100; ++i)
+      {
+        const size_t offset = offsets[i * frames / 100];
+        data += static_cast<uchar>(static_cast<uint64>(offset) * 256 / bytes);
+      }
+      data.append(FRAME_SIZES[CBR] - data.size(), '\0');
+    }
+    for (size_t i = 0; i < frames; ++i)
+    {
+      data += frameHeader(bitrates[i]);
+      data += rnd.bytes(FRAME_SIZES[bitrates[i]] - 4);
+    }
+    return data;
+  }
+
+  ID3_Frame* textFrame(ID3_FrameID id, const String& text, bool unicode)
+  {
+    ID3_Frame* frame = new ID3_Frame(id);
+    if (unicode)
+    {
+      frame->GetField(ID3FN_TEXTENC)->Set(ID3TE_UTF16);
+      frame->GetField(ID3FN_TEXT)->SetEncoding(ID3TE_UTF16);
+    }
+    frame->GetField(ID3FN_TEXT)->Set(text.c_str());
+    return frame;
+  }
+
+  void addTextFrames(ID3_Tag& tag, Random& rnd, size_t count)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      const bool unicode = (i % 4 == 3);
+      ID3_Frame* frame = textFrame(ID3FID_USERTEXT,
+                                   format("value %u", rnd.below(100000)),
+                                   unicode);
+      frame->GetField(ID3FN_DESCRIPTION)->Set(format("field %u", i).c_str());
+      tag.AttachFrame(frame);
+      if (i % 8 == 7)
+      {
+        ID3_AddComment(&tag, format("comment text %u", rnd.below(100000)).c_str(),
+                       format("comment %u", i).c_str(), "eng");
+      }
+    }
+  }
+
+  ID3_Frame* picture(Random& rnd, size_t size)
+  {
+    // the jpeg magic, then noise, with its false syncs
+    BString data = rnd.bytes(size);
+    const uchar magic[] = { 0xFF, 0xD8, 0xFF, 0xE0 };
+    data.replace(0, size < 4 ? size : 4, magic, size < 4 ? size : 4);
+    ID3_Frame* frame = new ID3_Frame(ID3FID_PICTURE);
+    frame->GetField(ID3FN_MIMETYPE)->Set("image/jpeg");
+    frame->GetField(ID3FN_PICTURETYPE)->Set(ID3PT_COVERFRONT);
+    frame->GetField(ID3FN_DESCRIPTION)->Set("cover");
+    frame->GetField(ID3FN_DATA)->Set(data.data(), data.size());
+    return frame;
+  }
+
+  // what a player would have tagged the file with
+  void addBasics(ID3_Tag& tag, Random& rnd, uint32 number)
+  {
+    ID3_AddTitle(&tag, format("Title %u", number).c_str(), true);
+    ID3_AddArtist(&tag, format("Artist %u", rnd.below(500)).c_str(), true);
+    ID3_AddAlbum(&tag, format("Album %u", rnd.below(2000)).c_str(), true);
+    ID3_AddYear(&tag, format("%u", 1960 + rnd.below(45)).c_str(), true);
+    ID3_AddTrack(&tag, 1 + rnd.below(20), 20, true);
+    ID3_AddGenre(&tag, rnd.below(80), true);
+  }
+
+  BString renderV2(const ID3_Tag& tag)
+  {
+    BString data;
+    io::BStringWriter writer(data);
+    tag.Render(writer, ID3TT_ID3V2);
+    return data;
+  }
+
+  BString renderV1(const ID3_Tag& tag)
+  {
+    BString data;
+    io::BStringWriter writer(data);
+    tag.Render(writer, ID3TT_ID3V1);
+    return data;
+  }
+
+  // pads a tag rendered without padding with size zeros, and sets the size
+  // in its header to match
+  void pad(BString& data, size_t size)
+  {
+    if (data.size() < 10)
+    {
+      return;
+    }
+    data.append(size, '\0');
+    const size_t tagSize = data.size() - 10;
+    for (size_t i = 0; i < 4; ++i)
+    {
+      data[6 + i] = static_cast<uchar>((tagSize >> (7 * (3 - i))) & 0x7F);
+    }
+  }
+
+  // id3lib only writes ID3v2.3 tags.  This turns one, rendered without
+  // padding, into ID3v2.2: three letter frame ids, three byte frame sizes
+  // and no frame flags.  The frames must have the same fields in both, as
+  // the text frames and comments do.
+  BString toV22(const ID3_Tag& tag, const BString& v23)
+  {
+    BString data;
+    append(data, "ID3");
+    data += static_cast<uchar>(2);
+    data.append(6, '\0');
+    ID3_FrameInfo info;
+    ID3_Tag::ConstIterator* iter = tag.CreateIterator();
+    size_t pos = 10;
+    for (const ID3_Frame* frame = iter->GetNext();
+         frame != NULL && pos + 10 <= v23.size(); frame = iter->GetNext())
+    {
+      const size_t size = (v23[pos + 4] << 24) | (v23[pos + 5] << 16) |
+                          (v23[pos + 6] << 8) | v23[pos + 7];
+      append(data, info.ShortName(frame->GetID()));
+      appendBE(data, size, 3);
+      data.append(v23, pos + 10, size);
+      pos += 10 + size;
+    }
+    delete iter;
+    return data;
+  }
+
+  String lyrics3Field(const char* name, const String& text)
+  {
+    return name + format("%05u", text.size()) + text;
+  }
+
+  BString lyrics3(Random& rnd, uint32 number)
+  {
+    const bool stamped = (rnd.below(2) == 1);
+    String lyrics;
+    for (size_t i = 0; i < 8; ++i)
+    {
+      if (stamped)
+      {
+        lyrics += format("[%02u:", i / 6) + format("%02u]", (i * 10) % 60);
+      }
+      lyrics += format("Line %u of the song\r\n", i);
+    }
+    String body = "LYRICSBEGIN";
+    body += lyrics3Field("IND", stamped ? "11" : "10");
+    body += lyrics3Field("ETT", format("Lyrics3 title %u", number));
+    body += lyrics3Field("EAR", format("Lyrics3 artist %u", rnd.below(500)));
+    body += lyrics3Field("EAL", format("Lyrics3 album %u", rnd.below(2000)));
+    body += lyrics3Field("INF", "Written by gen_corpus");
+    body += lyrics3Field("LYR", lyrics);
+    body += format("%06u", body.size());
+    body += "LYRICS200";
+    BString data;
+    append(data, body);
+    return data;
+  }
+
+  void appendMMText(BString& data, const String& text)
+  {
+    appendLE(data, text.size(), 2);
+    append(data, text);
+  }
+
+  // a MusicMatch 3.00 tag: the header, the image extension and binary, two
+  // empty sections, the metadata, the offsets of the sections and the footer
+  BString musicMatch(Random& rnd, uint32 number, size_t fileOffset)
+  {
+    const size_t METADATA_SIZE = 7868;
+    BString data;
+    append(data, "18273645");
+    data.append(2, '\0');
+    append(data, "3.00");
+    data.append(256 - data.size(), '\0');
+
+    uint32 offsets[5];
+    offsets[0] = fileOffset + data.size();
+    append(data, "jpg ");
+    offsets[1] = fileOffset + data.size();
+    const size_t imageSize = rnd.below(2) ? 4096 : 0;
+    appendLE(data, imageSize, 4);
+    data += rnd.bytes(imageSize);
+    offsets[2] = fileOffset + data.size();
+    offsets[3] = offsets[2];
+    offsets[4] = offsets[3];
+
+    const size_t metadata = data.size();
+    appendMMText(data, format("MusicMatch title %u", number));
+    appendMMText(data, format("MusicMatch album %u", rnd.below(2000)));
+    appendMMText(data, format("MusicMatch artist %u", rnd.below(500)));
+    appendMMText(data, "Rock");
+    appendMMText(data, "Fast");
+    appendMMText(data, "Happy");
+    appendMMText(data, "Party");
+    appendMMText(data, "Excellent");
+    appendMMText(data, format("3:%02u", rnd.below(60)));
+    data.append(12, '\0');
+    appendMMText(data, format("c:\\music\\%u.mp3", number));
+    appendMMText(data, format("%08u", rnd.next() % 100000000));
+    appendLE(data, 1 + rnd.below(20), 2);
+    appendMMText(data, "Some notes");
+    appendMMText(data, "A biography");
+    appendMMText(data, "Some lyrics");
+    appendMMText(data, "http://www.example.com/artist");
+    appendMMText(data, "http://www.example.com/buy");
+    appendMMText(data, "artist@example.com");
+    data.append(METADATA_SIZE - (data.size() - metadata), '\0');
+
+    for (size_t i = 0; i < 5; ++i)
+    {
+      appendLE(data, offsets[i], 4);
+    }
+    append(data, "Brava Software Inc.             ");
+    append(data, "3.00");
+    data.append(12, ' ');
+    return data;
+  }
+
+  BString makeFile(const Options& opts, Shape shape, uint32 number)
+  {
+    Random rnd(opts.seed, number);
+    // for musicmatch, only the ID3v1 tag is written
+    ID3_Tag tag;
+    addBasics(tag, rnd, number);
+
+    BString trailer;
+    switch (shape)
+    {
+      case TEXT:
+        addTextFrames(tag, rnd, opts.textFrames);
+        break;
+
+      case PICTURE:
+        tag.AttachFrame(picture(rnd, opts.pictureSize));
+        break;
+
+      case COMPRESSED:
+      {
+        addTextFrames(tag, rnd, opts.textFrames / 4);
+        String text;
+        while (text.size() < 16 * 1024)
+        {
+          text += format("line %u of a compressible object\n", text.size());
+        }
+        ID3_Frame* frame = new ID3_Frame(ID3FID_GENERALOBJECT);
+        frame->GetField(ID3FN_MIMETYPE)->Set("text/plain");
+        frame->GetField(ID3FN_FILENAME)->Set("notes.txt");
+        frame->GetField(ID3FN_DESCRIPTION)->Set("notes");
+        frame->GetField(ID3FN_DATA)->Set(
+          reinterpret_cast<const uchar*>(text.data()), text.size());
+        tag.AttachFrame(frame);
+        ID3_Tag::Iterator* iter = tag.CreateIterator();
+        for (ID3_Frame* f = iter->GetNext(); f != NULL; f = iter->GetNext())
+        {
+          f->SetCompression(true);
+        }
+        delete iter;
+        break;
+      }
+
+      case UNSYNC:
+        addTextFrames(tag, rnd, opts.textFrames / 4);
+        tag.AttachFrame(picture(rnd, 16 * 1024));
+        tag.SetUnsync(true);
+        break;
+
+      case V22:
+        addTextFrames(tag, rnd, opts.textFrames / 4);
+        break;
+
+      case LYRICS3:
+        trailer = lyrics3(rnd, number);
+        break;
+
+      default:
+        break;
+    }
+
+    // none, the default, an odd amount or a lot of it
+    const uint32 paddingKind = (shape == PADDING) ? rnd.below(4) : 1;
+    tag.SetPadding(paddingKind == 1 && shape != V22);
+    BString data;
+    if (shape == V22)
+    {
+      data = toV22(tag, renderV2(tag));
+      pad(data, 1024);
+    }
+    else if (shape != MUSICMATCH)
+    {
+      data = renderV2(tag);
+      if (paddingKind == 2)
+      {
+        pad(data, 1 + rnd.below(4095));
+      }
+      else if (paddingKind == 3)
+      {
+        pad(data, opts.paddingSize);
+      }
+    }
+
+    data += audio(rnd, opts.audioFrames, shape == VBR || shape == XING,
+                  shape == XING);
+    if (shape == MUSICMATCH)
+    {
+      trailer = musicMatch(rnd, number, data.size());
+    }
+    data += trailer;
+    if (shape == LYRICS3 || shape == MUSICMATCH)
+    {
+      data += renderV1(tag);
+    }
+    return data;
+  }
+
+  bool makeDirectory(const String& name)
+  {
+#if defined WIN32
+    return ::_mkdir(name.c_str()) == 0 || errno == EEXIST;
+#else
+    return ::mkdir(name.c_str(), 0777) == 0 || errno == EEXIST;
+#endif
+  }
+
+  bool parseShapes(const char* list, std::vector<Shape>& shapes)
+  {
+    shapes.clear();
+    String names = list;
+    names += ',';
+    size_t beg = 0;
+    for (size_t end = names.find(','); end != String::npos;
+         beg = end + 1, end = names.find(',', beg))
+    {
+      const String name = names.substr(beg, end - beg);
+      size_t i = 0;
+      while (i < NUM_SHAPES && name != SHAPE_NAMES[i])
+      {
+        ++i;
+      }
+      if (i == NUM_SHAPES)
+      {
+        ::fprintf(stderr, "unknown shape: %s\n", name.c_str());
+        return false;
+      }
+      shapes.push_back(static_cast<Shape>(i));
+    }
+    return true;
+  }
+
+  bool parseOptions(int argc, char** argv, Options& opts)
+  {
+    for (size_t i = 0; i < NUM_SHAPES; ++i)
+    {
+      opts.shapes.push_back(static_cast<Shape>(i));
+    }
+    int i = 1;
+    for (; i + 1 < argc && argv[i][0] == '-' && argv[i][1] != '\0' &&
+           argv[i][2] == '\0'; i += 2)
+    {
+      const char* arg = argv[i + 1];
+      switch (argv[i][1])
+      {
+        case 'n': opts.files = ::atol(arg); break;
+        case 's': opts.seed = ::atol(arg); break;
+        case 'a': opts.audioFrames = ::atol(arg); break;
+        case 't': opts.textFrames = ::atol(arg); break;
+        case 'p': opts.pictureSize = ::atol(arg) * 1024; break;
+        case 'P': opts.paddingSize = ::atol(arg) * 1024; break;
+        case 'd': opts.perDirectory = ::atol(arg); break;
+        case 'k':
+          if (!parseShapes(arg, opts.shapes))
+          {
+            return false;
+          }
+          break;
+        default:
+          return false;
+      }
+    }
+    if (i + 1 != argc)
+    {
+      return false;
+    }
+    opts.directory = argv[i];
+    return true;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  Options opts;
+  if (!parseOptions(argc, argv, opts))
+  {
+    ::fprintf(stderr,
+              "usage: gen_corpus [-n files] [-s seed] [-k shape,...] "
+              "[-a audio frames]\n"
+              "                  [-t text frames] [-p picture KB] "
+              "[-P padding KB]\n"
+              "                  [-d files per directory] directory\n"
+              "shapes:");
+    for (size_t i = 0; i < NUM_SHAPES; ++i)
+    {
+      ::fprintf(stderr, " %s", SHAPE_NAMES[i]);
+    }
+    ::fprintf(stderr, "\n");
+    return 1;
+  }
+
+  if (!makeDirectory(opts.directory))
+  {
+    ::fprintf(stderr, "couldn't make %s\n", opts.directory.c_str());
+    return 1;
+  }
+  String dir = opts.directory;
+  uint64 bytes = 0;
+  for (size_t i = 0; i < opts.files; ++i)
+  {
+    if (opts.perDirectory > 0 && i % opts.perDirectory == 0)
+    {
+      dir = opts.directory + "/" + format("%04u", i / opts.perDirectory);
+      if (!makeDirectory(dir))
+      {
+        ::fprintf(stderr, "couldn't make %s\n", dir.c_str());
+        return 1;
+      }
+    }
+    const Shape shape = opts.shapes[i % opts.shapes.size()];
+    const String name = dir + "/" + format("%08u-", i) + SHAPE_NAMES[shape] +
+                        ".mp3";
+    const BString data = makeFile(opts, shape, i);
+    FILE* f = ::fopen(name.c_str(), "wb");
+    if (f == NULL || ::fwrite(data.data(), 1, data.size(), f) != data.size())
+    {
+      ::fprintf(stderr, "couldn't write %s\n", name.c_str());
+      if (f != NULL)
+      {
+        ::fclose(f);
+      }
+      return 1;
+    }
+    ::fclose(f);
+    bytes += data.size();
+  }
+  ::printf("%lu files, %.1f MB in %s\n", (unsigned long) opts.files,
+           bytes / (1024.0 * 1024.0), opts.directory.c_str());
+  return 0;
+}
@@ -0,0 +1,162 @@
+// $Id$
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/misc_support.h"
+#include "id3/id3lib_strings.h"
+#include "test_helpers.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using namespace dami;
+
+static const char* FILENAME = "test-append.mp3";
+static const size_t AUDIO_SIZE = 100000;
+
+static bool CheckAudio(size_t offset)
+{
+  FILE* f = fopen(FILENAME, "rb");
+  if (!f)
+  {
+    return false;
+  }
+  fseek(f, offset, SEEK_SET);
+  bool ok = true;
+  for (size_t i = 0; i < AUDIO_SIZE && ok; ++i)
+  {
+    ok = (fgetc(f) == (int)((i * 7 + 1) & 0xFF));
+  }
+  fclose(f);
+  return ok;
+}
+
+static size_t FileSize()
+{
+  FILE* f = fopen(FILENAME, "rb");
+  if (!f)
+  {
+    return 0;
+  }
+  fseek(f, 0, SEEK_END);
+  size_t size = ftell(f);
+  fclose(f);
+  return size;
+}
+
+int main(int argc, char *argv[])
+{
+  FILE* f = fopen(FILENAME, "wb");
+  CHECK(f != NULL);
+  for (size_t i = 0; i < AUDIO_SIZE; ++i)
+  {
+    fputc((i * 7 + 1) & 0xFF, f);
+  }
+  fclose(f);
+
+  size_t prepended = 0;
+  {
+    ID3_Tag tag(FILENAME);
+    ID3_AddTitle(&tag, "Test title", true);
+    ID3_AddArtist(&tag, "Test artist", true);
+    tag.Update(ID3TT_ID3V2 | ID3TT_ID3V1);
+    prepended = tag.GetPrependedBytes();
+    CHECK(prepended > 0);
+    CHECK(CheckAudio(prepended));
+  }
+
+  // grow the tag beyond its padding: it must go to the end of the file,
+  // leaving the audio data where it is
+  String lyrics(8000, 'x');
+  {
+    ID3_Tag tag(FILENAME);
+    tag.SetAppend(true);
+    ID3_AddLyrics(&tag, lyrics.c_str(), true);
+    const ID3_V2Spec spec = tag.GetSpec();
+    CHECK(tag.Update(ID3TT_ID3V2) == ID3TT_ID3V2APPENDED);
+    // the appended tag is an id3v2.4.0 one, but the tag keeps its spec
+    CHECK(tag.GetSpec() == spec && spec != ID3V2_4_0);
+    CHECK(tag.GetPrependedBytes() == prepended);
+    CHECK(CheckAudio(prepended));
+  }
+
+  {
+    ID3_Tag tag(FILENAME);
+    CHECK(tag.HasTagType(ID3TT_ID3V2));
+    CHECK(tag.HasTagType(ID3TT_ID3V2APPENDED));
+    CHECK(tag.HasTagType(ID3TT_ID3V1));
+    CHECK(tag.GetPrependedBytes() == prepended);
+    CHECK(tag.Find(ID3FID_SEEKFRAME) == NULL);
+    CHECK(String(ID3_GetTitle(&tag)) == "Test title");
+    CHECK(String(ID3_GetLyrics(&tag)) == lyrics);
+
+    // a second update replaces the appended tag
+    tag.SetAppend(true);
+    ID3_AddAlbum(&tag, "Test album", true);
+    CHECK(tag.Update(ID3TT_ID3V2) == ID3TT_ID3V2APPENDED);
+    CHECK(FileSize() == tag.GetPrependedBytes() + AUDIO_SIZE +
+                        tag.GetAppendedBytes());
+  }
+
+  {
+    ID3_Tag tag(FILENAME);
+    CHECK(String(ID3_GetAlbum(&tag)) == "Test album");
+    CHECK(String(ID3_GetLyrics(&tag)) == lyrics);
+    CHECK(CheckAudio(tag.GetPrependedBytes()));
+    tag.Strip(ID3TT_ALL);
+    CHECK(FileSize() == AUDIO_SIZE);
+    CHECK(CheckAudio(0));
+  }
+
+  // lyrics3v2 and id3v1 tags at the end, with a body larger than the block
+  // that the tail tags are looked for in
+  {
+    String lyr(20000, 'y');
+    char size[16];
+    sprintf(size, "%05u", (unsigned) lyr.size());
+    String body = "LYRICSBEGIN";
+    body += String("LYR") + size + lyr;
+    sprintf(size, "%06u", (unsigned) body.size());
+    body += String(size) + "LYRICS200";
+    String v1 = "TAG" + String("Tail title") + String(125 - 10, '\0');
+
+    f = fopen(FILENAME, "ab");
+    CHECK(f != NULL);
+    fwrite(body.data(), 1, body.size(), f);
+    fwrite(v1.data(), 1, v1.size(), f);
+    fclose(f);
+
+    ID3_Tag tag(FILENAME);
+    CHECK(tag.HasTagType(ID3TT_LYRICS3V2));
+    CHECK(tag.HasTagType(ID3TT_ID3V1));
+    CHECK(tag.GetAppendedBytes() == body.size() + v1.size());
+    CHECK(String(ID3_GetLyrics(&tag)) == lyr);
+    CHECK(String(ID3_GetTitle(&tag)) == "Tail title");
+  }
+
+  // a tag larger than what is read at the start of the file when it's
+  // opened
+  {
+    ID3_Tag tag(FILENAME);
+    tag.Strip(ID3TT_ALL);
+    CHECK(FileSize() == AUDIO_SIZE);
+    ID3_AddLyrics(&tag, String(200000, 'z').c_str(), true);
+    tag.Update(ID3TT_ID3V2);
+  }
+  {
+    ID3_Tag tag(FILENAME);
+    CHECK(tag.GetPrependedBytes() > 200000);
+    CHECK(String(ID3_GetLyrics(&tag)) == String(200000, 'z'));
+    CHECK(CheckAudio(tag.GetPrependedBytes()));
+  }
+
+  remove(FILENAME);
+  cout << "ok" << endl;
+  return 0;
+}
@@ -0,0 +1,182 @@
+// $Id$
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/tag_batch.h"
+#include "id3/dir_walker.h"
+#include "id3/misc_support.h"
+#include "id3/id3lib_strings.h"
+#include "test_helpers.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using namespace dami;
+
+namespace
+{
+  const size_t FILES = 20;
+
+  String fileName(size_t i)
+  {
+    char name[32];
+    sprintf(name, "test-batch-%02u.mp3", (unsigned) i);
+    return name;
+  }
+
+  String title(size_t i)
+  {
+    char name[32];
+    sprintf(name, "Batch title %u", (unsigned) i);
+    return name;
+  }
+
+  // A file of audio with an id3v2 tag and an id3v1 one.  Every fifth tag
+  // holds a picture larger than what is read of the head at first.
+  bool makeFile(size_t i)
+  {
+    const String name = fileName(i);
+    FILE* f = fopen(name.c_str(), "wb");
+    if (f == NULL)
+    {
+      return false;
+    }
+    BString audio(3000 + 1000 * i, 0x22);
+    fwrite(audio.data(), 1, audio.size(), f);
+    fclose(f);
+    ID3_Tag tag(name.c_str());
+    ID3_AddTitle(&tag, title(i).c_str(), true);
+    if (i % 5 == 0)
+    {
+      BString picture(200000 + i, 0x33);
+      ID3_Frame* frame = new ID3_Frame(ID3FID_PICTURE);
+      frame->GetField(ID3FN_DATA)->Set(picture.data(), picture.size());
+      tag.AttachFrame(frame);
+    }
+    tag.Update(ID3TT_ID3V2 | ID3TT_ID3V1);
+    return true;
+  }
+
+  int checkBatch(ID3_TagBatch& batch)
+  {
+    CHECK(batch.Link() == FILES);
+    for (size_t i = 0; i < FILES; ++i)
+    {
+      CHECK(batch.IsLinked(i));
+      ID3_Tag* tag = batch.GetTag(i);
+      CHECK(tag->HasTagType(ID3TT_ID3V2) && tag->HasTagType(ID3TT_ID3V1));
+      char* text = ID3_GetTitle(tag);
+      CHECK(text != NULL && title(i) == text);
+      ID3_FreeString(text);
+      ID3_Frame* frame = tag->Find(ID3FID_PICTURE);
+      CHECK((frame != NULL) == (i % 5 == 0));
+      CHECK(frame == NULL || frame->GetField(ID3FN_DATA)->Size() == 200000 + i);
+      CHECK(String(tag->GetFileName()) == fileName(i));
+    }
+    CHECK(!batch.IsLinked(FILES));
+    return 0;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  ID3_TagBatch batch;
+  for (size_t i = 0; i < FILES; ++i)
+  {
+    CHECK(makeFile(i));
+    batch.Add(fileName(i).c_str());
+  }
+  batch.Add("test-batch-missing.mp3");
+  CHECK(batch.NumFiles() == FILES + 1);
+  CHECK(batch.GetTag(0) == NULL);
+
+  // fewer files in flight than there are files
+  batch.SetDepth(7);
+  batch.SetThreads(3);
+  CHECK(checkBatch(batch) == 0);
+  cout << (batch.IsAsync() ? "io_uring" : "threads") << endl;
+
+  // and the same without io_uring
+  batch.SetAsync(false);
+  CHECK(checkBatch(batch) == 0);
+  CHECK(!batch.IsAsync());
+
+  // in the order the files lie on disk
+  batch.SetAsync(true);
+  batch.SetDiskOrder(true);
+  CHECK(checkBatch(batch) == 0);
+
+  // a linked tag can be updated
+  ID3_AddArtist(batch.GetTag(3), "Batch artist", true);
+  batch.GetTag(3)->Update();
+  ID3_Tag tag(fileName(3).c_str());
+  char* artist = ID3_GetArtist(&tag);
+  CHECK(artist != NULL && String(artist) == "Batch artist");
+  ID3_FreeString(artist);
+
+  batch.Clear();
+  CHECK(batch.NumFiles() == 0);
+
+  // a tree with a hard link, a link that loops and a file that only has
+  // the right extension
+  mkdir("test-walk", 0755);
+  mkdir("test-walk/a", 0755);
+  mkdir("test-walk/a/b", 0755);
+  CHECK(rename(fileName(0).c_str(), "test-walk/a/b/zero.mp3") == 0);
+  CHECK(rename(fileName(1).c_str(), "test-walk/a/one.MP3") == 0);
+  CHECK(link("test-walk/a/one.MP3", "test-walk/one-again.mp3") == 0);
+  CHECK(symlink("..", "test-walk/a/b/up") == 0);
+  CHECK(symlink("../a/b/zero.mp3", "test-walk/a/zero-link.mp3") == 0);
+  FILE* f = fopen("test-walk/a/text.mp3", "wb");
+  fputs("no audio here", f);
+  fclose(f);
+  f = fopen("test-walk/notes.txt", "wb");
+  fclose(f);
+
+  ID3_DirWalker walker;
+  walker.AddExtension(".mp3");
+  CHECK(walker.Walk("test-walk") == 3);
+  walker.Clear();
+  walker.SetFollowSymlinks(true);
+  walker.SetMagicCheck(true);
+  CHECK(walker.Walk("test-walk/") == 2);
+  CHECK(walker.Walk("test-walk") == 0);
+  walker.Clear();
+  walker.SetMagicCheck(false);
+  walker.AddExtension("txt");
+  CHECK(walker.Walk("test-walk") == 4);
+  CHECK(walker.Walk("test-walk-missing") == 0);
+
+  walker.Clear();
+  walker.AddExtension("mp3");
+  walker.SetMagicCheck(true);
+  walker.Walk("test-walk");
+  CHECK(walker.AddTo(batch) == 2);
+  CHECK(batch.Link() == 2);
+  CHECK(batch.GetTag(0)->HasTagType(ID3TT_ID3V2));
+
+  const char* walked[] = { "test-walk/a/b/up", "test-walk/a/zero-link.mp3",
+    "test-walk/a/text.mp3", "test-walk/notes.txt", "test-walk/one-again.mp3",
+    "test-walk/a/one.MP3", "test-walk/a/b/zero.mp3" };
+  for (size_t i = 0; i < sizeof(walked) / sizeof(walked[0]); ++i)
+  {
+    remove(walked[i]);
+  }
+  rmdir("test-walk/a/b");
+  rmdir("test-walk/a");
+  rmdir("test-walk");
+  for (size_t i = 0; i < FILES; ++i)
+  {
+    remove(fileName(i).c_str());
+  }
+  cout << "ok" << endl;
+  return 0;
+}
@@ -0,0 +1,115 @@
+// $Id$
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/tag_cache.h"
+#include "id3/misc_support.h"
+#include "id3/mp3_vbr.h"
+#include "id3/id3lib_strings.h"
+#include "test_helpers.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using namespace dami;
+
+static const char* FILENAME = "test-cache.mp3";
+static const char* CACHENAME = "test-cache.id3c";
+
+int main(int argc, char *argv[])
+{
+  const size_t FRAMES = 200;
+  // 128kbit/s frames, after a xing header that counts them
+  BString data = mpegFrame(9, 417);
+  memcpy(&data[4 + 32], "Xing\0\0\0\x01\0\0\0", 11);
+  data[4 + 32 + 11] = FRAMES;
+  for (size_t i = 0; i < FRAMES; ++i)
+  {
+    data += mpegFrame(9, 417);
+  }
+  CHECK(writeFile(FILENAME, data));
+  remove(CACHENAME);
+  {
+    ID3_Tag tag(FILENAME);
+    ID3_AddTitle(&tag, "Cached title", true);
+    ID3_AddArtist(&tag, "Cached artist", true);
+    tag.Update(ID3TT_ID3V2 | ID3TT_ID3V1);
+  }
+
+  ID3_TagCache cache;
+  CHECK(cache.Open(CACHENAME));
+  ID3_TagCache::SetDefault(&cache);
+
+  size_t prepended = 0, appended = 0;
+  uint32 frames = 0;
+  {
+    ID3_Tag tag(FILENAME);
+    CHECK(cache.GetMisses() == 1 && cache.GetHits() == 0);
+    prepended = tag.GetPrependedBytes();
+    appended = tag.GetAppendedBytes();
+    CHECK(tag.GetMp3HeaderInfo() != NULL);
+    CHECK(tag.GetMp3VbrHeader() != NULL);
+    frames = tag.GetMp3HeaderInfo()->frames;
+  }
+  CHECK(cache.NumEntries() == 1);
+  cache.Close();
+
+  // what was flushed is found again, without parsing the file
+  CHECK(cache.Open(CACHENAME));
+  CHECK(cache.NumEntries() == 1);
+  {
+    ID3_Tag tag(FILENAME);
+    CHECK(cache.GetHits() == 1 && cache.GetMisses() == 0);
+    CHECK(tag.HasTagType(ID3TT_ID3V2));
+    CHECK(tag.HasTagType(ID3TT_ID3V1));
+    CHECK(tag.GetPrependedBytes() == prepended);
+    CHECK(tag.GetAppendedBytes() == appended);
+    CHECK(String(ID3_GetTitle(&tag)) == "Cached title");
+    CHECK(String(ID3_GetArtist(&tag)) == "Cached artist");
+    CHECK(tag.NumFrames() == 2);
+    CHECK(tag.GetMp3HeaderInfo() != NULL);
+    CHECK(tag.GetMp3HeaderInfo()->frames == frames);
+    CHECK(tag.GetMp3HeaderInfo()->bitrate == MP3BITRATE_128K);
+    CHECK(tag.GetMp3VbrHeader() != NULL);
+    CHECK(tag.GetMp3VbrHeader()->GetFrames() == FRAMES);
+
+    // an update forgets the file, the next link parses it again
+    ID3_AddTitle(&tag, "New title", true);
+    tag.Update(ID3TT_ID3V2);
+  }
+  {
+    ID3_Tag tag(FILENAME);
+    CHECK(cache.GetMisses() == 1);
+    CHECK(String(ID3_GetTitle(&tag)) == "New title");
+  }
+  {
+    ID3_Tag tag(FILENAME);
+    CHECK(cache.GetHits() == 2);
+    CHECK(String(ID3_GetTitle(&tag)) == "New title");
+  }
+
+  // a file changed behind our back isn't found either
+  FILE* f = fopen(FILENAME, "ab");
+  CHECK(f != NULL);
+  fwrite(data.data(), 1, 417, f);
+  fclose(f);
+  {
+    ID3_Tag tag(FILENAME);
+    CHECK(cache.GetMisses() == 2);
+    CHECK(!tag.HasTagType(ID3TT_ID3V1));
+  }
+  CHECK(cache.NumEntries() == 1);
+
+  ID3_TagCache::SetDefault(NULL);
+  cache.Close();
+  remove(FILENAME);
+  remove(CACHENAME);
+  cout << "ok" << endl;
+  return 0;
+}
@@ -0,0 +1,160 @@
+// $Id$
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/misc_support.h"
+#include "id3/id3lib_strings.h"
+#include "test_helpers.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using namespace dami;
+
+namespace
+{
+  BString number(uint32 val, size_t len, bool bigEndian)
+  {
+    BString data(len, '\0');
+    for (size_t i = 0; i < len; ++i, val >>= 8)
+    {
+      data[bigEndian ? len - 1 - i : i] = static_cast<uchar>(val & 0xFF);
+    }
+    return data;
+  }
+
+  BString chunk(const char* id, const BString& data, bool bigEndian)
+  {
+    BString out(reinterpret_cast<const uchar*>(id), 4);
+    out += number(data.size(), 4, bigEndian);
+    out += data;
+    if (data.size() & 1)
+    {
+      out += static_cast<uchar>(0);
+    }
+    return out;
+  }
+
+  BString form(const char* id, const char* type, const BString& chunks,
+               bool bigEndian)
+  {
+    BString out(reinterpret_cast<const uchar*>(id), 4);
+    out += number(chunks.size() + 4, 4, bigEndian);
+    out += BString(reinterpret_cast<const uchar*>(type), 4);
+    out += chunks;
+    return out;
+  }
+
+  BString tagData(const char* title)
+  {
+    ID3_Tag tag;
+    ID3_AddTitle(&tag, title, true);
+    return renderTag(tag);
+  }
+
+  // samples that are full of syncs, which are no mpeg frames
+  BString pcm(size_t size)
+  {
+    BString data(size, 0xFF);
+    for (size_t i = 1; i < size; i += 2)
+    {
+      data[i] = 0xFB;
+    }
+    return data;
+  }
+
+  BString mpeg(size_t frames)
+  {
+    BString data;
+    for (size_t i = 0; i < frames; ++i)
+    {
+      data += mpegFrame(9, 417);
+    }
+    return data;
+  }
+
+  String title(const ID3_Tag& tag)
+  {
+    char* str = ID3_GetTitle(&tag);
+    String title = (str != NULL) ? str : "";
+    delete [] str;
+    return title;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  const char* filename = "test_container.tmp";
+
+  // a pcm wav file, with the tag in a chunk after the samples
+  BString fmt = number(1, 2, false) + number(2, 2, false) +
+                number(44100, 4, false) + number(176400, 4, false) +
+                number(4, 2, false) + number(16, 2, false);
+  BString wav = form("RIFF", "WAVE", chunk("fmt ", fmt, false) +
+                     chunk("data", pcm(100001), false) +
+                     chunk("id3 ", tagData("Wave"), false), false);
+  CHECK(writeFile(filename, wav));
+  {
+    ID3_Tag tag(filename);
+    CHECK(title(tag) == "Wave");
+    CHECK(tag.HasV2Tag());
+    CHECK(tag.GetMp3HeaderInfo() == NULL);
+    CHECK(tag.GetAudioOffset() == 12 + 8 + fmt.size() + 8);
+  }
+
+  // an mpeg wav file
+  BString mfmt = number(0x55, 2, false) + number(2, 2, false) +
+                 number(44100, 4, false) + number(16000, 4, false) +
+                 number(1, 2, false) + number(0, 2, false);
+  BString mwav = form("RIFF", "WAVE", chunk("fmt ", mfmt, false) +
+                      chunk("ID3 ", tagData("Mpeg wave"), false) +
+                      chunk("data", mpeg(20), false), false);
+  CHECK(writeFile(filename, mwav));
+  {
+    ID3_Tag tag(filename);
+    CHECK(title(tag) == "Mpeg wave");
+    CHECK(tag.GetMp3HeaderInfo() != NULL);
+    CHECK(tag.GetMp3HeaderInfo()->bitrate == MP3BITRATE_128K);
+    CHECK(tag.GetAudioOffset() == mwav.size() - mpeg(20).size());
+  }
+
+  // an aiff file
+  BString ssnd = number(0, 4, true) + number(0, 4, true) + pcm(5000);
+  BString aiff = form("FORM", "AIFF", chunk("COMM", BString(18, 0x01), true) +
+                      chunk("SSND", ssnd, true) +
+                      chunk("ID3 ", tagData("Aiff"), true), true);
+  CHECK(writeFile(filename, aiff));
+  {
+    ID3_Tag tag(filename);
+    CHECK(title(tag) == "Aiff");
+    CHECK(tag.GetMp3HeaderInfo() == NULL);
+    CHECK(tag.GetAudioOffset() == 12 + 8 + 18 + 8 + 8);
+  }
+
+  // a flac file with a tag in front, and two metadata blocks
+  BString flac = tagData("Flac");
+  const size_t flacBeg = flac.size();
+  flac += BString(reinterpret_cast<const uchar*>("fLaC"), 4);
+  flac += number(34, 4, true) + BString(34, 0x01);
+  flac += number(0x84000000 | 1000, 4, true) + BString(1000, 0x02);
+  const size_t flacAudio = flac.size();
+  flac += pcm(3000);
+  CHECK(writeFile(filename, flac));
+  {
+    ID3_Tag tag(filename);
+    CHECK(title(tag) == "Flac");
+    CHECK(tag.GetPrependedBytes() == flacBeg);
+    CHECK(tag.GetMp3HeaderInfo() == NULL);
+    CHECK(tag.GetAudioOffset() == flacAudio);
+  }
+
+  remove(filename);
+  cout << "ok" << endl;
+  return 0;
+}
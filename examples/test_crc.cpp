@@ -0,0 +1,102 @@
+// $Id$
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/mp3_index.h"
+#include "id3/misc_support.h"
+#include "id3/id3lib_strings.h"
+#include "test_helpers.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using namespace dami;
+
+namespace
+{
+  // the mpeg crc, a bit at a time
+  uint16 crc16(const BString& data, size_t beg, size_t end, uint16 crc)
+  {
+    for (size_t i = beg; i < end; ++i)
+    {
+      for (int bit = 7; bit >= 0; --bit)
+      {
+        const bool high = (crc & 0x8000) != 0;
+        crc <<= 1;
+        if (high != (((data[i] >> bit) & 1) != 0))
+        {
+          crc ^= 0x8005;
+        }
+      }
+    }
+    return crc;
+  }
+
+  // a stereo mpeg 1 layer III frame at 44.1kHz with a crc over its 32 bytes
+  // of side information
+  BString frame(uchar bitrateIndex, size_t size, uchar fill)
+  {
+    BString data(size, 0x11);
+    data[0] = 0xFF;
+    data[1] = 0xFA;
+    data[2] = bitrateIndex << 4;
+    data[3] = 0x00;
+    data[6] = fill;
+    const uint16 crc = crc16(data, 6, 38, crc16(data, 2, 4, 0xFFFF));
+    data[4] = crc >> 8;
+    data[5] = crc & 0xFF;
+    return data;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  const char* filename = "test_crc.mp3";
+  const size_t FRAMES = 1000;
+  BString audio;
+  for (size_t i = 0; i < FRAMES; ++i)
+  {
+    BString next = (i % 3 == 0) ? frame(11, 626, i & 0x7F) : frame(9, 417, i & 0x7F);
+    if (i == 10 || i == 777)
+    {
+      // a flipped bit in the side information
+      next[20] ^= 0x04;
+    }
+    audio += next;
+  }
+
+  ID3_Tag tag;
+  ID3_AddTitle(&tag, "Checked", true);
+  BString data = renderTag(tag);
+  data += audio;
+  CHECK(writeFile(filename, data));
+
+  ID3_Tag unchecked;
+  unchecked.SetFullScan(true);
+  unchecked.Link(filename);
+  CHECK(unchecked.GetMp3HeaderInfo()->crc == MP3CRC_OK);
+  CHECK(unchecked.GetMp3FrameIndex()->GetCrcFrameCount() == 0);
+
+  ID3_Tag checked;
+  checked.SetFullScan(true);
+  checked.SetCrcCheck(true);
+  checked.Link(filename);
+  const ID3_Mp3FrameIndex* index = checked.GetMp3FrameIndex();
+  CHECK(index != NULL);
+  CHECK(index->GetFrameCount() == FRAMES);
+  CHECK(index->GetCrcFrameCount() == FRAMES);
+  CHECK(index->GetCrcErrorCount() == 2);
+  CHECK(index->GetCrcError(0) == 10);
+  CHECK(index->GetCrcError(1) == 777);
+  CHECK(index->GetCrcError(2) == FRAMES);
+
+  remove(filename);
+  cout << "ok" << endl;
+  return 0;
+}
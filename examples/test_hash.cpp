@@ -0,0 +1,99 @@
+// $Id$
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/audio_hash.h"
+#include "id3/misc_support.h"
+#include "id3/id3lib_strings.h"
+#include "test_helpers.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using namespace dami;
+
+namespace
+{
+  String hex(const uchar* data, size_t size)
+  {
+    const char* digits = "0123456789abcdef";
+    String str;
+    for (size_t i = 0; i < size; ++i)
+    {
+      str += digits[data[i] >> 4];
+      str += digits[data[i] & 15];
+    }
+    return str;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  // known answers, fed in uneven pieces
+  const char* fox = "The quick brown fox jumps over the lazy dog";
+  ID3_AudioHash known(true);
+  known.Update(reinterpret_cast<const uchar*>(fox), 5);
+  known.Update(reinterpret_cast<const uchar*>(fox) + 5, strlen(fox) - 5);
+  known.Finish();
+  CHECK(hex(known.GetHash(), ID3_AudioHash::HASH_SIZE) ==
+        "6c1b07bc7bbc4be347939ac4a93c437a");
+  CHECK(known.GetHash64() == ((uint64(0xe34bbc7b) << 32) | 0xbc071b6c));
+  known.Clear();
+  known.Update(reinterpret_cast<const uchar*>("abc"), 3);
+  known.Finish();
+  CHECK(hex(known.GetSha256(), ID3_AudioHash::SHA256_SIZE) ==
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+
+  // the same audio, in two files with different tags
+  BString audio;
+  for (size_t i = 0; i < 50; ++i)
+  {
+    audio += mpegFrame(9, 417, static_cast<uchar>(0x11 + i));
+  }
+
+  ID3_Tag tag;
+  ID3_AddTitle(&tag, "One", true);
+  BString one = renderTag(tag);
+  one += audio;
+  CHECK(writeFile("test_hash1.mp3", one));
+
+  ID3_AddArtist(&tag, "Somebody else", true);
+  BString two = renderTag(tag);
+  two += audio;
+  two += renderTag(tag, ID3TT_ID3V1);
+  CHECK(writeFile("test_hash2.mp3", two));
+
+  ID3_Tag tag1("test_hash1.mp3");
+  ID3_Tag tag2("test_hash2.mp3");
+  CHECK(tag2.HasTagType(ID3TT_ID3V1) && !tag1.HasTagType(ID3TT_ID3V1));
+  CHECK(tag1.GetAudioSize() == audio.size());
+  CHECK(tag2.GetAudioSize() == audio.size());
+
+  ID3_AudioHash hash1(true), hash2(true), direct(true);
+  CHECK(hash1.Compute(tag1));
+  CHECK(hash2.Compute(tag2));
+  direct.Update(audio.data(), audio.size());
+  direct.Finish();
+  CHECK(hash1.GetSize() == audio.size());
+  CHECK(memcmp(hash1.GetHash(), hash2.GetHash(), ID3_AudioHash::HASH_SIZE) == 0);
+  CHECK(memcmp(hash1.GetHash(), direct.GetHash(), ID3_AudioHash::HASH_SIZE) == 0);
+  CHECK(memcmp(hash1.GetSha256(), hash2.GetSha256(), ID3_AudioHash::SHA256_SIZE) == 0);
+  CHECK(hash1.GetHash64() == direct.GetHash64());
+
+  ID3_AudioHash fast;
+  CHECK(fast.Compute(tag1));
+  CHECK(fast.GetHash64() == hash1.GetHash64());
+  CHECK(fast.GetSha256() == NULL);
+
+  remove("test_hash1.mp3");
+  remove("test_hash2.mp3");
+  cout << "ok" << endl;
+  return 0;
+}
@@ -0,0 +1,54 @@
+// $Id$
+
+// What the test programs have in common: the CHECK macro, and the mpeg
+// frames, tags and files they are run on.
+
+#ifndef _ID3LIB_TEST_HELPERS_H_
+#define _ID3LIB_TEST_HELPERS_H_
+
+#include <stdio.h>
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/id3lib_strings.h"
+
+// returns 1 from the function it's in if cond doesn't hold
+#define CHECK(cond) \
+  if (!(cond)) { std::cerr << "*** failed: " << #cond << std::endl; return 1; }
+
+namespace
+{
+  // an mpeg 1 layer III frame at 44.1kHz, stereo, without a crc.  The
+  // default fill doesn't look like a sync.
+  inline dami::BString mpegFrame(uchar bitrateIndex, size_t size,
+                                 uchar fill = 0x11)
+  {
+    dami::BString data(size, fill);
+    data[0] = 0xFF;
+    data[1] = 0xFB;
+    data[2] = bitrateIndex << 4;
+    data[3] = 0x00;
+    return data;
+  }
+
+  // the tags of the given types, as they are written to a file
+  inline dami::BString renderTag(const ID3_Tag& tag,
+                                 ID3_TagType types = ID3TT_ID3V2)
+  {
+    dami::BString data(tag.Size() + ID3_V1_LEN, '\0');
+    data.resize(tag.Render(&data[0], types));
+    return data;
+  }
+
+  inline bool writeFile(const char* name, const dami::BString& data)
+  {
+    FILE* file = fopen(name, "wb");
+    if (file == NULL)
+    {
+      return false;
+    }
+    const bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    return (fclose(file) == 0) && ok;
+  }
+}
+
+#endif /* _ID3LIB_TEST_HELPERS_H_ */
@@ -0,0 +1,82 @@
+// $Id$
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/mp3_index.h"
+#include "id3/misc_support.h"
+#include "id3/id3lib_strings.h"
+#include "test_helpers.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using namespace dami;
+
+int main(int argc, char *argv[])
+{
+  const char* filename = "test_mllt.mp3";
+  const size_t FRAMES = 3000;
+  const size_t BETWEEN = 100;
+  BString audio;
+  std::vector<size_t> offsets;
+  for (size_t i = 0; i < FRAMES; ++i)
+  {
+    if (i == 1000)
+    {
+      // junk between two references, for a large deviation
+      audio += BString(70000, 0x22);
+    }
+    offsets.push_back(audio.size());
+    audio += (i % 3 == 0) ? mpegFrame(11, 626) : mpegFrame(9, 417);
+  }
+  offsets.push_back(audio.size());
+
+  ID3_Tag tag;
+  ID3_AddTitle(&tag, "Looked up", true);
+  BString data = renderTag(tag);
+  data += audio;
+  CHECK(writeFile(filename, data));
+
+  ID3_Tag scanned;
+  CHECK(ID3_AddMpegLookupTable(&scanned, BETWEEN) == NULL);
+  scanned.SetFullScan(true);
+  scanned.Link(filename);
+  CHECK(ID3_AddMpegLookupTable(&scanned, BETWEEN) != NULL);
+  CHECK(ID3_AddMpegLookupTable(&scanned, BETWEEN) == NULL);
+  CHECK(ID3_AddMpegLookupTable(&scanned, BETWEEN, true) != NULL);
+  CHECK(scanned.NumFrames() == 2);
+  scanned.Update(ID3TT_ID3V2);
+
+  ID3_Tag linked(filename);
+  const ID3_Frame* mllt = linked.Find(ID3FID_MPEGLOOKUP);
+  CHECK(mllt != NULL);
+  const size_t base = linked.GetPrependedBytes();
+  ID3_Mp3LookupTable table;
+  CHECK(table.Parse(*mllt, base));
+  CHECK(table.GetFramesBetween() == BETWEEN);
+  CHECK(table.GetReferenceCount() == FRAMES / BETWEEN + 1);
+  for (size_t i = 0; i < table.GetReferenceCount(); ++i)
+  {
+    CHECK(table.GetReferenceOffset(i) == base + offsets[i * BETWEEN]);
+    // frames of 1152 samples at 44.1kHz
+    CHECK(table.GetReferenceTime(i) ==
+          static_cast<uint32>(i * BETWEEN * 1152 * 1000.0 / 44100 + 0.5));
+  }
+
+  // 30s is in frame 1148, after the reference for frame 1100
+  CHECK(table.TimeToByteOffset(30000) == base + offsets[1100]);
+  CHECK(table.TimeToByteOffset(0) == base);
+  CHECK(table.ByteOffsetToTime(base + offsets[1100] + 1) ==
+        table.GetReferenceTime(11));
+  CHECK(table.ByteOffsetToTime(0) == 0);
+
+  remove(filename);
+  cout << "ok" << endl;
+  return 0;
+}
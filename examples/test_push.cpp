@@ -0,0 +1,91 @@
+// $Id$
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/push_parser.h"
+#include "id3/misc_support.h"
+#include "id3/id3lib_strings.h"
+#include "test_helpers.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using namespace dami;
+
+class TagHandler : public ID3_PushParser::Handler
+{
+ public:
+  ID3_Tag tag;
+  size_t frames;
+  bool ended;
+  TagHandler() : frames(0), ended(false) { ; }
+  void OnFrame(const ID3_Frame& frame) { tag.AddFrame(frame); ++frames; }
+  void OnTagEnd() { ended = true; }
+};
+
+// feeds data in chunks of the given size, returns the number of bytes used
+static size_t FeedChunks(ID3_PushParser& parser, const BString& data, size_t chunk)
+{
+  size_t used = 0;
+  for (size_t pos = 0; pos < data.size() && !parser.IsDone(); pos += chunk)
+  {
+    used += parser.Feed(data.data() + pos, dami::min(chunk, data.size() - pos));
+  }
+  return used;
+}
+
+int main(int argc, char *argv[])
+{
+  String lyrics(3000, 'l');
+  lyrics[100] = '\xFF'; // something to unsynchronise
+  lyrics[101] = '\xE0';
+
+  for (int unsync = 0; unsync < 2; ++unsync)
+  {
+    ID3_Tag tag;
+    ID3_AddTitle(&tag, "Pushed title", true);
+    ID3_AddArtist(&tag, "Pushed artist", true);
+    ID3_AddLyrics(&tag, lyrics.c_str(), true);
+    ID3_Frame* frame = tag.Find(ID3FID_UNSYNCEDLYRICS);
+    CHECK(frame != NULL);
+    frame->SetCompression(true);
+    tag.SetUnsync(unsync == 1);
+
+    BString data = renderTag(tag);
+    const size_t tagSize = data.size();
+    data += BString(100, 0xAA); // audio
+
+    const size_t chunks[] = { 1, 7, 512, 64 * 1024 };
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); ++i)
+    {
+      TagHandler handler;
+      ID3_PushParser parser(handler);
+      CHECK(FeedChunks(parser, data, chunks[i]) == tagSize);
+      CHECK(parser.IsDone());
+      CHECK(parser.HasTag());
+      CHECK(parser.GetTagSize() == tagSize);
+      CHECK(handler.ended);
+      CHECK(handler.frames == 3);
+      CHECK(String(ID3_GetTitle(&handler.tag)) == "Pushed title");
+      CHECK(String(ID3_GetArtist(&handler.tag)) == "Pushed artist");
+      CHECK(String(ID3_GetLyrics(&handler.tag)) == lyrics);
+    }
+  }
+
+  // no tag at all: done after the size of a header
+  TagHandler handler;
+  ID3_PushParser parser(handler);
+  BString audio(100, 0xAA);
+  CHECK(parser.Feed(audio.data(), audio.size()) == 10);
+  CHECK(parser.IsDone());
+  CHECK(!parser.HasTag());
+  CHECK(handler.frames == 0);
+
+  cout << "ok" << endl;
+  return 0;
+}
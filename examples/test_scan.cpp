@@ -0,0 +1,95 @@
+// $Id$
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/mp3_index.h"
+#include "id3/misc_support.h"
+#include "id3/id3lib_strings.h"
+#include "test_helpers.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using namespace dami;
+
+int main(int argc, char *argv[])
+{
+  const char* filename = "test_scan.mp3";
+  const size_t FRAMES = 3000;
+  BString audio;
+  std::vector<size_t> offsets;
+  for (size_t i = 0; i < FRAMES; ++i)
+  {
+    if (i == 1000)
+    {
+      // junk with a false sync in it, far enough to need an absolute offset
+      audio += BString(70000, 0x22);
+      audio += mpegFrame(9, 20);
+    }
+    offsets.push_back(audio.size());
+    // 128kbit/s and 192kbit/s frames: vbr, without a xing header
+    audio += (i % 3 == 0) ? mpegFrame(11, 626) : mpegFrame(9, 417);
+  }
+
+  ID3_Tag tag;
+  ID3_AddTitle(&tag, "Scanned", true);
+  BString data = renderTag(tag);
+  const size_t tagSize = data.size();
+  data += audio;
+  CHECK(writeFile(filename, data));
+
+  ID3_Tag estimated(filename);
+  CHECK(estimated.GetMp3FrameIndex() == NULL);
+  CHECK(estimated.GetMp3HeaderInfo()->frames != FRAMES);
+
+  ID3_Tag scanned;
+  scanned.SetFullScan(true);
+  scanned.Link(filename);
+  const Mp3_Headerinfo* info = scanned.GetMp3HeaderInfo();
+  const ID3_Mp3FrameIndex* index = scanned.GetMp3FrameIndex();
+  CHECK(info != NULL && index != NULL);
+  CHECK(info->frames == FRAMES);
+  CHECK(index->GetFrameCount() == FRAMES);
+  // 3000 frames of 1152 samples at 44.1kHz
+  CHECK(index->GetDuration() == 78367);
+  CHECK(info->time == 78);
+  CHECK(info->vbr_bitrate > 128000 && info->vbr_bitrate < 192000);
+  for (size_t i = 0; i < FRAMES; ++i)
+  {
+    CHECK(index->GetFrameOffset(i) == tagSize + offsets[i]);
+  }
+  CHECK(index->GetEnd() == data.size());
+  CHECK(index->GetFrameAt(index->GetFrameTime(1234) + 1) == 1234);
+
+  // junk before the audio with a lone frame header in it, which is no
+  // place to start
+  data.resize(tagSize);
+  data += mpegFrame(14, 4);
+  data += BString(3000, 0x22);
+  const size_t audioStart = data.size();
+  for (size_t i = 0; i < 10; ++i)
+  {
+    data += mpegFrame(9, 417);
+  }
+  CHECK(writeFile(filename, data));
+
+  ID3_Tag junk;
+  junk.SetFullScan(true);
+  junk.Link(filename);
+  info = junk.GetMp3HeaderInfo();
+  CHECK(info != NULL);
+  CHECK(info->bitrate == MP3BITRATE_128K);
+  CHECK(info->framesize == 417);
+  CHECK(info->frames == 10);
+  CHECK(junk.GetMp3FrameIndex()->GetFrameOffset(0) == audioStart);
+
+  remove(filename);
+  cout << "ok" << endl;
+  return 0;
+}
@@ -0,0 +1,135 @@
+// $Id$
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/tag_snapshot.h"
+#include "id3/tag_view.h"
+#include "id3/misc_support.h"
+#include "id3/io_strings.h"
+#include "id3/readers.h"
+#include "test_helpers.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using namespace dami;
+
+int main(int argc, char *argv[])
+{
+  ID3_Tag tag;
+  ID3_AddTitle(&tag, "Snapshot title", true);
+  ID3_AddArtist(&tag, "Snapshot artist", true);
+  ID3_AddComment(&tag, "A comment", "desc", true);
+  ID3_AddTrack(&tag, 3, 12, true);
+
+  const unicode_t album[] = { 'A', 0x00E9, 'l', 0 };
+  ID3_Frame* frame = new ID3_Frame(ID3FID_ALBUM);
+  frame->GetField(ID3FN_TEXTENC)->Set(ID3TE_UTF16);
+  frame->GetField(ID3FN_TEXT)->SetEncoding(ID3TE_UTF16);
+  frame->GetField(ID3FN_TEXT)->Set(album);
+  tag.AttachFrame(frame);
+
+  const uchar blob[] = { 1, 2, 3, 0, 5 };
+  frame = new ID3_Frame(ID3FID_PRIVATE);
+  frame->GetField(ID3FN_OWNER)->Set("owner");
+  frame->GetField(ID3FN_DATA)->Set(blob, sizeof(blob));
+  frame->SetGroupingID(0x81);
+  tag.AttachFrame(frame);
+
+  // a frame id3lib doesn't know
+  const uchar unknown[] = { 'X', 'Y', 'Z', 'W', 0, 0, 0, 4, 0, 0, 'a', 'b', 'c', 'd' };
+  frame = new ID3_Frame;
+  frame->SetSpec(ID3V2_3_0);
+  ID3_MemoryReader mr(unknown, sizeof(unknown));
+  CHECK(frame->Parse(mr));
+  CHECK(frame->GetID() == ID3FID_NOFRAME);
+  tag.AttachFrame(frame);
+
+  BString data;
+  io::BStringWriter writer(data);
+  const size_t size = ID3_TagSnapshot::Write(tag, writer);
+  CHECK(size == data.size());
+  CHECK(size % 4 == 0);
+
+  // read in place
+  ID3_TagSnapshot snapshot(data.data(), data.size());
+  CHECK(snapshot.IsValid());
+  CHECK(snapshot.NumFrames() == tag.NumFrames());
+  size_t i = snapshot.FindFrame(ID3FID_TITLE);
+  CHECK(i < snapshot.NumFrames());
+  CHECK(String(snapshot.GetTextID(i)) == "TIT2");
+  size_t j = snapshot.FindField(i, ID3FN_TEXT);
+  size_t len = 0;
+  const uchar* text = snapshot.GetRawData(i, j, len);
+  CHECK(String(reinterpret_cast<const char*>(text), len) == "Snapshot title");
+  CHECK(snapshot.GetNumTextItems(i, j) == 1);
+  i = snapshot.FindFrame(ID3FID_PRIVATE);
+  CHECK(i < snapshot.NumFrames());
+  CHECK(snapshot.GetGroupingID(i) == 0x81);
+  j = snapshot.FindField(i, ID3FN_DATA);
+  CHECK(snapshot.GetFieldType(i, j) == ID3FTY_BINARY);
+  const uchar* raw = snapshot.GetRawData(i, j, len);
+  CHECK(len == sizeof(blob) && memcmp(raw, blob, len) == 0);
+  i = snapshot.FindFrame(ID3FID_ALBUM);
+  j = snapshot.FindField(i, ID3FN_TEXT);
+  CHECK(snapshot.GetEncoding(i, j) == ID3TE_UTF16);
+  raw = snapshot.GetRawData(i, j, len);
+  CHECK(len == 3 * sizeof(unicode_t) && memcmp(raw, album, len) == 0);
+  i = snapshot.FindFrame(ID3FID_NOFRAME);
+  CHECK(String(snapshot.GetTextID(i)) == "XYZW");
+  CHECK(snapshot.FindFrame(ID3FID_LYRICIST) == snapshot.NumFrames());
+
+  // and back into a tag
+  ID3_Tag restored;
+  CHECK(ID3_TagSnapshot::Read(restored, data.data(), data.size()));
+  CHECK(restored.NumFrames() == tag.NumFrames());
+  CHECK(renderTag(restored) == renderTag(tag));
+  char* title = ID3_GetTitle(&restored);
+  CHECK(title != NULL && String(title) == "Snapshot title");
+  ID3_FreeString(title);
+  CHECK(ID3_GetTrackNum(&restored) == 3);
+
+  // damaged snapshots are refused
+  CHECK(!snapshot.Open(data.data(), data.size() - 4));
+  BString bad = data;
+  bad[36] = 0xFF;
+  CHECK(!ID3_TagSnapshot::Read(restored, bad.data(), bad.size()));
+  bad = data;
+  bad[8] = ID3_TagSnapshot::SNAPSHOT_VERSION + 1;
+  CHECK(!snapshot.Open(bad.data(), bad.size()));
+
+  // a view owns its snapshot, and finds frames without a cursor
+  ID3_TagView view(tag);
+  CHECK(view.IsValid());
+  CHECK(view.NumFrames() == tag.NumFrames());
+  char buffer[64];
+  i = view.Find(ID3FID_TITLE);
+  CHECK(view.GetText(i, ID3FN_TEXT, buffer, sizeof(buffer)) == 14);
+  CHECK(String(buffer) == "Snapshot title");
+  CHECK(view.GetText(i, ID3FN_TEXT, buffer, 4) == 4);
+  i = view.Find(ID3FID_COMMENT, ID3FN_DESCRIPTION, "desc");
+  CHECK(i < view.NumFrames());
+  CHECK(view.Find(ID3FID_COMMENT, ID3FN_DESCRIPTION, "desc", i + 1) == view.NumFrames());
+  CHECK(view.Find(ID3FID_COMMENT, ID3FN_DESCRIPTION, "other") == view.NumFrames());
+  unicode_t wbuffer[8];
+  i = view.Find(ID3FID_ALBUM);
+  CHECK(view.GetText(i, ID3FN_TEXT, buffer, sizeof(buffer)) == 0);
+  CHECK(view.GetText(i, ID3FN_TEXT, wbuffer, 8) == 3);
+  CHECK(wbuffer[1] == 0x00E9 && wbuffer[3] == 0);
+  i = view.Find(ID3FID_PRIVATE);
+  raw = view.GetBinary(i, ID3FN_DATA, len);
+  CHECK(len == sizeof(blob) && memcmp(raw, blob, len) == 0);
+  CHECK(view.GetBinary(i, ID3FN_OWNER, len) == NULL);
+  CHECK(view.Contains(i, ID3FN_OWNER) && !view.Contains(i, ID3FN_TEXT));
+  ID3_TagView copy(data.data(), data.size());
+  CHECK(copy.IsValid() && copy.NumFrames() == view.NumFrames());
+
+  cout << "ok" << endl;
+  return 0;
+}
@@ -0,0 +1,155 @@
+// $Id$
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/tag_stats.h"
+#include "id3/io_decorators.h"
+#include "id3/readers.h"
+#include "id3/writers.h"
+#include "id3/misc_support.h"
+#include "id3/id3lib_strings.h"
+#include "test_helpers.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using namespace dami;
+
+namespace
+{
+  const char* const FILE_NAME = "test-stats.mp3";
+
+  bool makeFile()
+  {
+    // a few mpeg 1 layer III frames, 128 kbit/s at 44.1 kHz
+    BString data;
+    for (size_t i = 0; i < 8; ++i)
+    {
+      data += mpegFrame(9, 417, 0x00);
+    }
+    return writeFile(FILE_NAME, data);
+  }
+
+  bool isZero(const ID3_TagStats& stats)
+  {
+    for (size_t i = 0; i < ID3_TagStats::NUM_PHASES; ++i)
+    {
+      if (stats.count[i] != 0 || stats.nanos[i] != 0)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  int checkCounting()
+  {
+    const char data[] = "0123456789";
+    ID3_MemoryReader mr(data, 10);
+    ID3_IOStats counts;
+    io::CountingReader cr(mr, counts);
+    char buf[4];
+    CHECK(cr.readChar() == '0');
+    CHECK(cr.peekChar() == '1');
+    CHECK(cr.readChars(buf, 4) == 4 && buf[3] == '4');
+    CHECK(cr.getEnd() == 10);
+    CHECK(cr.setCur(8) == 8);
+    CHECK(cr.readChars(buf, 4) == 2);
+    CHECK(cr.readChar() == ID3_Reader::END_OF_READER);
+    CHECK(counts.bytesRead == 7);
+    CHECK(counts.readCharCalls == 2 && counts.readCharsCalls == 2);
+    CHECK(counts.peekCharCalls == 1 && counts.seeks == 1);
+    CHECK(counts.getEndCalls == 1);
+    CHECK(counts.syscalls == 0 && counts.bytesWritten == 0);
+
+    ID3_IOStats wcounts;
+    uchar out[8];
+    ID3_MemoryWriter mw(out, sizeof(out));
+    io::CountingWriter cw(mw, wcounts);
+    cw.writeChar('a');
+    cw.writeChars("bcd", 3);
+    CHECK(wcounts.bytesWritten == 4);
+    CHECK(wcounts.writeCharCalls == 1 && wcounts.writeCharsCalls == 1);
+    return 0;
+  }
+}
+
+int main()
+{
+  CHECK(checkCounting() == 0);
+  CHECK(makeFile());
+  ID3_TagStats::ClearTotal();
+  {
+    ID3_Tag tag(FILE_NAME);
+    ID3_AddTitle(&tag, "Stats", true);
+    ID3_AddArtist(&tag, "Timer", true);
+    tag.SetUnsync(true);
+    tag.Update(ID3TT_ID3V2 | ID3TT_ID3V1);
+  }
+
+  ID3_Tag tag;
+  tag.Link(FILE_NAME);
+  CHECK(tag.NumFrames() == 2);
+  const ID3_TagStats& stats = tag.GetStats();
+  ID3_TagStats total = ID3_TagStats::GetTotal();
+
+  if (!ID3_TagStats::IsEnabled())
+  {
+    // nothing is kept
+    CHECK(isZero(stats));
+    CHECK(isZero(total));
+    cout << "stats are disabled" << endl;
+    remove(FILE_NAME);
+    return 0;
+  }
+
+  CHECK(stats.count[ID3_TagStats::V2_HEADER] >= 1);
+  CHECK(stats.count[ID3_TagStats::FRAME_PARSE] == 2);
+  CHECK(stats.count[ID3_TagStats::FIELD_DECODE] >= 2);
+  CHECK(stats.count[ID3_TagStats::TAIL_TAGS] == 1);
+  CHECK(stats.count[ID3_TagStats::PADDING_SKIP] == 1);
+  CHECK(stats.count[ID3_TagStats::MP3_PARSE] == 1);
+  CHECK(stats.count[ID3_TagStats::RENDER] == 0);
+  CHECK(stats.calls[ID3_TagStats::LINK] == 1);
+  CHECK(stats.calls[ID3_TagStats::UPDATE] == 0);
+  const ID3_IOStats& linkIO = stats.io[ID3_TagStats::LINK];
+  CHECK(linkIO.bytesRead > 0 && linkIO.bytesWritten == 0);
+  CHECK(linkIO.readCharsCalls > 0 && linkIO.getEndCalls > 0);
+
+  // the tag that wrote the file went through the render phases, and is in
+  // the total along with the one that read it
+  CHECK(total.count[ID3_TagStats::RENDER] == 1);
+  CHECK(total.count[ID3_TagStats::UNSYNC] == 1);
+  CHECK(total.count[ID3_TagStats::FILE_REWRITE] == 1);
+  CHECK(total.count[ID3_TagStats::RENAME] == 1);
+  CHECK(total.count[ID3_TagStats::FRAME_PARSE] == 2);
+  CHECK(total.calls[ID3_TagStats::LINK] == 2);
+  CHECK(total.calls[ID3_TagStats::UPDATE] == 1);
+  CHECK(total.io[ID3_TagStats::UPDATE].bytesWritten > 0);
+
+  tag.Strip(ID3TT_ALL);
+  CHECK(stats.count[ID3_TagStats::FILE_REWRITE] == 1);
+  CHECK(ID3_TagStats::GetTotal().count[ID3_TagStats::FILE_REWRITE] == 2);
+
+  ID3_TagStats::ClearTotal();
+  CHECK(isZero(ID3_TagStats::GetTotal()));
+
+  for (size_t i = 0; i < ID3_TagStats::NUM_PHASES; ++i)
+  {
+    ID3_TagStats::Phase phase = static_cast<ID3_TagStats::Phase>(i);
+    cout << ID3_TagStats::GetPhaseName(phase) << ": " << stats.count[i]
+         << endl;
+  }
+  cout << "link: " << linkIO.bytesRead << " bytes in "
+       << linkIO.readCharCalls + linkIO.readCharsCalls << " reads, "
+       << linkIO.syscallBytes << " bytes in " << linkIO.syscalls
+       << " syscalls" << endl;
+  remove(FILE_NAME);
+  return 0;
+}
@@ -0,0 +1,82 @@
+// $Id$
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/reader.h"
+#include "id3/misc_support.h"
+#include "id3/id3lib_strings.h"
+#include "test_helpers.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using namespace dami;
+
+// Behaves like a pipe: data can only be read forward, and neither the size
+// nor any other position than the current one can be asked for
+class PipeReader : public ID3_Reader
+{
+  const BString& _data;
+  pos_type _cur;
+ public:
+  PipeReader(const BString& data) : _data(data), _cur(0) { ; }
+  virtual void close() { ; }
+  virtual pos_type getCur() { return _cur; }
+  virtual pos_type getEnd() { cerr << "*** getEnd() on a pipe" << endl; abort(); return 0; }
+  virtual pos_type setCur(pos_type) { cerr << "*** setCur() on a pipe" << endl; abort(); return 0; }
+  virtual bool atEnd() { cerr << "*** atEnd() on a pipe" << endl; abort(); return true; }
+  virtual int_type peekChar() { cerr << "*** peekChar() on a pipe" << endl; abort(); return 0; }
+  virtual size_type readChars(char buf[], size_type len)
+  {
+    return this->readChars(reinterpret_cast<char_type *>(buf), len);
+  }
+  virtual size_type readChars(char_type buf[], size_type len)
+  {
+    size_type size = dami::min<size_type>(len, _data.size() - _cur);
+    _data.copy(buf, size, _cur);
+    _cur += size;
+    return size;
+  }
+};
+
+int main(int argc, char *argv[])
+{
+  ID3_Tag tag;
+  ID3_AddTitle(&tag, "Streamed title", true);
+  ID3_AddArtist(&tag, "Streamed artist", true);
+  BString data = renderTag(tag);
+  const size_t tagSize = data.size();
+  CHECK(tagSize > 0);
+
+  // a few mpeg 1 layer III frames, 128 kbit/s at 44.1 kHz
+  for (size_t i = 0; i < 50; ++i)
+  {
+    BString frame = mpegFrame(9, 417, 0x55);
+    frame[3] = 0x44;
+    data += frame;
+  }
+
+  PipeReader pipe(data);
+  ID3_Tag streamed;
+  CHECK(streamed.LinkStream(pipe) == tagSize);
+  CHECK(streamed.HasTagType(ID3TT_ID3V2));
+  CHECK(String(ID3_GetTitle(&streamed)) == "Streamed title");
+  CHECK(String(ID3_GetArtist(&streamed)) == "Streamed artist");
+  const Mp3_Headerinfo* info = streamed.GetMp3HeaderInfo();
+  CHECK(info != NULL);
+  CHECK(info->layer == MPEGLAYER_III);
+  CHECK(info->bitrate == MP3BITRATE_128K);
+  CHECK(info->frequency == 44100);
+  CHECK(info->time == 0);
+  // the lookahead is bounded: the rest of the audio is left in the pipe
+  CHECK(pipe.getCur() < data.size());
+
+  cout << "ok" << endl;
+  return 0;
+}
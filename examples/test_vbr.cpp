@@ -0,0 +1,122 @@
+// $Id$
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/readers.h"
+#include "id3/mp3_vbr.h"
+#include "id3/id3lib_strings.h"
+#include "test_helpers.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using namespace dami;
+
+namespace
+{
+  void putBE(BString& data, size_t pos, uint32 val, size_t len)
+  {
+    for (size_t i = 0; i < len; ++i)
+    {
+      data[pos + i] = (val >> (8 * (len - 1 - i))) & 0xFF;
+    }
+  }
+
+  bool near(uint32 a, uint32 b, uint32 slack)
+  {
+    return a <= b + slack && b <= a + slack;
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  const size_t FRAMES = 1000;
+  BString audio;
+  std::vector<size_t> offsets; // from the start of the vbr frame
+  for (size_t i = 0; i < FRAMES; ++i)
+  {
+    offsets.push_back(417 + audio.size());
+    audio += (i < FRAMES / 2) ? mpegFrame(9, 417) : mpegFrame(14, 1044);
+  }
+  const size_t BYTES = 417 + audio.size();
+
+  // a xing header with a table and a lame extension
+  BString xing = mpegFrame(9, 417);
+  const size_t pos = 4 + 32;
+  memcpy(&xing[pos], "Xing", 4);
+  putBE(xing, pos + 4, 0x0F, 4);
+  putBE(xing, pos + 8, FRAMES, 4);
+  putBE(xing, pos + 12, BYTES, 4);
+  for (size_t i = 0; i < 100; ++i)
+  {
+    xing[pos + 16 + i] = offsets[i * FRAMES / 100] * 256 / BYTES;
+  }
+  putBE(xing, pos + 116, 78, 4);
+  memcpy(&xing[pos + 120], "LAME3.99r", 9);
+  xing[pos + 120 + 9] = 0x13;
+  putBE(xing, pos + 120 + 21, (576 << 12) | 1234, 3);
+
+  BString data = xing + audio;
+  ID3_MemoryReader mr(data.data(), data.size());
+  ID3_Tag tag;
+  tag.Link(mr);
+  const ID3_Mp3VbrHeader* vbr = tag.GetMp3VbrHeader();
+  CHECK(vbr != NULL);
+  CHECK(vbr->GetType() == ID3_Mp3VbrHeader::VBR_XING);
+  CHECK(vbr->GetFrames() == FRAMES && vbr->GetBytes() == BYTES);
+  CHECK(vbr->HasToc() && vbr->GetQuality() == 78);
+  CHECK(vbr->HasLame() && String(vbr->GetEncoder()) == "LAME3.99r");
+  CHECK(vbr->GetRevision() == 1 && vbr->GetVbrMethod() == 3);
+  CHECK(vbr->GetEncoderDelay() == 576 && vbr->GetEncoderPadding() == 1234);
+  // 1000 frames of 1152 samples at 44.1kHz
+  CHECK(vbr->GetDuration() == 26122);
+  CHECK(tag.GetMp3HeaderInfo()->frames == FRAMES);
+  CHECK(tag.GetMp3HeaderInfo()->time == 26);
+
+  CHECK(vbr->TimeToByteOffset(0) == 417);
+  CHECK(vbr->TimeToByteOffset(vbr->GetDuration()) == BYTES);
+  for (size_t i = 0; i < FRAMES; i += 50)
+  {
+    const uint32 ms = i * 1152 * 1000 / 44100;
+    // the table has a resolution of 1/256th of the file
+    CHECK(near(vbr->TimeToByteOffset(ms), offsets[i], BYTES / 256 + 1));
+    CHECK(near(vbr->ByteOffsetToTime(offsets[i]), ms, vbr->GetDuration() / 100));
+  }
+
+  // a vbri header, with a section for every 100 frames, in units of 2 bytes
+  BString vbri = mpegFrame(9, 417);
+  memcpy(&vbri[36], "VBRI", 4);
+  putBE(vbri, 36 + 10, BYTES, 4);
+  putBE(vbri, 36 + 14, FRAMES, 4);
+  putBE(vbri, 36 + 18, 10, 2);
+  putBE(vbri, 36 + 20, 2, 2);
+  putBE(vbri, 36 + 22, 2, 2);
+  putBE(vbri, 36 + 24, 100, 2);
+  for (size_t i = 0; i < 10; ++i)
+  {
+    const size_t next = (i < 9) ? offsets[(i + 1) * 100] : BYTES;
+    putBE(vbri, 36 + 26 + 2 * i, (next - offsets[i * 100]) / 2, 2);
+  }
+  data = vbri + audio;
+  ID3_MemoryReader vr(data.data(), data.size());
+  tag.Link(vr);
+  vbr = tag.GetMp3VbrHeader();
+  CHECK(vbr != NULL && vbr->GetType() == ID3_Mp3VbrHeader::VBR_VBRI);
+  CHECK(vbr->GetFrames() == FRAMES && vbr->HasToc() && !vbr->HasLame());
+  for (size_t i = 0; i < FRAMES; i += 100)
+  {
+    const uint32 ms = (uint32) (i * 1152 * 1000.0 / 44100 + 0.5);
+    // within the frame
+    CHECK(near(vbr->TimeToByteOffset(ms), offsets[i], 1044));
+    CHECK(near(vbr->ByteOffsetToTime(offsets[i]), ms, 1));
+  }
+
+  cout << "ok" << endl;
+  return 0;
+}
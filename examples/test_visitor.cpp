@@ -0,0 +1,137 @@
+// $Id$
+
+#if defined(HAVE_CONFIG_H)
+# include "config.h"
+#endif
+
+#include "id3/id3lib_streams.h"
+#include "id3/tag.h"
+#include "id3/readers.h"
+#include "id3/frame_visitor.h"
+#include "id3/misc_support.h"
+#include "id3/id3lib_strings.h"
+#include "test_helpers.h"
+
+using std::cout;
+using std::endl;
+using std::cerr;
+
+using namespace dami;
+
+class TextCollector : public ID3_FrameVisitor
+{
+ public:
+  String texts;
+  size_t frames;
+  size_t ended;
+  flags_t lyricsFlags;
+  ID3_FrameID current;
+  TextCollector() : frames(0), ended(0), lyricsFlags(0), current(ID3FID_NOFRAME) { ; }
+  bool VisitFrame(ID3_FrameID id, const char* textID, flags_t flags)
+  {
+    ++frames;
+    current = id;
+    if (id == ID3FID_UNSYNCEDLYRICS)
+    {
+      lyricsFlags = flags;
+    }
+    return id != ID3FID_LEADARTIST;
+  }
+  void VisitText(ID3_FieldID fld, ID3_TextEnc enc, const uchar* data, size_t len)
+  {
+    texts += String(reinterpret_cast<const char*>(data), len) + "|";
+  }
+  void EndFrame() { ++ended; }
+};
+
+// what the visitor sees of the fields that aren't text or descriptions
+class FieldCollector : public ID3_FrameVisitor
+{
+ public:
+  String mimeType, url;
+  uint32 pictureType;
+  size_t dataSize;
+  FieldCollector() : pictureType(0), dataSize(0) { ; }
+  void VisitInteger(ID3_FieldID fld, uint32 val)
+  {
+    if (fld == ID3FN_PICTURETYPE)
+    {
+      pictureType = val;
+    }
+  }
+  void VisitText(ID3_FieldID fld, ID3_TextEnc enc, const uchar* data, size_t len)
+  {
+    if (fld == ID3FN_MIMETYPE)
+    {
+      mimeType = String(reinterpret_cast<const char*>(data), len);
+    }
+    else if (fld == ID3FN_URL)
+    {
+      url = String(reinterpret_cast<const char*>(data), len);
+    }
+  }
+  void VisitBinary(ID3_FieldID fld, const uchar* data, size_t len)
+  {
+    dataSize = len;
+  }
+};
+
+int main(int argc, char *argv[])
+{
+  String lyrics(2000, 'l');
+  ID3_Tag tag;
+  ID3_AddTitle(&tag, "Visited title", true);
+  ID3_AddArtist(&tag, "Skipped artist", true);
+  ID3_AddComment(&tag, "Some comment", "desc", true);
+  ID3_AddLyrics(&tag, lyrics.c_str(), true);
+  tag.Find(ID3FID_UNSYNCEDLYRICS)->SetCompression(true);
+
+  BString data = renderTag(tag);
+  size_t tagSize = data.size();
+
+  ID3_MemoryReader mr(data.data(), tagSize);
+  TextCollector visitor;
+  CHECK(ID3_VisitFrames(mr, visitor) == tagSize);
+  CHECK(visitor.frames == 4);
+  CHECK(visitor.ended == 3);
+  CHECK(visitor.lyricsFlags & ID3_FrameVisitor::FRAME_COMPRESSED);
+  CHECK(visitor.texts == "Visited title|XXX|desc|Some comment|XXX||" + lyrics + "|");
+
+  // the mime type and the url aren't encodable, and stay ascii in a frame
+  // of utf-16 text
+  ID3_Tag utf16;
+  ID3_Frame* apic = new ID3_Frame(ID3FID_PICTURE);
+  apic->GetField(ID3FN_TEXTENC)->Set(ID3TE_UTF16);
+  apic->GetField(ID3FN_DESCRIPTION)->SetEncoding(ID3TE_UTF16);
+  apic->GetField(ID3FN_DESCRIPTION)->Set("cover");
+  apic->GetField(ID3FN_MIMETYPE)->Set("image/jpeg");
+  apic->GetField(ID3FN_PICTURETYPE)->Set(ID3PT_COVERFRONT);
+  apic->GetField(ID3FN_DATA)->Set(reinterpret_cast<const uchar*>("\xFF\xD8\xFF\xE0"), 4);
+  utf16.AttachFrame(apic);
+  ID3_Frame* wxxx = new ID3_Frame(ID3FID_WWWUSER);
+  wxxx->GetField(ID3FN_TEXTENC)->Set(ID3TE_UTF16);
+  wxxx->GetField(ID3FN_DESCRIPTION)->SetEncoding(ID3TE_UTF16);
+  wxxx->GetField(ID3FN_DESCRIPTION)->Set("home");
+  wxxx->GetField(ID3FN_URL)->Set("http://id3lib.sourceforge.net/");
+  utf16.AttachFrame(wxxx);
+  data = renderTag(utf16);
+  tagSize = data.size();
+
+  ID3_Tag parsed;
+  parsed.Parse(reinterpret_cast<const uchar*>(data.data()), tagSize);
+  const ID3_Frame* pic = parsed.Find(ID3FID_PICTURE);
+  const ID3_Frame* www = parsed.Find(ID3FID_WWWUSER);
+  CHECK(pic != NULL && www != NULL);
+
+  ID3_MemoryReader mr2(data.data(), tagSize);
+  FieldCollector fields;
+  CHECK(ID3_VisitFrames(mr2, fields) == tagSize);
+  CHECK(fields.mimeType == pic->GetField(ID3FN_MIMETYPE)->GetRawText());
+  CHECK(fields.mimeType == "image/jpeg");
+  CHECK(fields.pictureType == pic->GetField(ID3FN_PICTURETYPE)->Get());
+  CHECK(fields.dataSize == pic->GetField(ID3FN_DATA)->Size());
+  CHECK(fields.url == www->GetField(ID3FN_URL)->GetRawText());
+
+  cout << "ok" << endl;
+  return 0;
+}
@@ -0,0 +1,77 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a software library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_AUDIO_HASH_H_
+#define _ID3LIB_AUDIO_HASH_H_
+
+#include <id3/globals.h>
+
+class ID3_Reader;
+class ID3_Tag;
+
+class ID3_CPP_EXPORT ID3_AudioHash
+{
+public:
+  enum
+  {
+    HASH_SIZE   = 16,
+    SHA256_SIZE = 32
+  };
+
+  ID3_AudioHash(bool sha256 = false);
+
+  void   Clear();
+  void   Update(const uchar*, size_t);
+  void   Finish();
+
+  bool   Compute(const ID3_Tag&);
+  bool   Compute(ID3_Reader&, size_t beg, size_t end);
+
+  size_t GetSize() const { return _size; }
+  uint64 GetHash64() const { return _h1; }
+  const uchar* GetHash() const { return _hash; }
+  bool   HasSha256() const { return _has_sha256; }
+  const uchar* GetSha256() const { return _has_sha256 ? _sha256 : NULL; }
+
+private:
+  void   HashBlock(const uchar*);
+  void   Sha256Block(const uchar*);
+
+  uint64 _h1;
+  uint64 _h2;
+  uchar  _tail[16];         // bytes not hashed yet, up to a full block
+  size_t _size;             // the number of bytes hashed so far
+  uchar  _hash[HASH_SIZE];  // after Finish()
+
+  bool   _has_sha256;
+  uint32 _state[8];
+  uchar  _block[64];
+  uchar  _sha256[SHA256_SIZE];
+};
+
+#endif /* _ID3LIB_AUDIO_HASH_H_ */
@@ -0,0 +1,60 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a software library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_FRAME_VISITOR_H_
+#define _ID3LIB_FRAME_VISITOR_H_
+
+#include <id3/globals.h>
+
+class ID3_Reader;
+
+class ID3_CPP_EXPORT ID3_FrameVisitor
+{
+public:
+
+  enum
+  {
+    FRAME_COMPRESSED = 1 << 0,
+    FRAME_ENCRYPTED  = 1 << 1,
+    FRAME_GROUPED    = 1 << 2,
+    FRAME_UNSYNCED   = 1 << 3,
+    FRAME_READONLY   = 1 << 4
+  };
+
+  virtual ~ID3_FrameVisitor() { ; }
+
+  virtual bool VisitFrame(ID3_FrameID, const char* /* textID */, flags_t) { return true; }
+  virtual void VisitInteger(ID3_FieldID, uint32) { ; }
+  virtual void VisitText(ID3_FieldID, ID3_TextEnc, const uchar*, size_t) { ; }
+  virtual void VisitBinary(ID3_FieldID, const uchar*, size_t) { ; }
+  virtual void EndFrame() { ; }
+};
+
+ID3_C_EXPORT size_t ID3_VisitFrames(ID3_Reader&, ID3_FrameVisitor&);
+
+#endif /* _ID3LIB_FRAME_VISITOR_H_ */
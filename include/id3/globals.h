@@ -179,6 +179,7 @@ ID3_ENUM(ID3_TagType)
   ID3TT_LYRICS3    = 1 << 2,   /**< Represents a Lyrics3 tag */
   ID3TT_LYRICS3V2  = 1 << 3,   /**< Represents a Lyrics3 v2.00 tag */
   ID3TT_MUSICMATCH = 1 << 4,   /**< Represents a MusicMatch tag */
+  ID3TT_ID3V2APPENDED = 1 << 5,/**< Represents an id3v2.4 tag with a footer at the end of the file */
    /**< Represents a Lyrics3 tag (for backwards compatibility) */
   ID3TT_LYRICS     = ID3TT_LYRICS3,
   /** Represents both id3 tags: id3v1 and id3v2 */
@@ -220,6 +221,12 @@ ID3_ENUM(ID3_FieldID)
   ID3FN_PEAKVOLLEFT,    /**< Peak volume on the left channel */
   ID3FN_TIMESTAMPFORMAT,/**< SYLT Timestamp Format */
   ID3FN_CONTENTTYPE,    /**< SYLT content type */
+  ID3FN_SEEKOFFSET,     /**< SEEK minimum offset to the next tag */
+  ID3FN_FRAMESBETWEEN,  /**< MLLT mpeg frames between references */
+  ID3FN_BYTESBETWEEN,   /**< MLLT bytes between references */
+  ID3FN_MSBETWEEN,      /**< MLLT milliseconds between references */
+  ID3FN_BYTESDEVBITS,   /**< MLLT bits for the bytes deviation */
+  ID3FN_MSDEVBITS,      /**< MLLT bits for the milliseconds deviation */
   ID3FN_LASTFIELDID     /**< Last field placeholder */
 };
 
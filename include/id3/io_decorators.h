@@ -31,6 +31,7 @@
 #include "readers.h"
 #include "io_helpers.h"
 #include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
+#include "id3/tag_stats.h"
 
 namespace dami
 {
@@ -89,6 +90,92 @@ namespace dami
       void close() { ; }
     };
 
+    /**
+     * Keeps the last bytes of another reader in memory, read with a single
+     * seek, so that looking for the tags at the end of a file doesn't cost a
+     * seek and a read for each guess.  Reads before that block go to the
+     * other reader.
+     */
+    class ID3_CPP_EXPORT TailBufferedReader : public ID3_Reader
+    {
+      typedef ID3_Reader SUPER;
+
+      ID3_Reader& _reader;
+      BString _tail;
+      pos_type _beg, _end;
+      pos_type _tailBeg;   // where the bytes in _tail come from
+      pos_type _cur;
+
+     public:
+      TailBufferedReader(ID3_Reader& reader, size_type size);
+
+      void close() { ; }
+      pos_type getBeg() { return _beg; }
+      pos_type getCur() { return _cur; }
+      pos_type getEnd() { return _end; }
+      pos_type setCur(pos_type cur)
+      {
+        _cur = mid(_beg, cur, _end);
+        return _cur;
+      }
+
+      int_type peekChar();
+      size_type readChars(char_type buf[], size_type len);
+      size_type readChars(char buf[], size_type len)
+      {
+        return this->readChars((char_type*) buf, len);
+      }
+    };
+
+    /**
+     * Passes everything on to another reader, and counts the calls and the
+     * bytes read in an ID3_IOStats.
+     */
+    class ID3_CPP_EXPORT CountingReader : public ID3_Reader
+    {
+      typedef ID3_Reader SUPER;
+
+      ID3_Reader& _reader;
+      ID3_IOStats& _stats;
+
+     public:
+      CountingReader(ID3_Reader& reader, ID3_IOStats& stats)
+        : _reader(reader), _stats(stats) { ; }
+
+      const ID3_IOStats& getStats() const { return _stats; }
+
+      void close() { ; }
+      pos_type getBeg() { return _reader.getBeg(); }
+      pos_type getCur() { return _reader.getCur(); }
+      pos_type getEnd()
+      {
+        _stats.getEndCalls++;
+        return _reader.getEnd();
+      }
+      pos_type setCur(pos_type cur)
+      {
+        _stats.seeks++;
+        return _reader.setCur(cur);
+      }
+
+      int_type readChar();
+      int_type peekChar()
+      {
+        _stats.peekCharCalls++;
+        return _reader.peekChar();
+      }
+      size_type readChars(char_type buf[], size_type len);
+      size_type readChars(char buf[], size_type len)
+      {
+        return this->readChars((char_type*) buf, len);
+      }
+      size_type skipChars(size_type len)
+      {
+        _stats.seeks++;
+        return _reader.skipChars(len);
+      }
+    };
+
     class ID3_CPP_EXPORT CharReader : public ID3_Reader
     {
       typedef ID3_Reader SUPER;
@@ -184,6 +271,42 @@ namespace dami
       pos_type getEnd() { return _writer.getEnd(); }
     };
 
+    /**
+     * Passes everything on to another writer, and counts the calls and the
+     * bytes written in an ID3_IOStats.
+     */
+    class ID3_CPP_EXPORT CountingWriter : public ID3_Writer
+    {
+      typedef ID3_Writer SUPER;
+
+      ID3_Writer& _writer;
+      ID3_IOStats& _stats;
+
+     public:
+      CountingWriter(ID3_Writer& writer, ID3_IOStats& stats)
+        : _writer(writer), _stats(stats) { ; }
+
+      const ID3_IOStats& getStats() const { return _stats; }
+
+      void close() { ; }
+      void flush() { _writer.flush(); }
+
+      pos_type getBeg() { return _writer.getBeg(); }
+      pos_type getCur() { return _writer.getCur(); }
+      pos_type getEnd()
+      {
+        _stats.getEndCalls++;
+        return _writer.getEnd();
+      }
+
+      int_type writeChar(char_type ch);
+      size_type writeChars(const char_type buf[], size_type len);
+      size_type writeChars(const char buf[], size_type len)
+      {
+        return this->writeChars(reinterpret_cast<const char_type*>(buf), len);
+      }
+    };
+
     class CompressedWriter : public ID3_Writer
     {
       typedef ID3_Writer SUPER;
@@ -132,6 +132,9 @@ ID3_C_EXPORT char *ID3_GetDescriptionOfPicType(ID3_Tag*, ID3_PictureType pictype
 //following routine courtesy of John George
 ID3_C_EXPORT size_t ID3_RemovePictureType(ID3_Tag*, ID3_PictureType pictype);
 
+ID3_C_EXPORT ID3_Frame* ID3_AddMpegLookupTable(ID3_Tag*, size_t framesBetween,
+                                               bool replace = false);
+
 
 #endif /* _ID3LIB_MISC_SUPPORT_H_ */
 
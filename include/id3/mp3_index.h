@@ -0,0 +1,111 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a software library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_MP3_INDEX_H_
+#define _ID3LIB_MP3_INDEX_H_
+
+#include <vector>
+#include <map>
+#include <id3/globals.h>
+
+class ID3_Frame;
+
+class ID3_CPP_EXPORT ID3_Mp3FrameIndex
+{
+public:
+  ID3_Mp3FrameIndex();
+
+  void   Clear();
+  void   SetFormat(uint32 frequency, uint32 samplesPerFrame);
+  void   AddFrame(size_t offset, size_t size);
+  void   Append(const ID3_Mp3FrameIndex&);
+  void   AddCrcResult(Mp3_Crc);
+
+  size_t GetFrameCount() const { return _count; }
+  size_t GetFrameOffset(size_t frame) const;
+  uint32 GetFrequency() const { return _frequency; }
+  uint32 GetSamplesPerFrame() const { return _samples_per_frame; }
+
+  size_t GetAudioBytes() const { return _audio_bytes; }
+  size_t GetEnd() const { return _end; }
+  uint32 GetDuration() const;
+  uint32 GetFrameTime(size_t frame) const;
+  size_t GetFrameAt(uint32 ms) const;
+
+  size_t GetCrcFrameCount() const { return _crc_frames; }
+  size_t GetCrcErrorCount() const { return _crc_errors.size(); }
+  size_t GetCrcError(size_t num) const;
+
+private:
+  // frame offsets are stored as the distance to the previous frame, with
+  // the absolute offset of every MARK_INTERVAL'th frame to start from
+  enum { MARK_INTERVAL = 64 };
+
+  std::vector<size_t> _marks;
+  std::vector<uint16> _steps;  // 0 if the step didn't fit, see _far
+  std::map<size_t, size_t> _far;
+  size_t _count;
+  size_t _last;
+  size_t _end;
+  size_t _audio_bytes;
+  uint32 _frequency;
+  uint32 _samples_per_frame;
+  size_t _crc_frames;                // the number of frames with a crc
+  std::vector<size_t> _crc_errors;   // the frames whose crc doesn't match
+};
+
+class ID3_CPP_EXPORT ID3_Mp3LookupTable
+{
+public:
+  ID3_Mp3LookupTable();
+
+  void   Clear();
+  bool   Build(const ID3_Mp3FrameIndex&, size_t framesBetween);
+  bool   Parse(const ID3_Frame&, size_t base = 0);
+  bool   Render(ID3_Frame&) const;
+
+  size_t GetReferenceCount() const { return _offsets.size(); }
+  size_t GetFramesBetween() const { return _frames_between; }
+  size_t GetReferenceOffset(size_t ref) const;
+  uint32 GetReferenceTime(size_t ref) const;
+
+  size_t TimeToByteOffset(uint32 ms) const;
+  uint32 ByteOffsetToTime(size_t offset) const;
+
+private:
+  size_t _base;             // the file offset the references count from
+  size_t _frames_between;
+  uint32 _bytes_between;
+  uint32 _ms_between;
+  uint32 _bytes_bits;       // the size of each bytes deviation, in bits
+  uint32 _ms_bits;          // the size of each milliseconds deviation
+  std::vector<size_t> _offsets;  // from _base, starting with 0
+  std::vector<uint32> _times;    // in milliseconds, starting with 0
+};
+
+#endif /* _ID3LIB_MP3_INDEX_H_ */
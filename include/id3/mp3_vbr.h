@@ -0,0 +1,101 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a software library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_MP3_VBR_H_
+#define _ID3LIB_MP3_VBR_H_
+
+#include <vector>
+#include <id3/globals.h>
+
+class ID3_CPP_EXPORT ID3_Mp3VbrHeader
+{
+public:
+
+  enum
+  {
+    VBR_NONE,
+    VBR_XING,        // "Xing": a vbr file
+    VBR_INFO,        // "Info": the same, written by LAME for a cbr file
+    VBR_VBRI         // "VBRI": the Fraunhofer header
+  };
+
+  ID3_Mp3VbrHeader();
+
+  void   Clear();
+  bool   Parse(const uchar* frame, size_t size, size_t offset, size_t mp3size);
+
+  int    GetType() const { return _type; }
+  uint32 GetFrames() const { return _frames; }
+  uint32 GetBytes() const { return _bytes; }
+  int32  GetQuality() const { return _quality; }
+  bool   HasToc() const;
+  uint32 GetDuration() const;
+
+  bool   HasLame() const { return _encoder[0] != '\0'; }
+  const char* GetEncoder() const { return _encoder; }
+  uint32 GetRevision() const { return _revision; }
+  uint32 GetVbrMethod() const { return _vbr_method; }
+  uint32 GetLowpass() const { return _lowpass; }
+  uint32 GetEncoderDelay() const { return _encoder_delay; }
+  uint32 GetEncoderPadding() const { return _encoder_padding; }
+  uint32 GetMusicLength() const { return _music_length; }
+  uint16 GetMusicCrc() const { return _music_crc; }
+
+  size_t TimeToByteOffset(uint32 ms) const;
+  uint32 ByteOffsetToTime(size_t offset) const;
+
+private:
+  bool   ParseXing(const uchar* frame, size_t size, size_t pos);
+  bool   ParseVbri(const uchar* frame, size_t size, size_t pos);
+  void   ParseLame(const uchar* data);
+
+  int    _type;
+  size_t _offset;           // the file offset of the frame with the header
+  size_t _audio;            // the file offset of the first audio frame
+  uint32 _frames;           // the number of audio frames, 0 if unknown
+  uint32 _bytes;            // the size of the mpeg data, vbr frame included
+  int32  _quality;          // -1 if unknown
+  uint32 _frequency;
+  uint32 _samples_per_frame;
+
+  uchar  _toc[100];         // Xing: the position at each percent of playtime
+  bool   _has_toc;
+  std::vector<size_t> _sections;  // VBRI: the offsets of the toc entries
+  uint32 _frames_per_section;
+
+  char   _encoder[10];      // LAME: "LAME3.99r", or empty
+  uint32 _revision;
+  uint32 _vbr_method;
+  uint32 _lowpass;          // in Hz
+  uint32 _encoder_delay;    // in samples
+  uint32 _encoder_padding;  // in samples
+  uint32 _music_length;     // in bytes, from the vbr frame on
+  uint16 _music_crc;
+};
+
+#endif /* _ID3LIB_MP3_VBR_H_ */
@@ -0,0 +1,76 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a software library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_PUSH_PARSER_H_
+#define _ID3LIB_PUSH_PARSER_H_
+
+#include <id3/id3lib_frame.h>
+#include <id3/id3lib_strings.h>
+
+class ID3_CPP_EXPORT ID3_PushParser
+{
+public:
+
+  class Handler
+  {
+  public:
+    virtual ~Handler() { ; }
+    virtual void OnTagHeader(ID3_V2Spec, size_t /* tagSize */) { ; }
+    virtual void OnFrame(const ID3_Frame&) = 0;
+    virtual void OnTagEnd() { ; }
+  };
+
+  ID3_PushParser(Handler&);
+  virtual ~ID3_PushParser() { ; }
+
+  void       Reset();
+  size_t     Feed(const uchar* data, size_t len);
+
+  bool       IsDone() const;
+  bool       HasTag() const { return _tag_size > 0; }
+  size_t     GetTagSize() const { return _tag_size; }
+  ID3_V2Spec GetSpec() const { return _spec; }
+
+private:
+  size_t     FeedBody(const uchar* data, size_t len);
+  void       Advance();
+  void       EndOfFrames();
+
+  Handler&     _handler;
+  int          _state;
+  dami::BString _buffer;       // the header or frame being collected
+  size_t       _needed;        // the size _buffer has to grow to
+  size_t       _remaining;     // raw bytes left in the tag's frame data
+  size_t       _tag_size;      // header, frames, padding and footer
+  ID3_V2Spec   _spec;
+  bool         _unsync;        // resync the data while it comes in?
+  bool         _footer;        // an id3v2.4.0 footer follows the data?
+  bool         _last_ff;       // the last raw byte was 0xFF
+};
+
+#endif /* _ID3LIB_PUSH_PARSER_H_ */
@@ -36,12 +36,16 @@
 class ID3_Reader;
 class ID3_Writer;
 class ID3_TagImpl;
+class ID3_Mp3FrameIndex;
+class ID3_Mp3VbrHeader;
 class ID3_Tag;
+struct ID3_TagStats;
 
 class ID3_CPP_EXPORT ID3_Tag
 {
   ID3_TagImpl* _impl;
   char _tmp_filename[ID3_PATH_LENGTH];
+  friend class ID3_TagBatch;  // links the tags of many files at once
 public:
 
   class Iterator
@@ -75,6 +79,12 @@ public:
   bool       GetExperimental() const;
 
   bool       SetPadding(bool);
+  bool       SetAppend(bool);
+  bool       GetAppend() const;
+  bool       SetFullScan(bool);
+  bool       GetFullScan() const;
+  bool       SetCrcCheck(bool);
+  bool       GetCrcCheck() const;
 
   void       AddFrame(const ID3_Frame&);
   void       AddFrame(const ID3_Frame*);
@@ -88,13 +98,17 @@ public:
 
   size_t     Link(const char *fileInfo, flags_t = (flags_t) ID3TT_ALL);
   size_t     Link(ID3_Reader &reader, flags_t = (flags_t) ID3TT_ALL);
+  size_t     LinkStream(ID3_Reader &reader, flags_t = (flags_t) ID3TT_ID3V2);
   flags_t    Update(flags_t = (flags_t) ID3TT_ALL);
   flags_t    Strip(flags_t = (flags_t) ID3TT_ALL);
 
   size_t     GetPrependedBytes() const;
   size_t     GetAppendedBytes() const;
+  size_t     GetAudioOffset() const;
+  size_t     GetAudioSize() const;
   size_t     GetFileSize() const;
   const char* GetFileName() const;
+  const ID3_TagStats& GetStats() const;
 
   ID3_Frame* Find(ID3_FrameID) const;
   ID3_Frame* Find(ID3_FrameID, ID3_FieldID, uint32) const;
@@ -104,6 +118,8 @@ public:
   size_t     NumFrames() const;
 
   const Mp3_Headerinfo* GetMp3HeaderInfo() const;
+  const ID3_Mp3FrameIndex* GetMp3FrameIndex() const;
+  const ID3_Mp3VbrHeader* GetMp3VbrHeader() const;
 
   Iterator*  CreateIterator();
   ConstIterator* CreateIterator() const;
@@ -0,0 +1,69 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a software library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_TAG_CACHE_H_
+#define _ID3LIB_TAG_CACHE_H_
+
+#include <id3/globals.h>
+
+class ID3_Reader;
+class ID3_TagImpl;
+class ID3_TagCacheImpl;
+
+class ID3_CPP_EXPORT ID3_TagCache
+{
+public:
+  ID3_TagCache();
+  ~ID3_TagCache();
+
+  bool   Open(const char* path);
+  bool   Flush();
+  void   Close();
+  bool   IsOpen() const;
+
+  size_t NumEntries() const;
+  size_t GetHits() const;
+  size_t GetMisses() const;
+
+  static void SetDefault(ID3_TagCache*);
+  static ID3_TagCache* GetDefault();
+
+private:
+  friend class ID3_TagImpl;
+
+  bool   Find(const char* name, ID3_TagImpl&);
+  void   Store(int fd, const ID3_TagImpl&, ID3_Reader&);
+  void   Remove(const char* name);
+
+  ID3_TagCache(const ID3_TagCache&);
+  ID3_TagCache& operator=(const ID3_TagCache&);
+
+  ID3_TagCacheImpl* _impl;
+};
+
+#endif /* _ID3LIB_TAG_CACHE_H_ */
@@ -0,0 +1,86 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a software library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_TAG_SNAPSHOT_H_
+#define _ID3LIB_TAG_SNAPSHOT_H_
+
+#include <id3/globals.h>
+
+class ID3_Writer;
+class ID3_Tag;
+
+class ID3_CPP_EXPORT ID3_TagSnapshot
+{
+public:
+  enum
+  {
+    SNAPSHOT_VERSION = 1
+  };
+
+  static size_t Write(const ID3_Tag&, ID3_Writer&);
+  static bool   Read(ID3_Tag&, const uchar*, size_t);
+
+  ID3_TagSnapshot();
+  ID3_TagSnapshot(const uchar*, size_t);
+
+  bool        Open(const uchar*, size_t);
+  bool        IsValid() const { return _data != NULL; }
+  const uchar* GetData() const { return _data; }
+  size_t      Size() const { return _size; }
+
+  flags_t     GetFileTags() const;
+  ID3_V2Spec  GetSpec() const;
+  size_t      GetPrependedBytes() const;
+  size_t      GetAppendedBytes() const;
+
+  size_t      NumFrames() const;
+  size_t      FindFrame(ID3_FrameID, size_t from = 0) const;
+  ID3_FrameID GetFrameID(size_t frame) const;
+  const char* GetTextID(size_t frame) const;
+  flags_t     GetFrameFlags(size_t frame) const;
+  uchar       GetEncryptionID(size_t frame) const;
+  uchar       GetGroupingID(size_t frame) const;
+
+  size_t      NumFields(size_t frame) const;
+  size_t      FindField(size_t frame, ID3_FieldID) const;
+  ID3_FieldID GetFieldID(size_t frame, size_t field) const;
+  ID3_FieldType GetFieldType(size_t frame, size_t field) const;
+  ID3_TextEnc GetEncoding(size_t frame, size_t field) const;
+  size_t      GetNumTextItems(size_t frame, size_t field) const;
+  uint32      GetInteger(size_t frame, size_t field) const;
+  const uchar* GetRawData(size_t frame, size_t field, size_t& size) const;
+
+private:
+  const uchar* GetFrame(size_t frame) const;
+  const uchar* GetField(size_t frame, size_t field) const;
+
+  const uchar* _data;
+  size_t       _size;
+};
+
+#endif /* _ID3LIB_TAG_SNAPSHOT_H_ */
@@ -0,0 +1,101 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a software library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_TAG_STATS_H_
+#define _ID3LIB_TAG_STATS_H_
+
+#include <id3/globals.h>
+
+struct ID3_CPP_EXPORT ID3_IOStats
+{
+  // what the parsers asked of the reader, or the renderers of the writer
+  uint64 bytesRead;
+  uint64 bytesWritten;
+  uint32 readCharCalls;
+  uint32 readCharsCalls;
+  uint32 peekCharCalls;
+  uint32 writeCharCalls;
+  uint32 writeCharsCalls;
+  uint32 seeks;               // setCur() and skipChars()
+  uint32 getEndCalls;
+  // and the reads, writes and copies of the file underneath that it took
+  uint32 syscalls;
+  uint64 syscallBytes;
+
+  ID3_IOStats() { this->Clear(); }
+
+  void Clear();
+  void Add(const ID3_IOStats&);
+};
+
+struct ID3_CPP_EXPORT ID3_TagStats
+{
+  enum Phase
+  {
+    // Link()
+    V2_HEADER = 0,
+    FRAME_PARSE,
+    FIELD_DECODE,
+    TEXT_CONVERT,
+    TAIL_TAGS,
+    PADDING_SKIP,
+    SYNC_SEARCH,
+    MP3_PARSE,
+    // Update() and Strip()
+    RENDER,
+    COMPRESS,
+    UNSYNC,
+    FILE_REWRITE,
+    RENAME,
+    NUM_PHASES
+  };
+
+  enum Operation
+  {
+    LINK = 0,
+    UPDATE,                   // and Strip()
+    NUM_OPERATIONS
+  };
+
+  uint32 count[NUM_PHASES];   // times the phase was gone through
+  uint64 nanos[NUM_PHASES];   // time spent in it
+  uint32 calls[NUM_OPERATIONS];
+  ID3_IOStats io[NUM_OPERATIONS];
+
+  ID3_TagStats() { this->Clear(); }
+
+  void Clear();
+  void Add(const ID3_TagStats&);
+
+  static const char*  GetPhaseName(Phase);
+  static bool         IsEnabled();
+  static ID3_TagStats GetTotal();
+  static void         ClearTotal();
+};
+
+#endif /* _ID3LIB_TAG_STATS_H_ */
@@ -0,0 +1,66 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a software library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_TAG_VIEW_H_
+#define _ID3LIB_TAG_VIEW_H_
+
+#include <id3/tag_snapshot.h>
+
+class ID3_Tag;
+
+class ID3_CPP_EXPORT ID3_TagView
+{
+public:
+  ID3_TagView(const ID3_Tag&);
+  ID3_TagView(const uchar*, size_t);
+  ~ID3_TagView();
+
+  bool        IsValid() const { return _snapshot.IsValid(); }
+  const ID3_TagSnapshot& GetSnapshot() const { return _snapshot; }
+
+  size_t      NumFrames() const { return _snapshot.NumFrames(); }
+  ID3_FrameID GetFrameID(size_t frame) const { return _snapshot.GetFrameID(frame); }
+  size_t      Find(ID3_FrameID, size_t from = 0) const;
+  size_t      Find(ID3_FrameID, ID3_FieldID, uint32, size_t from = 0) const;
+  size_t      Find(ID3_FrameID, ID3_FieldID, const char*, size_t from = 0) const;
+
+  bool        Contains(size_t frame, ID3_FieldID) const;
+  uint32      GetInteger(size_t frame, ID3_FieldID) const;
+  size_t      GetText(size_t frame, ID3_FieldID, char*, size_t) const;
+  size_t      GetText(size_t frame, ID3_FieldID, unicode_t*, size_t) const;
+  const uchar* GetBinary(size_t frame, ID3_FieldID, size_t& size) const;
+
+private:
+  ID3_TagView(const ID3_TagView&);
+  ID3_TagView& operator=(const ID3_TagView&);
+
+  uchar*          _data;
+  ID3_TagSnapshot _snapshot;
+};
+
+#endif /* _ID3LIB_TAG_VIEW_H_ */
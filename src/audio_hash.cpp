@@ -0,0 +1,357 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#if defined HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include "id3/audio_hash.h"
+#include "id3/readers.h"
+#include "id3/tag.h"
+#include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
+
+using namespace dami;
+
+namespace
+{
+  // the audio is read in blocks this big
+  const size_t HASH_BLOCK = 1024 * 1024;
+
+  inline uint64 make64(uint32 hi, uint32 lo)
+  {
+    return (uint64(hi) << 32) | lo;
+  }
+
+  inline uint64 rotl64(uint64 x, int r)
+  {
+    return (x << r) | (x >> (64 - r));
+  }
+
+  inline uint32 rotr32(uint32 x, int r)
+  {
+    return (x >> r) | (x << (32 - r));
+  }
+
+  inline uint64 readLE64(const uchar* data)
+  {
+    uint64 val = 0;
+    for (int i = 7; i >= 0; --i)
+    {
+      val = (val << 8) | data[i];
+    }
+    return val;
+  }
+
+  inline void writeLE64(uchar* data, uint64 val)
+  {
+    for (int i = 0; i < 8; ++i, val >>= 8)
+    {
+      data[i] = static_cast<uchar>(val & 0xFF);
+    }
+  }
+
+  inline uint64 fmix64(uint64 k)
+  {
+    k ^= k >> 33;
+    k *= make64(0xff51afd7, 0xed558ccd);
+    k ^= k >> 33;
+    k *= make64(0xc4ceb9fe, 0x1a85ec53);
+    k ^= k >> 33;
+    return k;
+  }
+
+  // MurmurHash3 x64 128, with a seed of 0
+  const uint64 C1 = make64(0x87c37b91, 0x114253d5);
+  const uint64 C2 = make64(0x4cf5ad43, 0x2745937f);
+
+  inline uint64 mixK1(uint64 k1)
+  {
+    k1 *= C1;
+    k1 = rotl64(k1, 31);
+    return k1 * C2;
+  }
+
+  inline uint64 mixK2(uint64 k2)
+  {
+    k2 *= C2;
+    k2 = rotl64(k2, 33);
+    return k2 * C1;
+  }
+
+  const uint32 SHA256_K[64] =
+  {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+  };
+
+  const uint32 SHA256_INIT[8] =
+  {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+    0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+  };
+}
+
+/** \class ID3_AudioHash audio_hash.h id3/audio_hash.h
+ ** \brief A hash of the audio of a file, without its tags.
+ **
+ ** Two files with the same audio but different tags get the same hash,
+ ** which makes finding duplicates in a collection cheap.  The hash is the
+ ** 128 bit MurmurHash3 (x64 variant) of exactly the bytes from the first
+ ** mpeg frame to the first tag at the end of the file, as found by Link().
+ ** Its first 64 bits make a smaller hash.  A SHA-256 of the same bytes can
+ ** be had as well, at a far higher cost.
+ **
+ ** \code
+ **   ID3_Tag myTag("song.mp3");
+ **   ID3_AudioHash hash;
+ **   if (hash.Compute(myTag))
+ **   {
+ **     uint64 key = hash.GetHash64();
+ **   }
+ ** \endcode
+ **
+ ** The audio is read in blocks of a megabyte.  Update() and Finish() hash
+ ** data from elsewhere, such as a reader that is already open.
+ **/
+ID3_AudioHash::ID3_AudioHash(bool sha256)
+  : _has_sha256(sha256)
+{
+  this->Clear();
+}
+
+/** Starts a new hash. */
+void ID3_AudioHash::Clear()
+{
+  _h1 = 0;
+  _h2 = 0;
+  _size = 0;
+  ::memset(_tail, 0, sizeof(_tail));
+  ::memset(_hash, 0, sizeof(_hash));
+  ::memcpy(_state, SHA256_INIT, sizeof(_state));
+  ::memset(_block, 0, sizeof(_block));
+  ::memset(_sha256, 0, sizeof(_sha256));
+}
+
+void ID3_AudioHash::HashBlock(const uchar* data)
+{
+  _h1 ^= mixK1(readLE64(data));
+  _h1 = rotl64(_h1, 27);
+  _h1 += _h2;
+  _h1 = _h1 * 5 + 0x52dce729;
+  _h2 ^= mixK2(readLE64(data + 8));
+  _h2 = rotl64(_h2, 31);
+  _h2 += _h1;
+  _h2 = _h2 * 5 + 0x38495ab5;
+}
+
+void ID3_AudioHash::Sha256Block(const uchar* data)
+{
+  uint32 w[64];
+  for (size_t i = 0; i < 16; ++i)
+  {
+    w[i] = (uint32(data[4 * i]) << 24) | (uint32(data[4 * i + 1]) << 16) |
+           (uint32(data[4 * i + 2]) << 8) | uint32(data[4 * i + 3]);
+  }
+  for (size_t i = 16; i < 64; ++i)
+  {
+    const uint32 s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    const uint32 s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32 a = _state[0], b = _state[1], c = _state[2], d = _state[3];
+  uint32 e = _state[4], f = _state[5], g = _state[6], h = _state[7];
+  for (size_t i = 0; i < 64; ++i)
+  {
+    const uint32 s1 = rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25);
+    const uint32 ch = (e & f) ^ (~e & g);
+    const uint32 t1 = h + s1 + ch + SHA256_K[i] + w[i];
+    const uint32 s0 = rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22);
+    const uint32 maj = (a & b) ^ (a & c) ^ (b & c);
+    const uint32 t2 = s0 + maj;
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  _state[0] += a; _state[1] += b; _state[2] += c; _state[3] += d;
+  _state[4] += e; _state[5] += f; _state[6] += g; _state[7] += h;
+}
+
+/** Adds the next len bytes of audio to the hash. */
+void ID3_AudioHash::Update(const uchar* data, size_t len)
+{
+  size_t pos = 0;
+  size_t used = _size % sizeof(_tail);
+  if (used > 0)
+  {
+    pos = min(len, sizeof(_tail) - used);
+    ::memcpy(_tail + used, data, pos);
+    if (used + pos == sizeof(_tail))
+    {
+      this->HashBlock(_tail);
+    }
+  }
+  for (; pos + sizeof(_tail) <= len; pos += sizeof(_tail))
+  {
+    this->HashBlock(data + pos);
+  }
+  ::memcpy(_tail, data + pos, len - pos);
+
+  if (_has_sha256)
+  {
+    pos = 0;
+    used = _size % sizeof(_block);
+    if (used > 0)
+    {
+      pos = min(len, sizeof(_block) - used);
+      ::memcpy(_block + used, data, pos);
+      if (used + pos == sizeof(_block))
+      {
+        this->Sha256Block(_block);
+      }
+    }
+    for (; pos + sizeof(_block) <= len; pos += sizeof(_block))
+    {
+      this->Sha256Block(data + pos);
+    }
+    ::memcpy(_block, data + pos, len - pos);
+  }
+  _size += len;
+}
+
+/** Completes the hash of the bytes added with Update(). */
+void ID3_AudioHash::Finish()
+{
+  const size_t rest = _size % sizeof(_tail);
+  uint64 k1 = 0, k2 = 0;
+  for (size_t i = rest; i > 8; --i)
+  {
+    k2 = (k2 << 8) | _tail[i - 1];
+  }
+  for (size_t i = min<size_t>(rest, 8); i > 0; --i)
+  {
+    k1 = (k1 << 8) | _tail[i - 1];
+  }
+  if (rest > 8)
+  {
+    _h2 ^= mixK2(k2);
+  }
+  if (rest > 0)
+  {
+    _h1 ^= mixK1(k1);
+  }
+  _h1 ^= uint64(_size);
+  _h2 ^= uint64(_size);
+  _h1 += _h2;
+  _h2 += _h1;
+  _h1 = fmix64(_h1);
+  _h2 = fmix64(_h2);
+  _h1 += _h2;
+  _h2 += _h1;
+  writeLE64(_hash, _h1);
+  writeLE64(_hash + 8, _h2);
+
+  if (_has_sha256)
+  {
+    const uint64 bits = uint64(_size) * 8;
+    size_t used = _size % sizeof(_block);
+    _block[used++] = 0x80;
+    if (used > sizeof(_block) - 8)
+    {
+      ::memset(_block + used, 0, sizeof(_block) - used);
+      this->Sha256Block(_block);
+      used = 0;
+    }
+    ::memset(_block + used, 0, sizeof(_block) - 8 - used);
+    for (size_t i = 0; i < 8; ++i)
+    {
+      _block[63 - i] = static_cast<uchar>((bits >> (8 * i)) & 0xFF);
+    }
+    this->Sha256Block(_block);
+    for (size_t i = 0; i < 8; ++i)
+    {
+      _sha256[4 * i]     = static_cast<uchar>(_state[i] >> 24);
+      _sha256[4 * i + 1] = static_cast<uchar>(_state[i] >> 16);
+      _sha256[4 * i + 2] = static_cast<uchar>(_state[i] >> 8);
+      _sha256[4 * i + 3] = static_cast<uchar>(_state[i]);
+    }
+  }
+}
+
+/** Hashes the bytes of the reader from beg up to end.  Returns false if
+ ** the reader holds fewer.
+ **/
+bool ID3_AudioHash::Compute(ID3_Reader& reader, size_t beg, size_t end)
+{
+  this->Clear();
+  if (end < beg)
+  {
+    return false;
+  }
+  BString buf(min(HASH_BLOCK, end - beg), '\0');
+  reader.setCur(beg);
+  while (_size < end - beg)
+  {
+    const size_t numRead = reader.readChars(&buf[0], min(buf.size(), end - beg - _size));
+    if (numRead == 0)
+    {
+      break;
+    }
+    this->Update(buf.data(), numRead);
+  }
+  this->Finish();
+  return _size == end - beg;
+}
+
+/** Hashes the audio of the file the tag is linked to, as found by Link():
+ ** GetAudioSize() bytes from GetAudioOffset() on.
+ **/
+bool ID3_AudioHash::Compute(const ID3_Tag& tag)
+{
+  ifstream file;
+  const char* name = tag.GetFileName();
+  if (NULL == name || '\0' == *name ||
+      ID3E_NoError != openReadableFile(name, file))
+  {
+    this->Clear();
+    return false;
+  }
+  ID3_IFStreamReader reader(file);
+  const size_t beg = tag.GetAudioOffset();
+  return this->Compute(reader, beg, beg + tag.GetAudioSize());
+}
@@ -0,0 +1,514 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#if defined HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <vector>
+#include <set>
+#include <string.h>
+#include <ctype.h>
+#include "id3/dir_walker.h"
+#include "id3/tag_batch.h"
+#include "io_batch.h"
+
+#if defined ID3_HAVE_FILE_DESCRIPTORS && defined HAVE_DIRENT_H && \
+    defined HAVE_OPENAT && defined HAVE_FSTATAT
+#  define ID3_HAVE_DIR_WALKER 1
+#  include <errno.h>
+#  include <unistd.h>
+#  include <fcntl.h>
+#  include <dirent.h>
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  if defined HAVE_SYS_SYSCALL_H
+#    include <sys/syscall.h>
+#  endif
+#  if defined __NR_getdents64
+#    define ID3_HAVE_GETDENTS64 1
+#  endif
+#  if !defined O_DIRECTORY
+#    define O_DIRECTORY 0
+#  endif
+#endif
+
+using namespace dami;
+
+namespace
+{
+  // directories read at once, by default
+  const size_t WALK_THREADS = 8;
+
+  typedef std::pair<uint64, uint64> FileId;   // device and inode
+
+  // a file or directory found in a directory
+  struct WalkEntry
+  {
+    String path;
+    FileId id;
+    int links;          // symbolic links followed to get here
+  };
+
+  // a directory to read, and what was found in it
+  struct WalkJob
+  {
+    WalkEntry dir;
+    std::vector<WalkEntry> files;
+    std::vector<WalkEntry> dirs;
+  };
+}
+
+class ID3_DirWalkerImpl
+{
+public:
+  ID3_DirWalkerImpl()
+    : _magicCheck(false), _followSymlinks(false), _threads(WALK_THREADS)
+  { }
+
+  void clear()
+  {
+    _files.clear();
+    _seenFiles.clear();
+    _seenDirs.clear();
+  }
+
+  bool isWanted(const char* name) const;
+#if defined ID3_HAVE_DIR_WALKER
+  void readDir(WalkJob&) const;
+#endif
+
+  std::vector<String> _extensions;    // lower case, without the dot
+  bool _magicCheck;
+  bool _followSymlinks;
+  size_t _threads;
+  std::vector<String> _files;
+  std::set<FileId> _seenFiles;
+  std::set<FileId> _seenDirs;
+};
+
+// is the extension of the file name one of those asked for?
+bool ID3_DirWalkerImpl::isWanted(const char* name) const
+{
+  if (_extensions.empty())
+  {
+    return true;
+  }
+  const char* dot = ::strrchr(name, '.');
+  if (dot == NULL)
+  {
+    return false;
+  }
+  String ext;
+  for (const char* c = dot + 1; *c; ++c)
+  {
+    ext += static_cast<char>(::tolower(static_cast<uchar>(*c)));
+  }
+  for (size_t i = 0; i < _extensions.size(); ++i)
+  {
+    if (_extensions[i] == ext)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+#if defined ID3_HAVE_DIR_WALKER
+namespace
+{
+  enum { ENTRY_UNKNOWN, ENTRY_FILE, ENTRY_DIR, ENTRY_LINK, ENTRY_OTHER };
+
+  struct DirEntry
+  {
+    String name;
+    int type;
+  };
+
+  int entryType(uchar type)
+  {
+#if defined DT_UNKNOWN
+    switch (type)
+    {
+      case DT_REG: return ENTRY_FILE;
+      case DT_DIR: return ENTRY_DIR;
+      case DT_LNK: return ENTRY_LINK;
+      case DT_UNKNOWN: return ENTRY_UNKNOWN;
+      default: return ENTRY_OTHER;
+    }
+#else
+    return ENTRY_UNKNOWN;
+#endif
+  }
+
+  bool isDots(const char* name)
+  {
+    return name[0] == '.' &&
+           (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+  }
+
+  // All entries of the directory but . and .., in one large getdents64()
+  // after another where there is that call
+  void readEntries(int fd, std::vector<DirEntry>& entries)
+  {
+#if defined ID3_HAVE_GETDENTS64
+    // struct linux_dirent64: ino, off, reclen, type, name
+    const size_t RECLEN = 16, TYPE = 18, NAME = 19;
+    std::vector<char> buf(64 * 1024);
+    for (;;)
+    {
+      const long n = ::syscall(__NR_getdents64, fd, &buf[0], buf.size());
+      if (n <= 0)
+      {
+        if (n < 0 && errno == EINTR)
+        {
+          continue;
+        }
+        break;
+      }
+      for (long pos = 0; pos < n; )
+      {
+        const char* rec = &buf[pos];
+        unsigned short reclen;
+        ::memcpy(&reclen, rec + RECLEN, sizeof(reclen));
+        if (reclen == 0)
+        {
+          break;
+        }
+        if (!isDots(rec + NAME))
+        {
+          DirEntry entry;
+          entry.name = rec + NAME;
+          entry.type = entryType(rec[TYPE]);
+          entries.push_back(entry);
+        }
+        pos += reclen;
+      }
+    }
+#elif defined HAVE_FDOPENDIR
+    // fdopendir() takes the descriptor over
+    const int dirfd = ::dup(fd);
+    DIR* dir = (dirfd < 0) ? NULL : ::fdopendir(dirfd);
+    if (dir == NULL)
+    {
+      if (dirfd >= 0)
+      {
+        ::close(dirfd);
+      }
+      return;
+    }
+    for (struct dirent* ent; (ent = ::readdir(dir)) != NULL; )
+    {
+      if (!isDots(ent->d_name))
+      {
+        DirEntry entry;
+        entry.name = ent->d_name;
+#if defined DT_UNKNOWN
+        entry.type = entryType(ent->d_type);
+#else
+        entry.type = ENTRY_UNKNOWN;
+#endif
+        entries.push_back(entry);
+      }
+    }
+    ::closedir(dir);
+#endif
+  }
+
+  // Does the file begin like one id3lib reads: an id3v2 tag, an mpeg
+  // frame, or a RIFF, AIFF or FLAC container?
+  bool hasMagic(int dirfd, const char* name)
+  {
+    const int fd = ::openat(dirfd, name, O_RDONLY);
+    if (fd < 0)
+    {
+      return false;
+    }
+    uchar head[4];
+    const size_t size = io::readAt(fd, head, sizeof(head), 0);
+    ::close(fd);
+    if (size < 4)
+    {
+      return false;
+    }
+    return ::memcmp(head, "ID3", 3) == 0 ||
+           (head[0] == 0xFF && (head[1] & 0xE0) == 0xE0) ||
+           ::memcmp(head, "RIFF", 4) == 0 || ::memcmp(head, "FORM", 4) == 0 ||
+           ::memcmp(head, "fLaC", 4) == 0;
+  }
+
+  String childPath(const String& dir, const String& name)
+  {
+    if (!dir.empty() && dir[dir.size() - 1] == '/')
+    {
+      return dir + name;
+    }
+    return dir + "/" + name;
+  }
+}
+
+// Reads one directory: the entries are looked at relative to it, which
+// spares the kernel from resolving their whole path again
+void ID3_DirWalkerImpl::readDir(WalkJob& job) const
+{
+  const int fd = ::open(job.dir.path.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0)
+  {
+    ID3D_NOTICE( "ID3_DirWalker: can't open " << job.dir.path.c_str() );
+    return;
+  }
+  std::vector<DirEntry> entries;
+  readEntries(fd, entries);
+  for (size_t i = 0; i < entries.size(); ++i)
+  {
+    const DirEntry& entry = entries[i];
+    const char* name = entry.name.c_str();
+    if ((entry.type == ENTRY_FILE && !this->isWanted(name)) ||
+        entry.type == ENTRY_OTHER ||
+        (entry.type == ENTRY_LINK && !_followSymlinks))
+    {
+      continue;
+    }
+    struct stat st;
+    if (::fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+    {
+      continue;
+    }
+    int links = job.dir.links;
+    if (S_ISLNK(st.st_mode))
+    {
+      // the kernel gives up on a chain of links that loops (ELOOP)
+      if (!_followSymlinks || ::fstatat(fd, name, &st, 0) != 0)
+      {
+        continue;
+      }
+      ++links;
+    }
+    WalkEntry found;
+    found.id = FileId(st.st_dev, st.st_ino);
+    found.links = links;
+    if (S_ISDIR(st.st_mode))
+    {
+      if (links <= io::SYMLINK_MAX_DEPTH)
+      {
+        found.path = childPath(job.dir.path, entry.name);
+        job.dirs.push_back(found);
+      }
+    }
+    else if (S_ISREG(st.st_mode) && this->isWanted(name) &&
+             (!_magicCheck || hasMagic(fd, name)))
+    {
+      found.path = childPath(job.dir.path, entry.name);
+      job.files.push_back(found);
+    }
+  }
+  ::close(fd);
+}
+
+namespace
+{
+  struct WalkLevel
+  {
+    const ID3_DirWalkerImpl* walker;
+    WalkJob* jobs;
+  };
+
+  void readDirAt(void* arg, size_t i)
+  {
+    WalkLevel* level = static_cast<WalkLevel*>(arg);
+    level->walker->readDir(level->jobs[i]);
+  }
+}
+#endif /* ID3_HAVE_DIR_WALKER */
+
+/** \class ID3_DirWalker dir_walker.h id3/dir_walker.h
+ ** \brief Finds the audio files in a directory tree, for ID3_TagBatch.
+ **
+ ** Walk() reads a tree one level at a time, up to GetThreads() directories
+ ** at once.  Each directory is opened once, and its entries are read with
+ ** getdents64() and looked at with fstatat() relative to it, rather than
+ ** by a path the kernel resolves from the start for every file.
+ **
+ ** Only files with one of the extensions given to AddExtension() are kept,
+ ** or all files if none was given.  SetMagicCheck() also has the start of
+ ** each file read to see that it is one id3lib knows.
+ **
+ ** A file is found once, however many hard links it has.  Symbolic links
+ ** are only followed after SetFollowSymlinks(true); a directory reached
+ ** twice, as a link that loops would have it, is read once, and no more
+ ** than io::SYMLINK_MAX_DEPTH links are followed down a path, as when a
+ ** tag resolves the name of its file.
+ **
+ ** \code
+ **   ID3_DirWalker walker;
+ **   walker.AddExtension("mp3");
+ **   walker.Walk("/music");
+ **   ID3_TagBatch batch;
+ **   walker.AddTo(batch);
+ **   batch.Link();
+ ** \endcode
+ **/
+ID3_DirWalker::ID3_DirWalker()
+  : _impl(new ID3_DirWalkerImpl)
+{
+}
+
+ID3_DirWalker::~ID3_DirWalker()
+{
+  delete _impl;
+}
+
+/** Keeps files with the extension, such as "mp3" or ".mp3", in any case. */
+void ID3_DirWalker::AddExtension(const char* ext)
+{
+  if (ext == NULL)
+  {
+    return;
+  }
+  if (*ext == '.')
+  {
+    ++ext;
+  }
+  String lower;
+  for (; *ext; ++ext)
+  {
+    lower += static_cast<char>(::tolower(static_cast<uchar>(*ext)));
+  }
+  _impl->_extensions.push_back(lower);
+}
+
+void ID3_DirWalker::SetMagicCheck(bool check)
+{
+  _impl->_magicCheck = check;
+}
+
+bool ID3_DirWalker::GetMagicCheck() const
+{
+  return _impl->_magicCheck;
+}
+
+void ID3_DirWalker::SetFollowSymlinks(bool follow)
+{
+  _impl->_followSymlinks = follow;
+}
+
+bool ID3_DirWalker::GetFollowSymlinks() const
+{
+  return _impl->_followSymlinks;
+}
+
+void ID3_DirWalker::SetThreads(size_t threads)
+{
+  _impl->_threads = max<size_t>(1, threads);
+}
+
+size_t ID3_DirWalker::GetThreads() const
+{
+  return _impl->_threads;
+}
+
+/** Adds the files found under dir to those found before.  Returns how many
+ ** were added.
+ **/
+size_t ID3_DirWalker::Walk(const char* dir)
+{
+  const size_t before = _impl->_files.size();
+#if defined ID3_HAVE_DIR_WALKER
+  struct stat st;
+  if (dir == NULL || ::stat(dir, &st) != 0 || !S_ISDIR(st.st_mode))
+  {
+    return 0;
+  }
+  std::vector<WalkJob> level(1);
+  level[0].dir.path = dir;
+  level[0].dir.id = FileId(st.st_dev, st.st_ino);
+  level[0].dir.links = 0;
+  if (!_impl->_seenDirs.insert(level[0].dir.id).second)
+  {
+    return 0;
+  }
+  while (!level.empty())
+  {
+    WalkLevel work;
+    work.walker = _impl;
+    work.jobs = &level[0];
+    io::forEachParallel(level.size(), _impl->_threads, readDirAt, &work);
+
+    // in the order they were read, so that a walk always finds the same
+    std::vector<WalkJob> next;
+    for (size_t i = 0; i < level.size(); ++i)
+    {
+      const WalkJob& job = level[i];
+      for (size_t j = 0; j < job.files.size(); ++j)
+      {
+        if (_impl->_seenFiles.insert(job.files[j].id).second)
+        {
+          _impl->_files.push_back(job.files[j].path);
+        }
+      }
+      for (size_t j = 0; j < job.dirs.size(); ++j)
+      {
+        if (_impl->_seenDirs.insert(job.dirs[j].id).second)
+        {
+          next.push_back(WalkJob());
+          next.back().dir = job.dirs[j];
+        }
+      }
+    }
+    level.swap(next);
+  }
+#else
+  ID3D_WARNING( "ID3_DirWalker::Walk(): not available" );
+#endif
+  return _impl->_files.size() - before;
+}
+
+/** Forgets the files found, and the directories read. */
+void ID3_DirWalker::Clear()
+{
+  _impl->clear();
+}
+
+size_t ID3_DirWalker::NumFiles() const
+{
+  return _impl->_files.size();
+}
+
+const char* ID3_DirWalker::GetFileName(size_t i) const
+{
+  return (i < this->NumFiles()) ? _impl->_files[i].c_str() : NULL;
+}
+
+/** Adds the files found to the batch.  Returns how many. */
+size_t ID3_DirWalker::AddTo(ID3_TagBatch& batch) const
+{
+  for (size_t i = 0; i < this->NumFiles(); ++i)
+  {
+    batch.Add(_impl->_files[i].c_str());
+  }
+  return this->NumFiles();
+}
@@ -31,6 +31,7 @@
 #include "field_def.h"
 #include "frame_def.h"
 #include "readers.h"
+#include "stats.h"
 #include <assert.h>
 
 using namespace dami;
@@ -416,6 +417,79 @@ static ID3_FieldDef ID3FD_PlayCounter[] =
   { ID3FN_NOFIELD }
 };
 
+static ID3_FieldDef ID3FD_Seek[] =
+{
+  {
+    ID3FN_SEEKOFFSET,                   // FIELD NAME
+    ID3FTY_INTEGER,                     // FIELD TYPE
+    4,                                  // FIXED LEN
+    ID3V2_4_0,                          // INITIAL SPEC
+    ID3V2_4_0,                          // ENDING SPEC
+    ID3FF_NONE,                         // FLAGS
+    ID3FN_NOFIELD                       // LINKED FIELD
+  },
+  { ID3FN_NOFIELD }
+};
+
+static ID3_FieldDef ID3FD_LookupTable[] =
+{
+  {
+    ID3FN_FRAMESBETWEEN,                // FIELD NAME
+    ID3FTY_INTEGER,                     // FIELD TYPE
+    2,                                  // FIXED LEN
+    ID3V2_EARLIEST,                     // INITIAL SPEC
+    ID3V2_LATEST,                       // ENDING SPEC
+    ID3FF_NONE,                         // FLAGS
+    ID3FN_NOFIELD                       // LINKED FIELD
+  },
+  {
+    ID3FN_BYTESBETWEEN,                 // FIELD NAME
+    ID3FTY_INTEGER,                     // FIELD TYPE
+    3,                                  // FIXED LEN
+    ID3V2_EARLIEST,                     // INITIAL SPEC
+    ID3V2_LATEST,                       // ENDING SPEC
+    ID3FF_NONE,                         // FLAGS
+    ID3FN_NOFIELD                       // LINKED FIELD
+  },
+  {
+    ID3FN_MSBETWEEN,                    // FIELD NAME
+    ID3FTY_INTEGER,                     // FIELD TYPE
+    3,                                  // FIXED LEN
+    ID3V2_EARLIEST,                     // INITIAL SPEC
+    ID3V2_LATEST,                       // ENDING SPEC
+    ID3FF_NONE,                         // FLAGS
+    ID3FN_NOFIELD                       // LINKED FIELD
+  },
+  {
+    ID3FN_BYTESDEVBITS,                 // FIELD NAME
+    ID3FTY_INTEGER,                     // FIELD TYPE
+    1,                                  // FIXED LEN
+    ID3V2_EARLIEST,                     // INITIAL SPEC
+    ID3V2_LATEST,                       // ENDING SPEC
+    ID3FF_NONE,                         // FLAGS
+    ID3FN_NOFIELD                       // LINKED FIELD
+  },
+  {
+    ID3FN_MSDEVBITS,                    // FIELD NAME
+    ID3FTY_INTEGER,                     // FIELD TYPE
+    1,                                  // FIXED LEN
+    ID3V2_EARLIEST,                     // INITIAL SPEC
+    ID3V2_LATEST,                       // ENDING SPEC
+    ID3FF_NONE,                         // FLAGS
+    ID3FN_NOFIELD                       // LINKED FIELD
+  },
+  {
+    ID3FN_DATA,                         // FIELD NAME
+    ID3FTY_BINARY,                      // FIELD TYPE
+    0,                                  // FIXED LEN
+    ID3V2_EARLIEST,                     // INITIAL SPEC
+    ID3V2_LATEST,                       // ENDING SPEC
+    ID3FF_NONE,                         // FLAGS
+    ID3FN_NOFIELD                       // LINKED FIELD
+  },
+  { ID3FN_NOFIELD }
+};
+
 static ID3_FieldDef ID3FD_Popularimeter[] =
 {
   {
@@ -672,9 +746,11 @@ static ID3_FieldDef ID3FD_Volume[] =
 // GRID       ID3FID_GROUPINGREG       Group identification registration
 // IPLS  IPL  ID3FID_INVOLVEDPEOPLE    Involved people list
 // LINK  LNK  ID3FID_LINKEDINFO        Linked information
+// MLLT  MLL  ID3FID_MPEGLOOKUP        MPEG location lookup table
 // PCNT  CNT  ID3FID_PLAYCOUNTER       Play counter
 // POPM  POP  ID3FID_POPULARIMETER     Popularimeter
 // PRIV       ID3FID_PRIVATE           Private frame
+// SEEK       ID3FID_SEEKFRAME         Seek frame (id3v2.4.0 only)
 // SYLT  SLT  ID3FID_SYNCEDLYRICS      Synchronized lyric/text
 // TALB  TAL  ID3FID_ALBUM             Album/Movie/Show title
 // TBPM  TBP  ID3FID_BPM               BPM (beats per minute)
@@ -735,7 +811,6 @@ static ID3_FieldDef ID3FD_Volume[] =
 // EQUA  EQU  ID3FID_EQUALIZATION      Equalization
 // ETCO  ETC  ID3FID_EVENTTIMING       Event timing codes
 // MCDI  MCI  ID3FID_CDID              Music CD identifier
-// MLLT  MLL  ID3FID_MPEGLOOKUP        MPEG location lookup table
 // OWNE       ID3FID_OWNERSHIP         Ownership frame
 // POSS       ID3FID_POSITIONSYNC      Position synchronisation frame
 // RBUF  BUF  ID3FID_BUFFERSIZE        Recommended buffer size
@@ -759,7 +834,7 @@ static  ID3_FrameDef ID3_FrameDefs[] =
   {ID3FID_INVOLVEDPEOPLE,    "IPL", "IPLS", false, false, ID3FD_InvolvedPeople,"Involved people list"},
   {ID3FID_LINKEDINFO,        "LNK", "LINK", false, false, ID3FD_LinkedInfo,    "Linked information"},
   {ID3FID_CDID,              "MCI", "MCDI", false, false, ID3FD_Unimplemented, "Music CD identifier"},
-  {ID3FID_MPEGLOOKUP,        "MLL", "MLLT", false, true,  ID3FD_Unimplemented, "MPEG location lookup table"},
+  {ID3FID_MPEGLOOKUP,        "MLL", "MLLT", false, true,  ID3FD_LookupTable,   "MPEG location lookup table"},
   {ID3FID_OWNERSHIP,         ""   , "OWNE", false, false, ID3FD_Unimplemented, "Ownership frame"},
   {ID3FID_PRIVATE,           ""   , "PRIV", false, false, ID3FD_Private,       "Private frame"},
   {ID3FID_PLAYCOUNTER,       "CNT", "PCNT", false, false, ID3FD_PlayCounter,   "Play counter"},
@@ -768,6 +843,7 @@ static  ID3_FrameDef ID3_FrameDefs[] =
   {ID3FID_BUFFERSIZE,        "BUF", "RBUF", false, false, ID3FD_Unimplemented, "Recommended buffer size"},
   {ID3FID_VOLUMEADJ,         "RVA", "RVAD", false, true,  ID3FD_Unimplemented, "Relative volume adjustment"},
   {ID3FID_REVERB,            "REV", "RVRB", false, false, ID3FD_Unimplemented, "Reverb"},
+  {ID3FID_SEEKFRAME,         ""   , "SEEK", true,  false, ID3FD_Seek,          "Seek frame"},
   {ID3FID_SYNCEDLYRICS,      "SLT", "SYLT", false, false, ID3FD_SyncLyrics,    "Synchronized lyric/text"},
   {ID3FID_SYNCEDTEMPO,       "STC", "SYTC", false, true,  ID3FD_Unimplemented, "Synchronized tempo codes"},
   {ID3FID_ALBUM,             "TAL", "TALB", false, false, ID3FD_Text,          "Album/Movie/Show title"},
@@ -1042,6 +1118,7 @@ size_t ID3_FieldImpl::Size() const
 
 bool ID3_FieldImpl::Parse(ID3_Reader& reader)
 {
+  ID3_STATS_TIMER(FIELD_DECODE);
   bool success = false;
   switch (this->GetType())
   {
@@ -30,7 +30,7 @@
 
 #include <stdlib.h>
 #include "field.h"
-#include "id3/id3lib_strings.h"
+#include "id3/id3lib_strings.h"
 
 struct ID3_FieldDef;
 struct ID3_FrameDef;
@@ -70,6 +70,7 @@ public:
   dami::String  GetTextItem(size_t) const;
   size_t        SetText(dami::String);
   size_t        AddText(dami::String);
+  size_t        SetRawText(dami::String, ID3_TextEnc, size_t numItems);
 
   // Unicode string field functions
   ID3_Field&    operator= (const unicode_t* s) { this->Set(s); return *this; }
@@ -96,8 +97,11 @@ public:
 
   // miscelaneous functions
   ID3_Field&    operator=( const ID3_Field & );
+  // fields that are still current in ID3V2_LATEST are current in id3v2.4.0
+  // too, which is parsed and rendered but not written by default
   bool          InScope(ID3_V2Spec spec) const
-  { return _spec_begin <= spec && spec <= _spec_end; }
+  { return _spec_begin <= spec &&
+      (spec <= _spec_end || ID3V2_LATEST == _spec_end); }
 
   ID3_FieldID   GetID() const { return _id; }
   ID3_FieldType GetType() const { return _type; }
@@ -186,6 +186,22 @@ size_t ID3_FieldImpl::SetText_i(String data)
   return _text.size();
 }
 
+// Sets the text as GetText() returns it: in its encoding, with a null
+// character between the items.  Used to restore a field from a snapshot.
+size_t ID3_FieldImpl::SetRawText(String data, ID3_TextEnc enc, size_t numItems)
+{
+  size_t len = 0;
+  if (this->GetType() == ID3FTY_TEXTSTRING)
+  {
+    _text = data;
+    _enc = enc;
+    _num_items = numItems;
+    _changed = true;
+    len = _text.size();
+  }
+  return len;
+}
+
 size_t ID3_FieldImpl::SetText(String data)
 {
   size_t len = 0;
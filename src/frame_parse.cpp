@@ -30,6 +30,8 @@
 
 #include "frame_impl.h"
 #include "id3/io_decorators.h" //has "readers.h" "io_helpers.h" "utils.h"
+#include "io_strings.h"
+#include "stats.h"
 
 using namespace dami;
 
@@ -104,10 +106,22 @@ namespace
     
     return true;
   }
+
+  bool parseData(ID3_Reader& rdr, ID3_FrameImpl& frame, bool compressed,
+                 size_t origSize)
+  {
+    if (!compressed)
+    {
+      return parseFields(rdr, frame);
+    }
+    io::CompressedReader csr(rdr, origSize);
+    return parseFields(csr, frame);
+  }
 };
 
 bool ID3_FrameImpl::Parse(ID3_Reader& reader) 
 { 
+  ID3_STATS_TIMER(FRAME_PARSE);
   io::ExitTrigger et(reader);
   ID3D_NOTICE( "ID3_FrameImpl::Parse(): reader.getBeg() = " << reader.getBeg() );
   ID3D_NOTICE( "ID3_FrameImpl::Parse(): reader.getCur() = " << reader.getCur() );
@@ -136,24 +150,49 @@ bool ID3_FrameImpl::Parse(ID3_Reader& reader)
   ID3D_NOTICE( "ID3_FrameImpl::Parse(): window getEnd() = " << wr.getEnd() );
   
   unsigned long origSize = 0;
-  if (_hdr.GetCompression())
+  if (this->GetSpec() == ID3V2_4_0)
   {
-    origSize = io::readBENumber(reader, sizeof(uint32));
-    ID3D_NOTICE( "ID3_FrameImpl::Parse(): frame is compressed, origSize = " << origSize );
+    // id3v2.4.0 orders the extra bytes like the flags: grouping id,
+    // encryption method, then the (syncsafe) data length indicator
+    if (_hdr.GetGrouping())
+    {
+      char ch = wr.readChar();
+      this->SetGroupingID(ch);
+      ID3D_NOTICE( "ID3_FrameImpl::Parse(): frame is grouped, grouping_id = " << (int) ch );
+    }
+    if (_hdr.GetEncryption())
+    {
+      char ch = wr.readChar();
+      this->SetEncryptionID(ch);
+      ID3D_NOTICE( "ID3_FrameImpl::Parse(): frame is encrypted, encryption_id = " << (int) ch );
+    }
+    if (_hdr.GetDataLength())
+    {
+      origSize = io::readUInt28(wr);
+      ID3D_NOTICE( "ID3_FrameImpl::Parse(): data length indicator = " << origSize );
+    }
   }
-
-  if (_hdr.GetEncryption())
+  else
   {
-    char ch = wr.readChar();
-    this->SetEncryptionID(ch);
-    ID3D_NOTICE( "ID3_FrameImpl::Parse(): frame is encrypted, encryption_id = " << (int) ch );
-  }
+    if (_hdr.GetCompression())
+    {
+      origSize = io::readBENumber(reader, sizeof(uint32));
+      ID3D_NOTICE( "ID3_FrameImpl::Parse(): frame is compressed, origSize = " << origSize );
+    }
 
-  if (_hdr.GetGrouping())
-  {
-    char ch = wr.readChar();
-    this->SetGroupingID(ch);
-    ID3D_NOTICE( "ID3_FrameImpl::Parse(): frame is encrypted, grouping_id = " << (int) ch );
+    if (_hdr.GetEncryption())
+    {
+      char ch = wr.readChar();
+      this->SetEncryptionID(ch);
+      ID3D_NOTICE( "ID3_FrameImpl::Parse(): frame is encrypted, encryption_id = " << (int) ch );
+    }
+
+    if (_hdr.GetGrouping())
+    {
+      char ch = wr.readChar();
+      this->SetGroupingID(ch);
+      ID3D_NOTICE( "ID3_FrameImpl::Parse(): frame is encrypted, grouping_id = " << (int) ch );
+    }
   }
 
   // set the type of frame based on the parsed header  
@@ -161,15 +200,21 @@ bool ID3_FrameImpl::Parse(ID3_Reader& reader)
   this->_InitFields(); 
 
   bool success = false;
-  // expand out the data if it's compressed 
-  if (!_hdr.GetCompression())
+  if (!_hdr.GetUnsync())
   {
-    success = parseFields(wr, *this);
+    // expand out the data if it's compressed 
+    success = parseData(wr, *this, _hdr.GetCompression(), origSize);
   }
   else
   {
-    io::CompressedReader csr(wr, origSize);
-    success = parseFields(csr, *this);
+    // id3v2.4.0 unsynchronises frame by frame.  Resync the frame data once,
+    // into memory, before parsing (and decompressing) it.
+    BString raw = io::readAllBinary(wr);
+    io::BStringReader bsr(raw);
+    io::UnsyncedReader ur(bsr);
+    BString synced = io::readAllBinary(ur);
+    io::BStringReader sr(synced);
+    success = parseData(sr, *this, _hdr.GetCompression(), origSize);
   }
   et.setExitPos(wr.getCur());
 
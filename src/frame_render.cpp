@@ -40,6 +40,7 @@
 #include "id3/io_decorators.h" //has "readers.h" "io_helpers.h" "utils.h"
 #include "io_strings.h"
 #include "io_helpers.h"
+#include "stats.h"
 
 using namespace dami;
 
@@ -78,6 +79,12 @@ void ID3_FrameImpl::Render(ID3_Writer& writer) const
   }
 
   ID3_FrameHeader hdr;
+  // frames are written as ID3V2_LATEST, unless they're part of a v2.4.0 tag
+  const bool isV24 = (this->GetSpec() == ID3V2_4_0);
+  if (isV24)
+  {
+    hdr.SetSpec(ID3V2_4_0);
+  }
   
   const size_t hdr_size = hdr.Size();
 
@@ -94,6 +101,7 @@ void ID3_FrameImpl::Render(ID3_Writer& writer) const
   }
   else
   {
+    ID3_STATS_TIMER(COMPRESS);
     io::CompressedWriter cr(fldWriter);
     renderFields(cr, *this);
     cr.flush();
@@ -127,6 +135,9 @@ void ID3_FrameImpl::Render(ID3_Writer& writer) const
   hdr.SetEncryption(eID > 0);
   hdr.SetGrouping(gID > 0);
   hdr.SetCompression(origSize > fldSize);
+  // v2.4.0 requires a data length indicator instead of the v2.3.0
+  // decompressed size
+  hdr.SetDataLength(isV24 && hdr.GetCompression());
   hdr.SetDataSize(fldSize + ((hdr.GetCompression() ? 4 : 0) + 
                              (hdr.GetEncryption()  ? 1 : 0) + 
                              (hdr.GetGrouping()    ? 1 : 0)));
@@ -137,20 +148,38 @@ void ID3_FrameImpl::Render(ID3_Writer& writer) const
   if (fldSize != 0)
   {
     // No-man's land!  Not part of the header, not part of the data
-    if (hdr.GetCompression())
-    {
-      io::writeBENumber(writer, origSize, sizeof(uint32));
-      ID3D_NOTICE( "ID3_FrameImpl::Render(): frame is compressed, wrote origSize = " << origSize );
-    }
-    if (hdr.GetEncryption())
+    if (isV24)
     {
-      writer.writeChar(eID);
-      ID3D_NOTICE( "ID3_FrameImpl::Render(): frame is compressed, encryption id = " << eID );
+      if (hdr.GetGrouping())
+      {
+        writer.writeChar(gID);
+      }
+      if (hdr.GetEncryption())
+      {
+        writer.writeChar(eID);
+      }
+      if (hdr.GetDataLength())
+      {
+        io::writeUInt28(writer, origSize);
+      }
     }
-    if (hdr.GetGrouping())
+    else
     {
-      writer.writeChar(gID);
-      ID3D_NOTICE( "ID3_FrameImpl::Render(): frame is compressed, grouping id = " << gID );
+      if (hdr.GetCompression())
+      {
+        io::writeBENumber(writer, origSize, sizeof(uint32));
+        ID3D_NOTICE( "ID3_FrameImpl::Render(): frame is compressed, wrote origSize = " << origSize );
+      }
+      if (hdr.GetEncryption())
+      {
+        writer.writeChar(eID);
+        ID3D_NOTICE( "ID3_FrameImpl::Render(): frame is compressed, encryption id = " << eID );
+      }
+      if (hdr.GetGrouping())
+      {
+        writer.writeChar(gID);
+        ID3D_NOTICE( "ID3_FrameImpl::Render(): frame is compressed, grouping id = " << gID );
+      }
     }
 
     // Write the field data
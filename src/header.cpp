@@ -45,7 +45,8 @@ bool ID3_Header::SetSpec(ID3_V2Spec spec)
   };
   
   bool changed = false;
-  if (spec < ID3V2_EARLIEST || spec > ID3V2_LATEST)
+  // id3v2.4.0 is understood, but ID3V2_LATEST remains the default for writing
+  if (spec < ID3V2_EARLIEST || spec > ID3V2_4_0)
   {
     changed = _spec != ID3V2_UNKNOWN;
     _spec = ID3V2_UNKNOWN;
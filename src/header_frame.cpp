@@ -35,6 +35,59 @@
 
 using namespace dami;
 
+namespace
+{
+  // id3v2.4.0 moved the frame flags around:
+  //   v2.3.0: %abc00000 %ijk00000
+  //   v2.4.0: %0abc0000 %0h00kmnp
+  // Internally the v2.3.0 layout is used, plus the v2.4.0 only 'n' and 'p'
+  // bits in their v2.4.0 positions.
+  struct FlagMap
+  {
+    uint16 v23;
+    uint16 v24;
+  };
+
+  const FlagMap flag_map[] =
+  {
+    { ID3_FrameHeader::TAGALTER,    1 << 14 },
+    { ID3_FrameHeader::FILEALTER,   1 << 13 },
+    { ID3_FrameHeader::READONLY,    1 << 12 },
+    { ID3_FrameHeader::GROUPING,    1 <<  6 },
+    { ID3_FrameHeader::COMPRESSION, 1 <<  3 },
+    { ID3_FrameHeader::ENCRYPTION,  1 <<  2 },
+    { ID3_FrameHeader::UNSYNC,      1 <<  1 },
+    { ID3_FrameHeader::DATALENGTH,  1 <<  0 }
+  };
+  const size_t num_flags = sizeof(flag_map) / sizeof(FlagMap);
+
+  uint16 flagsFromV24(uint16 v24)
+  {
+    uint16 flags = 0;
+    for (size_t i = 0; i < num_flags; ++i)
+    {
+      if (v24 & flag_map[i].v24)
+      {
+        flags |= flag_map[i].v23;
+      }
+    }
+    return flags;
+  }
+
+  uint16 flagsToV24(uint16 flags)
+  {
+    uint16 v24 = 0;
+    for (size_t i = 0; i < num_flags; ++i)
+    {
+      if (flags & flag_map[i].v23)
+      {
+        v24 |= flag_map[i].v24;
+      }
+    }
+    return v24;
+  }
+};
+
 void ID3_FrameHeader::SetUnknownFrame(const char* id)
 {
   Clear();
@@ -117,12 +170,24 @@ bool ID3_FrameHeader::Parse(ID3_Reader& reader)
     this->SetFrameID(fid);
   }
 
-  uint32 dataSize = io::readBENumber(reader, _info->frame_bytes_size);
+  uint32 dataSize = 0;
+  if (this->GetSpec() == ID3V2_4_0)
+  {
+    dataSize = io::readUInt28(reader);
+  }
+  else
+  {
+    dataSize = io::readBENumber(reader, _info->frame_bytes_size);
+  }
   ID3D_NOTICE( "ID3_FrameHeader::Parse: dataSize = " << dataSize );
   ID3D_NOTICE( "ID3_FrameHeader::Parse: getCur() = " << reader.getCur() );
   this->SetDataSize(dataSize);
 
   uint32 flags = io::readBENumber(reader, _info->frame_bytes_flags);
+  if (this->GetSpec() == ID3V2_4_0)
+  {
+    flags = flagsFromV24(static_cast<uint16>(flags));
+  }
   _flags.add(flags);
 
   ID3D_NOTICE( "ID3_FrameHeader::Parse: flags = " << flags );
@@ -156,8 +221,17 @@ void ID3_FrameHeader::Render(ID3_Writer& writer) const
   ID3D_NOTICE( "ID3_FrameHeader::Render(): writing " << textID << ", " << (int) _info->frame_bytes_size << " bytes");
   writer.writeChars((uchar *) textID, _info->frame_bytes_id);
 
-  io::writeBENumber(writer, _data_size, _info->frame_bytes_size);
-  io::writeBENumber(writer, _flags.get(), _info->frame_bytes_flags);
+  if (this->GetSpec() == ID3V2_4_0)
+  {
+    io::writeUInt28(writer, _data_size);
+    io::writeBENumber(writer, flagsToV24(static_cast<uint16>(_flags.get())),
+                      _info->frame_bytes_flags);
+  }
+  else
+  {
+    io::writeBENumber(writer, _data_size, _info->frame_bytes_size);
+    io::writeBENumber(writer, _flags.get(), _info->frame_bytes_flags);
+  }
 }
 
 const char* ID3_FrameHeader::GetTextID() const
@@ -44,7 +44,11 @@ public:
     READONLY    = 1 << 13,
     COMPRESSION = 1 <<  7,
     ENCRYPTION  = 1 <<  6,
-    GROUPING    = 1 <<  5
+    GROUPING    = 1 <<  5,
+    // id3v2.4.0 only: the frame is unsynchronised and/or has a data length
+    // indicator.  These bits are never set for earlier versions.
+    UNSYNC      = 1 <<  1,
+    DATALENGTH  = 1 <<  0
   };
 
   ID3_FrameHeader() : _frame_def(NULL), _dyn_frame_def(false) { ; }
@@ -63,11 +67,14 @@ public:
   bool SetCompression(bool b) { return this->SetFlags(COMPRESSION, b); }
   bool SetEncryption(bool b)  { return this->SetFlags(ENCRYPTION, b); }
   bool SetGrouping(bool b)    { return this->SetFlags(GROUPING, b); }
+  bool SetDataLength(bool b)  { return this->SetFlags(DATALENGTH, b); }
 
   bool GetCompression() const { return _flags.test(COMPRESSION); }
   bool GetEncryption() const  { return _flags.test(ENCRYPTION); }
   bool GetGrouping() const    { return _flags.test(GROUPING); }
   bool GetReadOnly() const    { return _flags.test(READONLY); }
+  bool GetUnsync() const      { return _flags.test(UNSYNC); }
+  bool GetDataLength() const  { return _flags.test(DATALENGTH); }
   void                SetUnknownFrame(const char*);
 
 protected:
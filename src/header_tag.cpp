@@ -31,10 +31,12 @@
 #include "tag.h"
 #include "io_helpers.h"
 #include "spec.h"
+#include "stats.h"
 
 using namespace dami;
 
 const char* const ID3_TagHeader::ID = "ID3";
+const char* const ID3_TagHeader::FOOTER_ID = "3DI";
 
 bool ID3_TagHeader::SetSpec(ID3_V2Spec spec)
 {
@@ -67,8 +69,11 @@ void ID3_TagHeader::Render(ID3_Writer& writer) const
 {
   writer.writeChars((uchar *) ID, strlen(ID));
 
-  writer.writeChar(ID3_V2SpecToVer(ID3V2_LATEST));
-  writer.writeChar(ID3_V2SpecToRev(ID3V2_LATEST));
+  // tags are written as ID3V2_LATEST, unless explicitly set to v2.4.0
+  const ID3_V2Spec spec =
+    (this->GetSpec() == ID3V2_4_0) ? ID3V2_4_0 : ID3V2_LATEST;
+  writer.writeChar(ID3_V2SpecToVer(spec));
+  writer.writeChar(ID3_V2SpecToRev(spec));
 
   // set the flags byte in the header
   writer.writeChar(static_cast<uchar>(_flags.get() & MASK8));
@@ -98,8 +103,20 @@ void ID3_TagHeader::Render(ID3_Writer& writer) const
   }
 }
 
+void ID3_TagHeader::RenderFooter(ID3_Writer& writer) const
+{
+  // the footer is a copy of the header with a different identifier, so that
+  // the tag can be found when scanning backwards from the end of a file
+  writer.writeChars((uchar *) FOOTER_ID, strlen(FOOTER_ID));
+  writer.writeChar(ID3_V2SpecToVer(ID3V2_4_0));
+  writer.writeChar(ID3_V2SpecToRev(ID3V2_4_0));
+  writer.writeChar(static_cast<uchar>(_flags.get() & MASK8));
+  io::writeUInt28(writer, this->GetDataSize());
+}
+
 bool ID3_TagHeader::Parse(ID3_Reader& reader)
 {
+  ID3_STATS_TIMER(V2_HEADER);
   io::ExitTrigger et(reader);
   if (!ID3_Tag::IsV2Tag(reader))
   {
@@ -131,8 +148,38 @@ bool ID3_TagHeader::Parse(ID3_Reader& reader)
   return true;
 }
 
+size_t ID3_TagHeader::ParseFooter(ID3_Reader& reader)
+{
+  io::ExitTrigger et(reader);
+  if (reader.getEnd() < reader.getCur() + SIZE)
+  {
+    return 0;
+  }
+  uchar footer[SIZE];
+  reader.readChars(footer, SIZE);
+  if (memcmp(footer, FOOTER_ID, ID_SIZE) != 0 ||
+      footer[MAJOR_OFFSET] != ID3_V2SpecToVer(ID3V2_4_0) ||
+      footer[MINOR_OFFSET] == 0xFF ||
+      !(footer[FLAGS_OFFSET] & HEADER_FLAG_FOOTER))
+  {
+    return 0;
+  }
+  size_t dataSize = 0;
+  for (size_t i = SIZE_OFFSET; i < SIZE; ++i)
+  {
+    if (footer[i] & 0x80)
+    {
+      return 0;
+    }
+    dataSize = (dataSize << 7) | footer[i];
+  }
+  // header + data + footer
+  return SIZE + dataSize + SIZE;
+}
+
 void ID3_TagHeader::ParseExtended(ID3_Reader& reader)
 {
+  ID3_STATS_TIMER(V2_HEADER);
   if (this->GetSpec() == ID3V2_3_0)
   {
 /*
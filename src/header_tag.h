@@ -58,8 +58,12 @@ public:
   bool   SetSpec(ID3_V2Spec);
   size_t Size() const;
   void Render(ID3_Writer&) const;
+  void RenderFooter(ID3_Writer&) const;
   bool Parse(ID3_Reader&);
   void ParseExtended(ID3_Reader&);
+  // Parses a v2.4.0 footer at the reader's cursor and returns the size of
+  // the whole tag it closes, or 0 if there is no footer
+  static size_t ParseFooter(ID3_Reader&);
   ID3_TagHeader& operator=(const ID3_TagHeader&hdr)
   { this->ID3_Header::operator=(hdr); return *this; }
 
@@ -98,6 +102,8 @@ public:
   // ff = flags byte 
   // ss = size bytes (less than $80)
   static const char* const ID;
+  // id3v2.4.0 footer signature: $33 44 49 04 00 ff ss ss ss ss
+  static const char* const FOOTER_ID;
   enum
   {
     ID_SIZE        = 3,
@@ -0,0 +1,657 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002  Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#if defined HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <algorithm>
+#include "io_batch.h"
+
+#if defined HAVE_PTHREAD_H && defined HAVE_LIBPTHREAD
+#  define ID3_HAVE_BATCH_THREADS 1
+#  include <pthread.h>
+#endif
+
+#if defined ID3_HAVE_FILE_DESCRIPTORS
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined HAVE_LINUX_FS_H && defined HAVE_LINUX_FIEMAP_H && \
+    defined HAVE_SYS_IOCTL_H
+#  include <sys/ioctl.h>
+#  include <linux/fs.h>
+#  include <linux/fiemap.h>
+#endif
+
+#if defined HAVE_LINUX_IO_URING_H && defined HAVE_SYS_SYSCALL_H && \
+    defined HAVE_SYS_MMAN_H && defined HAVE_MMAP
+#  include <linux/io_uring.h>
+#  include <sys/syscall.h>
+#  include <sys/mman.h>
+#  if defined __NR_io_uring_setup && defined __NR_io_uring_enter
+#    define ID3_HAVE_IO_URING 1
+#  endif
+#endif
+
+#endif /* ID3_HAVE_FILE_DESCRIPTORS */
+
+using namespace dami;
+
+namespace
+{
+#if defined ID3_HAVE_BATCH_THREADS
+  struct ParallelWork
+  {
+    void (*fn)(void*, size_t);
+    void* arg;
+    size_t count;
+    size_t next;
+    pthread_mutex_t lock;
+  };
+
+  void* parallelWorker(void* arg)
+  {
+    ParallelWork* work = static_cast<ParallelWork*>(arg);
+    for (;;)
+    {
+      ::pthread_mutex_lock(&work->lock);
+      const size_t i = work->next++;
+      ::pthread_mutex_unlock(&work->lock);
+      if (i >= work->count)
+      {
+        break;
+      }
+      work->fn(work->arg, i);
+    }
+    return NULL;
+  }
+#endif
+}
+
+void io::forEachParallel(size_t count, size_t threads,
+                         void (*fn)(void*, size_t), void* arg)
+{
+  threads = min(threads, count);
+#if defined ID3_HAVE_BATCH_THREADS
+  if (threads > 1)
+  {
+    ParallelWork work;
+    work.fn = fn;
+    work.arg = arg;
+    work.count = count;
+    work.next = 0;
+    ::pthread_mutex_init(&work.lock, NULL);
+    std::vector<pthread_t> workers(threads);
+    std::vector<bool> started(threads, false);
+    for (size_t k = 1; k < threads; ++k)
+    {
+      started[k] = ::pthread_create(&workers[k], NULL, parallelWorker, &work) == 0;
+    }
+    // this thread works too, so that all gets done if none could be started
+    parallelWorker(&work);
+    for (size_t k = 1; k < threads; ++k)
+    {
+      if (started[k])
+      {
+        ::pthread_join(workers[k], NULL);
+      }
+    }
+    ::pthread_mutex_destroy(&work.lock);
+    return;
+  }
+#endif
+  for (size_t i = 0; i < count; ++i)
+  {
+    fn(arg, i);
+  }
+}
+
+#if defined ID3_HAVE_FILE_DESCRIPTORS
+
+namespace
+{
+  enum { OP_OPEN, OP_READ };
+
+  // An open or a read, done either way
+  struct FileOp
+  {
+    int kind;
+    const char* name;   // of the file to open
+    int fd;             // of the file to read
+    uchar* buf;
+    size_t len;
+    off_t off;
+    long result;        // the fd opened or the bytes read, < 0 if it failed
+    bool done;
+  };
+
+  FileOp openOp(const char* name)
+  {
+    FileOp op;
+    ::memset(&op, 0, sizeof(op));
+    op.kind = OP_OPEN;
+    op.name = name;
+    op.fd = -1;
+    return op;
+  }
+
+  FileOp readOp(int fd, uchar* buf, size_t len, off_t off)
+  {
+    FileOp op;
+    ::memset(&op, 0, sizeof(op));
+    op.kind = OP_READ;
+    op.fd = fd;
+    op.buf = buf;
+    op.len = len;
+    op.off = off;
+    return op;
+  }
+
+  void runOp(void* arg, size_t i)
+  {
+    FileOp& op = static_cast<FileOp*>(arg)[i];
+    if (op.kind == OP_OPEN)
+    {
+      op.result = ::open(op.name, O_RDONLY);
+    }
+    else
+    {
+      op.result = io::readAt(op.fd, op.buf, op.len, op.off);
+    }
+    op.done = true;
+  }
+}
+
+namespace
+{
+  // where a file lies: on which device, and at what physical offset or
+  // else inode number
+  struct DiskPosition
+  {
+    enum { PHYSICAL, INODE, UNKNOWN };
+    int kind;
+    uint64 dev;
+    uint64 pos;
+    size_t index;
+
+    bool operator<(const DiskPosition& rhs) const
+    {
+      if (dev != rhs.dev)
+      {
+        return dev < rhs.dev;
+      }
+      if (kind != rhs.kind)
+      {
+        return kind < rhs.kind;
+      }
+      if (pos != rhs.pos)
+      {
+        return pos < rhs.pos;
+      }
+      return index < rhs.index;
+    }
+  };
+
+  // the physical offset of the first extent of the file
+  bool firstExtent(int fd, uint64& pos)
+  {
+#if defined FS_IOC_FIEMAP
+    union
+    {
+      struct fiemap map;
+      char buf[sizeof(struct fiemap) + sizeof(struct fiemap_extent)];
+    } req;
+    ::memset(&req, 0, sizeof(req));
+    req.map.fm_start = 0;
+    req.map.fm_length = ~req.map.fm_length;
+    req.map.fm_extent_count = 1;
+    if (::ioctl(fd, FS_IOC_FIEMAP, &req.map) == 0 &&
+        req.map.fm_mapped_extents > 0 &&
+        !(req.map.fm_extents[0].fe_flags & FIEMAP_EXTENT_UNKNOWN))
+    {
+      pos = req.map.fm_extents[0].fe_physical;
+      return true;
+    }
+#endif
+    return false;
+  }
+
+  DiskPosition diskPosition(const char* name, size_t index)
+  {
+    DiskPosition where;
+    where.kind = DiskPosition::UNKNOWN;
+    where.dev = 0;
+    where.pos = 0;
+    where.index = index;
+    const int fd = ::open(name, O_RDONLY);
+    struct stat st;
+    if (fd >= 0 && ::fstat(fd, &st) == 0)
+    {
+      where.dev = st.st_dev;
+      where.kind = DiskPosition::INODE;
+      where.pos = st.st_ino;
+      if (firstExtent(fd, where.pos))
+      {
+        where.kind = DiskPosition::PHYSICAL;
+      }
+    }
+    if (fd >= 0)
+    {
+      ::close(fd);
+    }
+    return where;
+  }
+}
+
+void io::diskOrder(const char* const names[], size_t count,
+                   std::vector<size_t>& order)
+{
+  std::vector<DiskPosition> where;
+  where.reserve(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    where.push_back(diskPosition(names[i], i));
+  }
+  std::sort(where.begin(), where.end());
+  order.clear();
+  for (size_t i = 0; i < count; ++i)
+  {
+    order.push_back(where[i].index);
+  }
+}
+
+#if defined ID3_HAVE_IO_URING
+
+namespace dami
+{
+  namespace io
+  {
+    // Just what BatchPrefetcher needs of an io_uring, without liburing: a
+    // submission and a completion queue shared with the kernel, filled and
+    // emptied here.
+    class Ring
+    {
+      int _fd;
+      unsigned _entries;
+      void* _sqMap;
+      size_t _sqMapSize;
+      void* _cqMap;
+      size_t _cqMapSize;
+      io_uring_sqe* _sqes;
+      size_t _sqesSize;
+      unsigned* _sqTail;
+      unsigned _sqMask;
+      unsigned* _sqArray;
+      unsigned* _cqHead;
+      unsigned* _cqTail;
+      unsigned _cqMask;
+      io_uring_cqe* _cqes;
+
+      void prepare(io_uring_sqe& sqe, const FileOp& op, size_t i);
+      size_t reap(FileOp ops[]);
+      void close();
+
+     public:
+      Ring(unsigned entries);
+      ~Ring();
+
+      bool isOpen() const { return _fd >= 0; }
+      // does as many of the ops as the kernel will; the others are left
+      // undone.  The ring is closed if the kernel fails it.
+      void run(FileOp ops[], size_t count);
+    };
+  };
+};
+
+io::Ring::Ring(unsigned entries)
+  : _fd(-1), _entries(0), _sqMap(MAP_FAILED), _sqMapSize(0),
+    _cqMap(MAP_FAILED), _cqMapSize(0), _sqes(NULL), _sqesSize(0)
+{
+  io_uring_params p;
+  ::memset(&p, 0, sizeof(p));
+  _fd = ::syscall(__NR_io_uring_setup, entries, &p);
+  if (_fd < 0)
+  {
+    ID3D_NOTICE( "io::Ring: no io_uring, errno = " << errno );
+    _fd = -1;
+    return;
+  }
+  _entries = p.sq_entries;
+  _sqMapSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  _cqMapSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    _sqMapSize = _cqMapSize = max(_sqMapSize, _cqMapSize);
+  }
+  _sqMap = ::mmap(NULL, _sqMapSize, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQ_RING);
+  if (p.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    _cqMap = _sqMap;
+  }
+  else
+  {
+    _cqMap = ::mmap(NULL, _cqMapSize, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_CQ_RING);
+  }
+  _sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = ::mmap(NULL, _sqesSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, _fd, IORING_OFF_SQES);
+  if (_sqMap == MAP_FAILED || _cqMap == MAP_FAILED || sqes == MAP_FAILED)
+  {
+    if (sqes != MAP_FAILED)
+    {
+      ::munmap(sqes, _sqesSize);
+    }
+    this->close();
+    return;
+  }
+  _sqes = static_cast<io_uring_sqe*>(sqes);
+
+  char* sq = static_cast<char*>(_sqMap);
+  _sqTail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+  _sqMask = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+  _sqArray = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+  char* cq = static_cast<char*>(_cqMap);
+  _cqHead = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+  _cqTail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+  _cqMask = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+  _cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+}
+
+io::Ring::~Ring()
+{
+  this->close();
+}
+
+void io::Ring::close()
+{
+  if (_sqes != NULL)
+  {
+    ::munmap(_sqes, _sqesSize);
+    _sqes = NULL;
+  }
+  if (_cqMap != MAP_FAILED && _cqMap != _sqMap)
+  {
+    ::munmap(_cqMap, _cqMapSize);
+  }
+  if (_sqMap != MAP_FAILED)
+  {
+    ::munmap(_sqMap, _sqMapSize);
+  }
+  _sqMap = _cqMap = MAP_FAILED;
+  if (_fd >= 0)
+  {
+    ::close(_fd);
+    _fd = -1;
+  }
+}
+
+void io::Ring::prepare(io_uring_sqe& sqe, const FileOp& op, size_t i)
+{
+  ::memset(&sqe, 0, sizeof(sqe));
+  if (op.kind == OP_OPEN)
+  {
+    sqe.opcode = IORING_OP_OPENAT;
+    sqe.fd = AT_FDCWD;
+    sqe.addr = reinterpret_cast<unsigned long>(op.name);
+    sqe.open_flags = O_RDONLY;
+  }
+  else
+  {
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = op.fd;
+    sqe.addr = reinterpret_cast<unsigned long>(op.buf);
+    sqe.len = op.len;
+    sqe.off = op.off;
+  }
+  sqe.user_data = i;
+}
+
+// takes what the kernel has completed off the queue
+size_t io::Ring::reap(FileOp ops[])
+{
+  size_t reaped = 0;
+  unsigned head = *_cqHead;
+  const unsigned tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+  for (; head != tail; ++head, ++reaped)
+  {
+    const io_uring_cqe& cqe = _cqes[head & _cqMask];
+    FileOp& op = ops[cqe.user_data];
+    op.result = cqe.res;
+    op.done = true;
+  }
+  __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+  return reaped;
+}
+
+void io::Ring::run(FileOp ops[], size_t count)
+{
+  size_t next = 0;          // the first op not queued yet
+  size_t queued = 0;        // queued, but not taken by the kernel yet
+  size_t inFlight = 0;      // queued, and not completed yet
+  bool failed = false;
+  while ((next < count && !failed) || inFlight > (failed ? queued : 0))
+  {
+    unsigned tail = *_sqTail;
+    while (!failed && next < count && inFlight < _entries)
+    {
+      const unsigned index = tail & _sqMask;
+      this->prepare(_sqes[index], ops[next], next);
+      _sqArray[index] = index;
+      ++tail;
+      ++next;
+      ++queued;
+      ++inFlight;
+    }
+    __atomic_store_n(_sqTail, tail, __ATOMIC_RELEASE);
+
+    const long n = ::syscall(__NR_io_uring_enter, _fd, failed ? 0 : queued, 1,
+                             IORING_ENTER_GETEVENTS, NULL, 0);
+    if (n < 0)
+    {
+      if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+      {
+        ID3D_WARNING( "io::Ring::run: io_uring_enter failed, errno = " << errno );
+        // wait for what the kernel took, and leave the rest to the caller
+        failed = true;
+      }
+    }
+    else
+    {
+      queued -= min<size_t>(queued, n);
+    }
+    inFlight -= this->reap(ops);
+  }
+  if (failed)
+  {
+    this->close();
+  }
+}
+
+#endif /* ID3_HAVE_IO_URING */
+
+io::BatchPrefetcher::BatchPrefetcher(size_t depth, bool async)
+  : _ring(NULL), _depth(max<size_t>(1, depth)),
+    _threads(min(_depth, BATCH_IO_THREADS))
+{
+#if defined ID3_HAVE_IO_URING
+  if (async)
+  {
+    // the head and the tail of each file are read at once
+    _ring = new Ring(2 * _depth);
+    if (!_ring->isOpen())
+    {
+      delete _ring;
+      _ring = NULL;
+    }
+  }
+#endif
+}
+
+io::BatchPrefetcher::~BatchPrefetcher()
+{
+#if defined ID3_HAVE_IO_URING
+  delete _ring;
+#endif
+}
+
+namespace
+{
+  void runOps(io::Ring*& ring, FileOp ops[], size_t count, size_t threads)
+  {
+#if defined ID3_HAVE_IO_URING
+    if (ring)
+    {
+      ring->run(ops, count);
+      if (!ring->isOpen())
+      {
+        delete ring;
+        ring = NULL;
+      }
+      // whatever the kernel couldn't do (an old one has no IORING_OP_OPENAT)
+      // is done here
+      for (size_t i = 0; i < count; ++i)
+      {
+        if (!ops[i].done || ops[i].result < 0)
+        {
+          runOp(ops, i);
+        }
+      }
+      return;
+    }
+#endif
+    io::forEachParallel(count, threads, runOp, ops);
+  }
+}
+
+void io::BatchPrefetcher::prefetch(const char* const names[],
+                                   PrefetchedFile files[], size_t count)
+{
+  count = min(count, _depth);
+  std::vector<FileOp> ops;
+  ops.reserve(2 * count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    ops.push_back(openOp(names[i]));
+  }
+  runOps(_ring, &ops[0], ops.size(), _threads);
+
+  // the head and the tail, as PrefetchFileReader reads them
+  std::vector<size_t> which;
+  std::vector<bool> isHead;
+  for (size_t i = 0; i < count; ++i)
+  {
+    PrefetchedFile& file = files[i];
+    file.fd = ops[i].result;
+    file.size = 0;
+    file.tailBeg = 0;
+    file.head.erase();
+    file.tail.erase();
+    struct stat st;
+    if (file.fd >= 0 && ::fstat(file.fd, &st) != 0)
+    {
+      ::close(file.fd);
+      file.fd = -1;
+    }
+    if (file.fd < 0)
+    {
+      file.fd = -1;
+      continue;
+    }
+    file.size = st.st_size;
+    file.head.resize(min<size_t>(file.size, PREFETCH_HEAD));
+    file.tailBeg = max(file.head.size(), file.size - min(file.size, PREFETCH_TAIL));
+    file.tail.resize(file.size - file.tailBeg);
+  }
+  ops.clear();
+  for (size_t i = 0; i < count; ++i)
+  {
+    PrefetchedFile& file = files[i];
+    if (!file.head.empty())
+    {
+      ops.push_back(readOp(file.fd, &file.head[0], file.head.size(), 0));
+      which.push_back(i);
+      isHead.push_back(true);
+    }
+    if (!file.tail.empty())
+    {
+      ops.push_back(readOp(file.fd, &file.tail[0], file.tail.size(), file.tailBeg));
+      which.push_back(i);
+      isHead.push_back(false);
+    }
+  }
+  if (!ops.empty())
+  {
+    runOps(_ring, &ops[0], ops.size(), _threads);
+  }
+  for (size_t k = 0; k < ops.size(); ++k)
+  {
+    PrefetchedFile& file = files[which[k]];
+    BString& data = isHead[k] ? file.head : file.tail;
+    data.resize(max<long>(0, ops[k].result));
+  }
+
+  // a tag larger than the head is completed with a second read, up to the
+  // tail
+  ops.clear();
+  which.clear();
+  for (size_t i = 0; i < count; ++i)
+  {
+    PrefetchedFile& file = files[i];
+    if (file.fd < 0)
+    {
+      continue;
+    }
+    const size_t numRead = file.head.size();
+    const size_t wanted = min(file.tailBeg,
+      prefetchHeadSize(file.head.data(), numRead, file.size));
+    if (wanted > numRead)
+    {
+      file.head.resize(wanted);
+      ops.push_back(readOp(file.fd, &file.head[numRead], wanted - numRead, numRead));
+      which.push_back(i);
+    }
+  }
+  if (!ops.empty())
+  {
+    runOps(_ring, &ops[0], ops.size(), _threads);
+  }
+  for (size_t k = 0; k < ops.size(); ++k)
+  {
+    PrefetchedFile& file = files[which[k]];
+    file.head.resize(ops[k].off + max<long>(0, ops[k].result));
+  }
+}
+
+#endif /* ID3_HAVE_FILE_DESCRIPTORS */
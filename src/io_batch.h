@@ -0,0 +1,84 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002  Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_IO_BATCH_H_
+#define _ID3LIB_IO_BATCH_H_
+
+#include <vector>
+#include "io_file.h"
+
+namespace dami
+{
+  namespace io
+  {
+    // Calls fn(arg, i) for each i below count, on up to threads threads
+    void forEachParallel(size_t count, size_t threads,
+                         void (*fn)(void*, size_t), void* arg);
+
+#if defined ID3_HAVE_FILE_DESCRIPTORS
+    // Returns the indexes of the files in the order their data lies on disk,
+    // so that a disk reading them one after another seeks forward.  Where
+    // the file system can't tell (FIEMAP), files are ordered by inode.
+    void diskOrder(const char* const names[], size_t count,
+                   std::vector<size_t>& order);
+
+    // Most threads that read files when there's no io_uring
+    const size_t BATCH_IO_THREADS = 16;
+
+    class Ring;
+
+    // Opens many files and reads their heads and tails, as
+    // PrefetchFileReader does for one, with up to depth files in flight.  The
+    // requests go through an io_uring when the kernel has one; else they're
+    // spread over threads.
+    class BatchPrefetcher
+    {
+      Ring* _ring;
+      size_t _depth;
+      size_t _threads;
+
+      BatchPrefetcher(const BatchPrefetcher&);
+      BatchPrefetcher& operator=(const BatchPrefetcher&);
+
+     public:
+      BatchPrefetcher(size_t depth, bool async = true);
+      ~BatchPrefetcher();
+
+      bool isAsync() const { return _ring != NULL; }
+      size_t getDepth() const { return _depth; }
+
+      // Fills in a PrefetchedFile for each of at most getDepth() names; one
+      // that couldn't be opened is left with an fd of -1
+      void prefetch(const char* const names[], PrefetchedFile files[],
+                    size_t count);
+    };
+#endif /* ID3_HAVE_FILE_DESCRIPTORS */
+  };
+};
+
+#endif /* _ID3LIB_IO_BATCH_H_ */
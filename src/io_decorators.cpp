@@ -30,6 +30,7 @@
 
 
 
+#include <string.h>
 #include "id3/io_decorators.h" //has "readers.h" "io_helpers.h" "utils.h"
 #include "zlib.h"
 
@@ -144,6 +145,25 @@ ID3_Reader::size_type io::WindowedReader::readChars(char_type buf[], size_type l
   return size;
 }
 
+ID3_Reader::int_type io::CountingReader::readChar()
+{
+  _stats.readCharCalls++;
+  int_type ch = _reader.readChar();
+  if (ch != END_OF_READER)
+  {
+    _stats.bytesRead++;
+  }
+  return ch;
+}
+
+ID3_Reader::size_type io::CountingReader::readChars(char_type buf[], size_type len)
+{
+  _stats.readCharsCalls++;
+  size_type numRead = _reader.readChars(buf, len);
+  _stats.bytesRead += numRead;
+  return numRead;
+}
+
 ID3_Reader::size_type io::CharReader::readChars(char_type buf[], size_type len)
 {
   size_type numChars = 0;
@@ -196,6 +216,59 @@ ID3_Reader::int_type io::UnsyncedReader::readChar()
   return ch;
 }
 
+io::TailBufferedReader::TailBufferedReader(ID3_Reader& reader, size_type size)
+  : _reader(reader), _beg(reader.getBeg()), _end(reader.getEnd()),
+    _tailBeg(reader.getEnd()), _cur(reader.getCur())
+{
+  // a reader that doesn't know its end has no tail to keep
+  if (_end != pos_type(-1) && _end > _beg)
+  {
+    _tailBeg = _end - min<size_type>(size, _end - _beg);
+    _tail.resize(_end - _tailBeg);
+    _reader.setCur(_tailBeg);
+    _tail.resize(_reader.readChars(&_tail[0], _tail.size()));
+    _end = _tailBeg + _tail.size();
+    _reader.setCur(_cur);
+  }
+}
+
+ID3_Reader::int_type io::TailBufferedReader::peekChar()
+{
+  if (_cur >= _end)
+  {
+    return END_OF_READER;
+  }
+  if (_cur >= _tailBeg)
+  {
+    return _tail[_cur - _tailBeg];
+  }
+  _reader.setCur(_cur);
+  return _reader.peekChar();
+}
+
+ID3_Reader::size_type io::TailBufferedReader::readChars(char_type buf[], size_type len)
+{
+  size_type numRead = 0;
+  if (_cur < _tailBeg)
+  {
+    _reader.setCur(_cur);
+    numRead = _reader.readChars(buf, min<size_type>(len, _tailBeg - _cur));
+    _cur += numRead;
+    if (_cur < _tailBeg)
+    {
+      return numRead;
+    }
+  }
+  if (numRead < len && _cur < _end)
+  {
+    const size_type size = min<size_type>(len - numRead, _end - _cur);
+    ::memcpy(buf + numRead, _tail.data() + (_cur - _tailBeg), size);
+    numRead += size;
+    _cur += size;
+  }
+  return numRead;
+}
+
 io::CompressedReader::CompressedReader(ID3_Reader& reader, size_type newSize)
   : _uncompressed(new char_type[newSize])
 {
@@ -203,11 +276,14 @@ io::CompressedReader::CompressedReader(ID3_Reader& reader, size_type newSize)
   
   BString binary = readBinary(reader, oldSize);
   
+  // uncompress() writes an unsigned long, which is wider than size_type on
+  // 64 bit platforms
+  luint destSize = newSize;
   ::uncompress(_uncompressed,
-               reinterpret_cast<luint*>(&newSize),
+               &destSize,
                reinterpret_cast<const uchar*>(binary.data()),
                oldSize);
-  this->setBuffer(_uncompressed, newSize);
+  this->setBuffer(_uncompressed, destSize);
 }
 
 io::CompressedReader::~CompressedReader()
@@ -254,6 +330,26 @@ io::UnsyncedWriter::writeChars(const char_type buf[], size_type len)
   return numChars;
 }
 
+ID3_Writer::int_type io::CountingWriter::writeChar(char_type ch)
+{
+  _stats.writeCharCalls++;
+  int_type result = _writer.writeChar(ch);
+  if (result != END_OF_WRITER)
+  {
+    _stats.bytesWritten++;
+  }
+  return result;
+}
+
+ID3_Writer::size_type
+io::CountingWriter::writeChars(const char_type buf[], size_type len)
+{
+  _stats.writeCharsCalls++;
+  size_type numWritten = _writer.writeChars(buf, len);
+  _stats.bytesWritten += numWritten;
+  return numWritten;
+}
+
 void io::CompressedWriter::flush()
 {
   if (_data.size() == 0)
@@ -0,0 +1,537 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002  Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#if defined HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "io_file.h"
+#include "stats.h"
+
+#if defined ID3_HAVE_FILE_DESCRIPTORS
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined HAVE_SYS_SENDFILE_H
+#  include <sys/sendfile.h>
+#endif
+
+#if defined HAVE_SYS_IOCTL_H && defined HAVE_LINUX_FS_H
+#  include <sys/ioctl.h>
+#  include <linux/fs.h>
+#endif
+
+using namespace dami;
+
+namespace
+{
+  // A heap buffer aligned on a page boundary, freed when it goes out of
+  // scope.  Falls back to plain malloc when posix_memalign isn't available.
+  class AlignedBuffer
+  {
+    void* _buf;
+    size_t _size;
+  public:
+    AlignedBuffer(size_t size) : _buf(NULL), _size(0)
+    {
+#if defined HAVE_POSIX_MEMALIGN
+      if (::posix_memalign(&_buf, 4096, size) != 0)
+      {
+        _buf = NULL;
+      }
+#else
+      _buf = ::malloc(size);
+#endif
+      if (_buf != NULL)
+      {
+        _size = size;
+      }
+    }
+    ~AlignedBuffer() { ::free(_buf); }
+    char* data() const { return static_cast<char*>(_buf); }
+    size_t size() const { return _size; }
+  };
+
+  bool isAligned(off_t off, size_t blksize)
+  {
+    return blksize > 0 && (off % blksize) == 0;
+  }
+
+  // Shares the blocks of the source range with the destination file.  Only
+  // possible on file systems that support reflinks (btrfs, xfs, ...) and only
+  // when the offsets are block aligned.  Returns the number of bytes cloned,
+  // which is either len or 0.
+  size_t cloneRange(int fd_in, off_t off_in, int fd_out, off_t off_out,
+                    size_t len)
+  {
+#if defined FICLONERANGE
+    struct file_clone_range fcr;
+    fcr.src_fd = fd_in;
+    fcr.src_offset = off_in;
+    fcr.src_length = len;
+    fcr.dest_offset = off_out;
+    const int result = ::ioctl(fd_out, FICLONERANGE, &fcr);
+    ID3_STATS_SYSCALL(result == 0 ? len : 0);
+    if (result == 0)
+    {
+      ID3D_NOTICE( "io::cloneRange: cloned " << len << " bytes" );
+      return len;
+    }
+#endif
+    return 0;
+  }
+
+  // copy_file_range() lets the kernel copy (or reflink, or offload to the
+  // storage server) without the data ever entering user space.
+  size_t kernelCopyRange(int fd_in, off_t off_in, int fd_out, off_t off_out,
+                         size_t len)
+  {
+    size_t copied = 0;
+#if defined HAVE_COPY_FILE_RANGE
+    loff_t in = off_in, out = off_out;
+    while (copied < len)
+    {
+      ssize_t n = ::copy_file_range(fd_in, &in, fd_out, &out,
+                                    len - copied, 0);
+      ID3_STATS_SYSCALL(n > 0 ? n : 0);
+      if (n <= 0)
+      {
+        break;
+      }
+      copied += n;
+    }
+#endif
+    return copied;
+  }
+
+  // sendfile() into a regular file: the copy stays in the page cache.  Its
+  // output position is that of fd_out, so seek there first.
+  size_t sendFileRange(int fd_in, off_t off_in, int fd_out, off_t off_out,
+                       size_t len)
+  {
+    size_t copied = 0;
+#if defined HAVE_SENDFILE && defined HAVE_SYS_SENDFILE_H
+    if (::lseek(fd_out, off_out, SEEK_SET) != off_out)
+    {
+      return 0;
+    }
+    off_t in = off_in;
+    while (copied < len)
+    {
+      ssize_t n = ::sendfile(fd_out, fd_in, &in, len - copied);
+      ID3_STATS_SYSCALL(n > 0 ? n : 0);
+      if (n <= 0)
+      {
+        break;
+      }
+      copied += n;
+    }
+#endif
+    return copied;
+  }
+
+  // Tells the kernel that the file is read here and there, so that it
+  // doesn't read ahead
+  void adviseRandom(int fd)
+  {
+#if defined HAVE_POSIX_FADVISE
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM);
+#endif
+  }
+
+  // Tells the kernel that the range won't be read again
+  void adviseDontNeed(int fd, off_t off, size_t len)
+  {
+#if defined HAVE_POSIX_FADVISE
+    ::posix_fadvise(fd, off, len, POSIX_FADV_DONTNEED);
+#endif
+  }
+
+  // The size of the id3v2 tag at the start of data, header and footer
+  // included, or 0 if there is none
+  size_t v2TagSize(const uchar* data, size_t size)
+  {
+    if (size < 10 || data[0] != 'I' || data[1] != 'D' || data[2] != '3' ||
+        data[3] == 0xFF || data[4] == 0xFF ||
+        ((data[6] | data[7] | data[8] | data[9]) & 0x80))
+    {
+      return 0;
+    }
+    size_t tagSize = (data[6] << 21) | (data[7] << 14) | (data[8] << 7) | data[9];
+    tagSize += 10;
+    if (data[5] & 0x10)
+    {
+      tagSize += 10;
+    }
+    return tagSize;
+  }
+
+  size_t bufferedCopyRange(int fd_in, off_t off_in, int fd_out, off_t off_out,
+                           size_t len)
+  {
+    AlignedBuffer buffer(io::FILE_COPY_BUFSIZE);
+    if (buffer.data() == NULL)
+    {
+      return 0;
+    }
+    size_t copied = 0;
+    while (copied < len)
+    {
+      size_t want = dami::min(len - copied, buffer.size());
+      ssize_t nRead = ::pread(fd_in, buffer.data(), want, off_in + copied);
+      ID3_STATS_SYSCALL(nRead > 0 ? nRead : 0);
+      if (nRead <= 0)
+      {
+        if (nRead < 0 && errno == EINTR)
+        {
+          continue;
+        }
+        break;
+      }
+      size_t nWritten = 0;
+      while (nWritten < (size_t) nRead)
+      {
+        ssize_t n = ::pwrite(fd_out, buffer.data() + nWritten,
+                             nRead - nWritten, off_out + copied + nWritten);
+        ID3_STATS_SYSCALL(n > 0 ? n : 0);
+        if (n <= 0)
+        {
+          if (n < 0 && errno == EINTR)
+          {
+            continue;
+          }
+          return copied + nWritten;
+        }
+        nWritten += n;
+      }
+      copied += nWritten;
+    }
+    return copied;
+  }
+};
+
+size_t io::getBlockSize(int fd)
+{
+  struct stat st;
+  if (::fstat(fd, &st) == 0 && st.st_blksize > 0)
+  {
+    return st.st_blksize;
+  }
+  return 4096;
+}
+
+size_t io::writeAll(int fd, const void* buf, size_t len)
+{
+  const char* data = static_cast<const char*>(buf);
+  size_t written = 0;
+  while (written < len)
+  {
+    ssize_t n = ::write(fd, data + written, len - written);
+    ID3_STATS_SYSCALL(n > 0 ? n : 0);
+    if (n <= 0)
+    {
+      if (n < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      break;
+    }
+    written += n;
+  }
+  return written;
+}
+
+size_t io::readAt(int fd, void* buf, size_t len, off_t off)
+{
+  char* data = static_cast<char*>(buf);
+  size_t numRead = 0;
+  while (numRead < len)
+  {
+    ssize_t n = ::pread(fd, data + numRead, len - numRead, off + numRead);
+    ID3_STATS_SYSCALL(n > 0 ? n : 0);
+    if (n <= 0)
+    {
+      if (n < 0 && errno == EINTR)
+      {
+        continue;
+      }
+      break;
+    }
+    numRead += n;
+  }
+  return numRead;
+}
+
+size_t io::copyFileData(int fd_in, off_t off_in, int fd_out, off_t off_out,
+                        size_t len)
+{
+  ID3D_NOTICE( "io::copyFileData: copying " << len << " bytes from " <<
+               off_in << " to " << off_out );
+  if (len == 0)
+  {
+    return 0;
+  }
+
+  size_t copied = 0;
+
+  // Clone whatever whole blocks we can.  The unaligned tail (if any) is left
+  // for the mechanisms below.
+  size_t blksize = io::getBlockSize(fd_out);
+  if (fd_in != fd_out && isAligned(off_in, blksize) &&
+      isAligned(off_out, blksize))
+  {
+    size_t whole = len - (len % blksize);
+    if (whole > 0)
+    {
+      copied = cloneRange(fd_in, off_in, fd_out, off_out, whole);
+    }
+  }
+
+  if (copied < len)
+  {
+    copied += kernelCopyRange(fd_in, off_in + copied, fd_out, off_out + copied,
+                              len - copied);
+  }
+  if (copied < len)
+  {
+    copied += sendFileRange(fd_in, off_in + copied, fd_out, off_out + copied,
+                            len - copied);
+  }
+  if (copied < len)
+  {
+    copied += bufferedCopyRange(fd_in, off_in + copied, fd_out,
+                                off_out + copied, len - copied);
+  }
+
+  if (copied < len)
+  {
+    ID3D_WARNING( "io::copyFileData: only copied " << copied << " of " <<
+                  len << " bytes" );
+  }
+  return copied;
+}
+
+size_t io::moveFileData(int fd, off_t src, off_t dst, size_t len)
+{
+  ID3D_NOTICE( "io::moveFileData: moving " << len << " bytes from " <<
+               src << " to " << dst );
+  if (dst >= src)
+  {
+    return 0;
+  }
+
+  // A buffered copy from front to back is always safe: each block is read
+  // before anything at or beyond it is written.  When the distance between
+  // src and dst is small, that's also the cheapest way of doing it.
+  const size_t gap = src - dst;
+  if (gap < io::FILE_COPY_BUFSIZE)
+  {
+    return bufferedCopyRange(fd, src, fd, dst, len);
+  }
+
+  // Otherwise move in chunks no larger than the gap, so that source and
+  // destination never overlap and the kernel can copy each chunk for us.
+  const size_t chunk = dami::min(gap, (size_t) 64 * io::FILE_COPY_BUFSIZE);
+  size_t moved = 0;
+  while (moved < len)
+  {
+    size_t want = dami::min(len - moved, chunk);
+    size_t n = kernelCopyRange(fd, src + moved, fd, dst + moved, want);
+    if (n < want)
+    {
+      // no kernel support; finish the job with the buffer
+      moved += n;
+      moved += bufferedCopyRange(fd, src + moved, fd, dst + moved,
+                                 len - moved);
+      break;
+    }
+    moved += n;
+  }
+  if (moved < len)
+  {
+    ID3D_WARNING( "io::moveFileData: only moved " << moved << " of " <<
+                  len << " bytes" );
+  }
+  return moved;
+}
+
+size_t io::prefetchHeadSize(const uchar* head, size_t size, size_t fileSize)
+{
+  if (size < PREFETCH_HEAD)
+  {
+    return size;
+  }
+  return max(size, min(fileSize, v2TagSize(head, size) + PREFETCH_FRAMES));
+}
+
+/** Opens the named file and reads its head and tail.  Use isOpen() to see
+ ** if it could be opened.
+ **/
+io::PrefetchFileReader::PrefetchFileReader(const char* name)
+  : _fd(::open(name, O_RDONLY)), _size(0), _cur(0), _tailBeg(0)
+{
+  struct stat st;
+  if (_fd < 0 || ::fstat(_fd, &st) != 0)
+  {
+    this->close();
+    return;
+  }
+  _size = st.st_size;
+  // the parsers jump from the head to the tail: don't read ahead
+  adviseRandom(_fd);
+
+  _head.resize(min<size_t>(_size, PREFETCH_HEAD));
+  _head.resize(readAt(_fd, &_head[0], _head.size(), 0));
+  // a tag larger than the first read is completed with a second one
+  const size_t wanted = io::prefetchHeadSize(_head.data(), _head.size(), _size);
+  if (wanted > _head.size())
+  {
+    const size_t numRead = _head.size();
+    _head.resize(wanted);
+    _head.resize(numRead + readAt(_fd, &_head[numRead], wanted - numRead,
+                                  numRead));
+  }
+
+  // the tail needn't overlap the head, it can start where the head ends
+  _tailBeg = max<pos_type>(_head.size(), _size - min<size_t>(_size, PREFETCH_TAIL));
+  if (_tailBeg < _size)
+  {
+    _tail.resize(_size - _tailBeg);
+    _tail.resize(readAt(_fd, &_tail[0], _tail.size(), _tailBeg));
+  }
+  ID3D_NOTICE( "io::PrefetchFileReader: read " << _head.size() <<
+               " head bytes and " << _tail.size() << " tail bytes" );
+}
+
+io::PrefetchFileReader::PrefetchFileReader(PrefetchedFile& file)
+  : _fd(file.fd), _size(file.size), _cur(0), _tailBeg(file.tailBeg)
+{
+  _head.swap(file.head);
+  _tail.swap(file.tail);
+  file.fd = -1;
+  file.size = 0;
+  file.tailBeg = 0;
+}
+
+io::PrefetchFileReader::~PrefetchFileReader()
+{
+  this->close();
+}
+
+void io::PrefetchFileReader::close()
+{
+  if (_fd >= 0)
+  {
+    ::close(_fd);
+    _fd = -1;
+  }
+}
+
+// reads from the file what isn't in the head or the tail
+ID3_Reader::size_type io::PrefetchFileReader::readFile(char_type buf[],
+                                                      size_type len)
+{
+  if (_fd < 0)
+  {
+    return 0;
+  }
+  const size_t numRead = readAt(_fd, buf, len, _cur);
+  if (numRead >= PREFETCH_BULK)
+  {
+    // a scan through the audio: there's no point in caching what it read
+    adviseDontNeed(_fd, _cur, numRead);
+  }
+  return numRead;
+}
+
+ID3_Reader::int_type io::PrefetchFileReader::peekChar()
+{
+  if (_cur >= _size)
+  {
+    return END_OF_READER;
+  }
+  if (_cur < _head.size())
+  {
+    return _head[_cur];
+  }
+  if (_cur >= _tailBeg && _cur - _tailBeg < _tail.size())
+  {
+    return _tail[_cur - _tailBeg];
+  }
+  char_type ch;
+  if (this->readFile(&ch, 1) < 1)
+  {
+    return END_OF_READER;
+  }
+  return ch;
+}
+
+ID3_Reader::size_type io::PrefetchFileReader::readChars(char_type buf[],
+                                                       size_type len)
+{
+  len = min<size_type>(len, _size - _cur);
+  size_type numRead = 0;
+  while (numRead < len)
+  {
+    size_type size = 0;
+    if (_cur < _head.size())
+    {
+      size = min<size_type>(len - numRead, _head.size() - _cur);
+      ::memcpy(buf + numRead, _head.data() + _cur, size);
+    }
+    else if (_cur >= _tailBeg && _cur - _tailBeg < _tail.size())
+    {
+      size = min<size_type>(len - numRead, _tail.size() - (_cur - _tailBeg));
+      ::memcpy(buf + numRead, _tail.data() + (_cur - _tailBeg), size);
+    }
+    else
+    {
+      // up to the tail, if it's ahead
+      size_type want = len - numRead;
+      if (_cur < _tailBeg)
+      {
+        want = min<size_type>(want, _tailBeg - _cur);
+      }
+      size = this->readFile(buf + numRead, want);
+      if (size == 0)
+      {
+        break;
+      }
+    }
+    numRead += size;
+    _cur += size;
+  }
+  return numRead;
+}
+
+#endif /* ID3_HAVE_FILE_DESCRIPTORS */
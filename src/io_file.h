@@ -0,0 +1,152 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002  Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_IO_FILE_H_
+#define _ID3LIB_IO_FILE_H_
+
+#include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
+#include "id3/reader.h"
+
+#if defined HAVE_UNISTD_H && defined HAVE_FCNTL_H
+#  define ID3_HAVE_FILE_DESCRIPTORS 1
+#endif
+
+namespace dami
+{
+  namespace io
+  {
+    // Most symbolic links followed one after another before giving up, on
+    // the grounds that they loop
+    const int SYMLINK_MAX_DEPTH = 32;
+
+#if defined ID3_HAVE_FILE_DESCRIPTORS
+    // Size of the buffer used when the kernel can't copy for us.  Large and
+    // page aligned, so that each read/write pair is a single big syscall.
+    const size_t FILE_COPY_BUFSIZE = 1024 * 1024;
+
+    // Returns the preferred I/O block size of the file system holding fd,
+    // which is also the granularity at which blocks can be shared (cloned).
+    size_t getBlockSize(int fd);
+
+    // Writes all len bytes of buf to fd at the current position.  Returns the
+    // number of bytes actually written.
+    size_t writeAll(int fd, const void* buf, size_t len);
+
+    // Reads len bytes of fd at off, unless the file ends before.  Returns the
+    // number of bytes read.
+    size_t readAt(int fd, void* buf, size_t len, off_t off);
+
+    // Copies len bytes from fd_in at off_in to fd_out at off_out.  The
+    // cheapest mechanism available is used: a block clone (reflink) when both
+    // offsets are block aligned, then copy_file_range, then sendfile, and
+    // finally a buffered pread/pwrite loop.  Returns the number of bytes
+    // copied; anything less than len means an I/O error occured.
+    size_t copyFileData(int fd_in, off_t off_in, int fd_out, off_t off_out,
+                        size_t len);
+
+    // Moves len bytes within the file fd from src to dst, where dst < src.
+    // Used to shift the audio data towards the beginning of the file when a
+    // prepended tag is stripped.  The kernel mechanisms of copyFileData are
+    // used in chunks that never overlap.
+    size_t moveFileData(int fd, off_t src, off_t dst, size_t len);
+
+    // What PrefetchFileReader reads when it opens a file: the start, grown
+    // to hold an id3v2 tag and this much audio after it, and the end.
+    const size_t PREFETCH_HEAD = 128 * 1024;
+    const size_t PREFETCH_FRAMES = 64 * 1024;
+    const size_t PREFETCH_TAIL = 64 * 1024;
+    // reads past the prefetched blocks at least this large are a bulk scan,
+    // and aren't kept in the page cache
+    const size_t PREFETCH_BULK = 64 * 1024;
+
+    // How much of the start of a file to prefetch, given the first
+    // PREFETCH_HEAD bytes of it: more when they begin a larger id3v2 tag
+    size_t prefetchHeadSize(const uchar* head, size_t size, size_t fileSize);
+
+    // A file opened, and its head and tail read, by someone else than the
+    // PrefetchFileReader that is given it
+    struct PrefetchedFile
+    {
+      int fd;
+      size_t size;
+      BString head;       // the bytes from 0 on
+      BString tail;       // the bytes from tailBeg on
+      size_t tailBeg;
+    };
+
+    // Reads a file for parsing its tags with as few requests as possible,
+    // which is what counts on network file systems.  Opening it reads the
+    // head (the id3v2 tag and the first mpeg frames) and the tail (the tags
+    // at the end) in two large reads; the parsers are served from those, and
+    // anything else is read from the file as asked for.
+    class PrefetchFileReader : public ID3_Reader
+    {
+      int _fd;
+      pos_type _size;
+      pos_type _cur;
+      BString _head;       // the bytes from 0 on
+      BString _tail;       // the bytes from _tailBeg on
+      pos_type _tailBeg;
+
+      size_type readFile(char_type buf[], size_type len);
+
+     public:
+      PrefetchFileReader(const char* name);
+      // takes over the file, and leaves the PrefetchedFile empty
+      PrefetchFileReader(PrefetchedFile&);
+      virtual ~PrefetchFileReader();
+
+      bool isOpen() const { return _fd >= 0; }
+      int getFd() const { return _fd; }
+
+      void close();
+      pos_type getEnd() { return _size; }
+      pos_type getCur() { return _cur; }
+      pos_type setCur(pos_type cur)
+      {
+        _cur = min(cur, _size);
+        return _cur;
+      }
+
+      int_type peekChar();
+      size_type readChars(char_type buf[], size_type len);
+      size_type readChars(char buf[], size_type len)
+      {
+        return this->readChars(reinterpret_cast<char_type *>(buf), len);
+      }
+      size_type skipChars(size_type len)
+      {
+        const pos_type cur = _cur;
+        return this->setCur(_cur + len) - cur;
+      }
+    };
+#endif /* ID3_HAVE_FILE_DESCRIPTORS */
+  };
+};
+
+#endif /* _ID3LIB_IO_FILE_H_ */
@@ -29,6 +29,7 @@
 #include <stdio.h>
 
 #include "misc_support.h"
+#include "id3/mp3_index.h"
 //#include "field.h"
 #include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
 
@@ -1170,3 +1171,37 @@ ID3_Frame *ID3_GetSyncLyrics(const ID3_Tag* tag, const char* lang,
   return frmExist;
 }
 
+
+// Adds an MLLT frame built from the frame index of a full scan (see
+// ID3_Tag::SetFullScan()), with a reference every framesBetween frames.
+// Returns NULL if the tag has no frame index, or already has a lookup table
+// and replace is false.
+ID3_Frame* ID3_AddMpegLookupTable(ID3_Tag* tag, size_t framesBetween,
+                                  bool replace)
+{
+  ID3_Frame* frame = NULL;
+  if (NULL == tag || NULL == tag->GetMp3FrameIndex())
+  {
+    return frame;
+  }
+  ID3_Frame* old = NULL;
+  if (replace)
+  {
+    while ((old = tag->Find(ID3FID_MPEGLOOKUP)))
+    {
+      delete tag->RemoveFrame(old);
+    }
+  }
+  else if (tag->Find(ID3FID_MPEGLOOKUP))
+  {
+    return frame;
+  }
+  ID3_Mp3LookupTable table;
+  if (table.Build(*tag->GetMp3FrameIndex(), framesBetween))
+  {
+    frame = new ID3_Frame(ID3FID_MPEGLOOKUP);
+    table.Render(*frame);
+    tag->AttachFrame(frame);
+  }
+  return frame;
+}
@@ -29,16 +29,60 @@
 #define _MP3_HEADER_H_
 
 #include "io_decorators.h" //has "readers.h" "io_helpers.h" "utils.h"
+#include "mp3_index.h"
+#include "mp3_vbr.h"
+
+namespace dami
+{
+  namespace mp3
+  {
+    // the bits of a frame header that are the same for all frames of a file:
+    // sync, version, layer and sample rate
+    const uint32 HEADER_MASK = 0xFFFE0C00;
+
+    uint32 readHeader(const uchar*);
+    // all of these return 0 when the header isn't a valid frame header
+    size_t frameSize(uint32 header);
+    uint32 bitrate(uint32 header);
+    uint32 frequency(uint32 header);
+    uint32 samplesPerFrame(uint32 header);
+    size_t xingOffset(uint32 header);
+    bool   isVbrHeaderFrame(const uchar* frame, size_t size);
+
+    // the most a crc check reads past the frame header: the crc itself and
+    // the side information it covers
+    const size_t MAX_CRC_DATA = 2 + 32;
+
+    uint16 crc16(const uchar* data, size_t size, uint16 crc = 0xFFFF);
+    size_t crcSize(uint32 header);
+    Mp3_Crc checkCrc(const uchar* frame, size_t size);
+
+    // a sync is only trusted when this many frames follow each other
+    const size_t SYNC_FRAMES = 4;
+    // which takes no more than this many bytes
+    const size_t SYNC_LOOKAHEAD = 16 * 1024;
+
+    size_t findSync(const uchar* data, size_t size, size_t limit, bool atEnd);
+  };
+};
 
 class Mp3Info
 {
 public:
-  Mp3Info() { _mp3_header_output = new Mp3_Headerinfo; };
+  Mp3Info() : _frame_index(NULL), _vbr_header(NULL) { _mp3_header_output = new Mp3_Headerinfo; };
   ~Mp3Info() { this->Clean(); };
   void Clean();
 
   const Mp3_Headerinfo* GetMp3HeaderInfo() const { return _mp3_header_output; };
   bool Parse(ID3_Reader&, size_t mp3size);
+  void SetSizeUnknown();
+  void Restore(const Mp3_Headerinfo&, const uchar* frame, size_t size,
+               size_t offset, size_t mp3size);
+  bool Scan(ID3_Reader&, size_t mp3size, dami::String fileName = "",
+            bool checkCrc = false);
+
+  const ID3_Mp3FrameIndex* GetFrameIndex() const { return _frame_index; };
+  const ID3_Mp3VbrHeader* GetVbrHeader() const { return _vbr_header; };
 
   Mpeg_Layers Layer() const { return _mp3_header_output->layer; };
   Mpeg_Version Version() const { return _mp3_header_output->version; };
@@ -105,6 +149,8 @@ private:
 #endif // WORDS_BIGENDIAN
 
   Mp3_Headerinfo* _mp3_header_output;
+  ID3_Mp3FrameIndex* _frame_index;  // only after a Scan()
+  ID3_Mp3VbrHeader* _vbr_header;    // only if the first frame has one
 }; //Info
 
 #endif /* _MP3_HEADER_H_ */
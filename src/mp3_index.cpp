@@ -0,0 +1,220 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#if defined HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "id3/mp3_index.h"
+
+/** \class ID3_Mp3FrameIndex mp3_index.h id3/mp3_index.h
+ ** \brief The file offsets of the mpeg audio frames of a file.
+ **
+ ** The index is filled by a full scan of the audio frames (see
+ ** ID3_Tag::SetFullScan()), which also gives the exact number of frames and
+ ** so the exact playtime of the file, vbr or not.  Offsets are stored as the
+ ** two byte distance from one frame to the next, so that the index of a file
+ ** playing for hours takes a few megabytes at most.
+ **
+ ** The first frame of a vbr file that only holds a Xing, Info or VBRI
+ ** header isn't part of the index, as it holds no audio.
+ **
+ ** When the scan checks the crc of the frames (see ID3_Tag::SetCrcCheck()),
+ ** the index counts the frames that have one and keeps the numbers of those
+ ** whose crc doesn't match, which points at damaged audio without decoding
+ ** it.
+ **/
+ID3_Mp3FrameIndex::ID3_Mp3FrameIndex()
+{
+  this->Clear();
+}
+
+void ID3_Mp3FrameIndex::Clear()
+{
+  _marks.clear();
+  _steps.clear();
+  _far.clear();
+  _count = 0;
+  _last = 0;
+  _end = 0;
+  _audio_bytes = 0;
+  _frequency = 0;
+  _samples_per_frame = 0;
+  _crc_frames = 0;
+  _crc_errors.clear();
+}
+
+/** Sets the sample rate and the number of samples in each frame, which are
+ ** the same for all the frames of a file.
+ **/
+void ID3_Mp3FrameIndex::SetFormat(uint32 frequency, uint32 samplesPerFrame)
+{
+  _frequency = frequency;
+  _samples_per_frame = samplesPerFrame;
+}
+
+/** Adds the frame at the given file offset, which must lie beyond the frames
+ ** added so far, with the given size in bytes.
+ **/
+void ID3_Mp3FrameIndex::AddFrame(size_t offset, size_t size)
+{
+  if (_count % MARK_INTERVAL == 0)
+  {
+    _marks.push_back(offset);
+    _steps.push_back(0);
+  }
+  else if (offset - _last > 0xFFFF)
+  {
+    _steps.push_back(0);
+    _far[_count] = offset;
+  }
+  else
+  {
+    _steps.push_back(static_cast<uint16>(offset - _last));
+  }
+  ++_count;
+  _last = offset;
+  _end = offset + size;
+  _audio_bytes += size;
+}
+
+/** Adds the frames of another index, which must all lie beyond the frames in
+ ** this one.
+ **/
+void ID3_Mp3FrameIndex::Append(const ID3_Mp3FrameIndex& other)
+{
+  if (other._count == 0)
+  {
+    return;
+  }
+  const size_t bytes = _audio_bytes + other._audio_bytes;
+  for (size_t i = 0; i < other._crc_errors.size(); ++i)
+  {
+    _crc_errors.push_back(_count + other._crc_errors[i]);
+  }
+  _crc_frames += other._crc_frames;
+  size_t offset = 0;
+  for (size_t i = 0; i < other._count; ++i)
+  {
+    if (i % MARK_INTERVAL == 0)
+    {
+      offset = other._marks[i / MARK_INTERVAL];
+    }
+    else if (other._steps[i] == 0)
+    {
+      offset = other._far.find(i)->second;
+    }
+    else
+    {
+      offset += other._steps[i];
+    }
+    this->AddFrame(offset, 0);
+  }
+  _end = other._end;
+  _audio_bytes = bytes;
+}
+
+/** Records the result of the crc check of the last frame added.  Frames
+ ** without a crc aren't counted.
+ **/
+void ID3_Mp3FrameIndex::AddCrcResult(Mp3_Crc crc)
+{
+  if (crc == MP3CRC_NONE || _count == 0)
+  {
+    return;
+  }
+  ++_crc_frames;
+  if (crc != MP3CRC_OK)
+  {
+    _crc_errors.push_back(_count - 1);
+  }
+}
+
+/** Returns the number of the num'th frame whose crc didn't match, or
+ ** GetFrameCount() if num is GetCrcErrorCount() or more.
+ **/
+size_t ID3_Mp3FrameIndex::GetCrcError(size_t num) const
+{
+  return num < _crc_errors.size() ? _crc_errors[num] : _count;
+}
+
+/** Returns the file offset of the given frame, or the end of the last frame
+ ** when frame is GetFrameCount() or more.
+ **/
+size_t ID3_Mp3FrameIndex::GetFrameOffset(size_t frame) const
+{
+  if (frame >= _count)
+  {
+    return _end;
+  }
+  size_t i = frame - frame % MARK_INTERVAL;
+  size_t offset = _marks[i / MARK_INTERVAL];
+  for (++i; i <= frame; ++i)
+  {
+    if (_steps[i] == 0)
+    {
+      offset = _far.find(i)->second;
+    }
+    else
+    {
+      offset += _steps[i];
+    }
+  }
+  return offset;
+}
+
+/** Returns the playtime of all the frames in the index, in milliseconds. */
+uint32 ID3_Mp3FrameIndex::GetDuration() const
+{
+  return this->GetFrameTime(_count);
+}
+
+/** Returns the time at which the given frame starts playing, in
+ ** milliseconds.
+ **/
+uint32 ID3_Mp3FrameIndex::GetFrameTime(size_t frame) const
+{
+  if (_frequency == 0)
+  {
+    return 0;
+  }
+  return static_cast<uint32>((double) frame * _samples_per_frame * 1000 /
+                             _frequency + 0.5);
+}
+
+/** Returns the frame playing at the given time, in milliseconds.  The result
+ ** is GetFrameCount() for times past the end.
+ **/
+size_t ID3_Mp3FrameIndex::GetFrameAt(uint32 ms) const
+{
+  if (_samples_per_frame == 0)
+  {
+    return 0;
+  }
+  double frame = (double) ms * _frequency / 1000 / _samples_per_frame;
+  return frame < _count ? static_cast<size_t>(frame) : _count;
+}
@@ -0,0 +1,274 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#if defined HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <algorithm>
+#include "id3/mp3_index.h"
+#include "id3/id3lib_frame.h"
+#include "id3/field.h"
+#include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
+
+using namespace dami;
+
+namespace
+{
+  uint32 bitsFor(uint32 val)
+  {
+    uint32 bits = 0;
+    for (; val > 0; val >>= 1)
+    {
+      ++bits;
+    }
+    return bits;
+  }
+
+  // the deviations are packed most significant bit first, with no padding
+  // between them
+  void putBits(BString& data, size_t& pos, uint32 val, uint32 bits)
+  {
+    for (uint32 i = bits; i > 0; --i, ++pos)
+    {
+      if (pos % 8 == 0)
+      {
+        data += static_cast<uchar>(0);
+      }
+      if ((val >> (i - 1)) & 1)
+      {
+        data[pos / 8] |= static_cast<uchar>(0x80 >> (pos % 8));
+      }
+    }
+  }
+
+  uint32 getBits(const uchar* data, size_t& pos, uint32 bits)
+  {
+    uint32 val = 0;
+    for (uint32 i = 0; i < bits; ++i, ++pos)
+    {
+      val = (val << 1) | ((data[pos / 8] >> (7 - pos % 8)) & 1);
+    }
+    return val;
+  }
+
+  const uint32 MAX_BETWEEN = 0xFFFFFF;
+}
+
+/** \class ID3_Mp3LookupTable mp3_index.h id3/mp3_index.h
+ ** \brief The contents of an MLLT (MPEG location lookup table) frame.
+ **
+ ** The table holds a reference every GetFramesBetween() mpeg frames, with
+ ** the byte offset and the time of the frame.  Each reference is stored as
+ ** its distance to the previous one, which is a fixed number of bytes and
+ ** milliseconds plus a deviation of a few bits, so that the table of a long
+ ** file is small enough to keep in the tag.  Build() fills the table from
+ ** the frame index of a full scan; see ID3_AddMpegLookupTable().
+ **
+ ** A player seeks with TimeToByteOffset(), which finds the last reference
+ ** before the given time in the table, without reading the audio.  The
+ ** offsets in the frame are counted from the first mpeg frame, which is
+ ** usually right after the tag; pass its file offset to Parse().
+ **
+ ** \code
+ **   const ID3_Frame* frame = myTag.Find(ID3FID_MPEGLOOKUP);
+ **   ID3_Mp3LookupTable table;
+ **   if (frame && table.Parse(*frame, myTag.GetPrependedBytes()))
+ **   {
+ **     file.seekg(table.TimeToByteOffset(90 * 1000)); // 1:30 into the song
+ **   }
+ ** \endcode
+ **/
+ID3_Mp3LookupTable::ID3_Mp3LookupTable()
+{
+  this->Clear();
+}
+
+void ID3_Mp3LookupTable::Clear()
+{
+  _base = 0;
+  _frames_between = 0;
+  _bytes_between = 0;
+  _ms_between = 0;
+  _bytes_bits = 0;
+  _ms_bits = 0;
+  _offsets.clear();
+  _times.clear();
+}
+
+/** Fills the table from the frames of a full scan, with a reference every
+ ** framesBetween frames.  Returns false if the index holds fewer frames.
+ **/
+bool ID3_Mp3LookupTable::Build(const ID3_Mp3FrameIndex& index,
+                               size_t framesBetween)
+{
+  this->Clear();
+  const size_t count = index.GetFrameCount();
+  if (framesBetween == 0 || framesBetween > 0xFFFF || count < framesBetween)
+  {
+    return false;
+  }
+  _base = index.GetFrameOffset(0);
+  _frames_between = framesBetween;
+  _offsets.push_back(0);
+  _times.push_back(0);
+
+  uint32 minBytes = MAX_BETWEEN, maxBytes = 0;
+  uint32 minMs = MAX_BETWEEN, maxMs = 0;
+  for (size_t frame = framesBetween; frame <= count; frame += framesBetween)
+  {
+    const size_t offset = index.GetFrameOffset(frame) - _base;
+    const uint32 ms = index.GetFrameTime(frame);
+    const uint32 bytes = static_cast<uint32>(offset - _offsets.back());
+    const uint32 time = ms - _times.back();
+    minBytes = min(minBytes, bytes);
+    maxBytes = max(maxBytes, bytes);
+    minMs = min(minMs, time);
+    maxMs = max(maxMs, time);
+    _offsets.push_back(offset);
+    _times.push_back(ms);
+  }
+  _bytes_between = minBytes;
+  _ms_between = minMs;
+  _bytes_bits = bitsFor(maxBytes - minBytes);
+  _ms_bits = bitsFor(maxMs - minMs);
+  // each reference must take a whole number of bytes, and at least one so
+  // that the number of references follows from the size of the frame
+  const uint32 bits = _bytes_bits + _ms_bits;
+  _bytes_bits += (bits == 0) ? 8 : (8 - bits % 8) % 8;
+  return true;
+}
+
+/** Reads the table from an MLLT frame.  The reference offsets are counted
+ ** from base, the file offset of the first mpeg frame.
+ **/
+bool ID3_Mp3LookupTable::Parse(const ID3_Frame& frame, size_t base)
+{
+  this->Clear();
+  if (frame.GetID() != ID3FID_MPEGLOOKUP)
+  {
+    return false;
+  }
+  const ID3_Field* data = frame.GetField(ID3FN_DATA);
+  _base = base;
+  _frames_between = frame.GetField(ID3FN_FRAMESBETWEEN)->Get();
+  _bytes_between = frame.GetField(ID3FN_BYTESBETWEEN)->Get();
+  _ms_between = frame.GetField(ID3FN_MSBETWEEN)->Get();
+  _bytes_bits = frame.GetField(ID3FN_BYTESDEVBITS)->Get();
+  _ms_bits = frame.GetField(ID3FN_MSDEVBITS)->Get();
+  const size_t bits = _bytes_bits + _ms_bits;
+  if (_frames_between == 0 || bits == 0 || _bytes_bits > 32 || _ms_bits > 32 ||
+      NULL == data)
+  {
+    ID3D_WARNING( "ID3_Mp3LookupTable::Parse(): bad table" );
+    this->Clear();
+    return false;
+  }
+  const uchar* raw = data->GetRawBinary();
+  const size_t refs = data->Size() * 8 / bits;
+  _offsets.reserve(refs + 1);
+  _times.reserve(refs + 1);
+  _offsets.push_back(0);
+  _times.push_back(0);
+  size_t pos = 0;
+  for (size_t i = 0; i < refs; ++i)
+  {
+    const uint32 bytes = getBits(raw, pos, _bytes_bits);
+    const uint32 ms = getBits(raw, pos, _ms_bits);
+    _offsets.push_back(_offsets.back() + _bytes_between + bytes);
+    _times.push_back(_times.back() + _ms_between + ms);
+  }
+  return true;
+}
+
+/** Writes the table to an MLLT frame.  Returns false if the table is empty
+ ** or the frame isn't an MLLT frame.
+ **/
+bool ID3_Mp3LookupTable::Render(ID3_Frame& frame) const
+{
+  if (frame.GetID() != ID3FID_MPEGLOOKUP || _offsets.size() < 2)
+  {
+    return false;
+  }
+  BString data;
+  data.reserve(((_offsets.size() - 1) * (_bytes_bits + _ms_bits) + 7) / 8);
+  size_t pos = 0;
+  for (size_t i = 1; i < _offsets.size(); ++i)
+  {
+    putBits(data, pos, _offsets[i] - _offsets[i - 1] - _bytes_between, _bytes_bits);
+    putBits(data, pos, _times[i] - _times[i - 1] - _ms_between, _ms_bits);
+  }
+  frame.GetField(ID3FN_FRAMESBETWEEN)->Set(_frames_between);
+  frame.GetField(ID3FN_BYTESBETWEEN)->Set(_bytes_between);
+  frame.GetField(ID3FN_MSBETWEEN)->Set(_ms_between);
+  frame.GetField(ID3FN_BYTESDEVBITS)->Set(_bytes_bits);
+  frame.GetField(ID3FN_MSDEVBITS)->Set(_ms_bits);
+  frame.GetField(ID3FN_DATA)->Set(data.data(), data.size());
+  return true;
+}
+
+/** Returns the file offset of the given reference, the first (number 0)
+ ** being the first mpeg frame.
+ **/
+size_t ID3_Mp3LookupTable::GetReferenceOffset(size_t ref) const
+{
+  return ref < _offsets.size() ? _base + _offsets[ref] : _base;
+}
+
+/** Returns the time of the given reference, in milliseconds. */
+uint32 ID3_Mp3LookupTable::GetReferenceTime(size_t ref) const
+{
+  return ref < _times.size() ? _times[ref] : 0;
+}
+
+/** Returns the file offset of the last reference at or before the given
+ ** time, in milliseconds.
+ **/
+size_t ID3_Mp3LookupTable::TimeToByteOffset(uint32 ms) const
+{
+  if (_times.empty())
+  {
+    return _base;
+  }
+  std::vector<uint32>::const_iterator next =
+    std::upper_bound(_times.begin(), _times.end(), ms);
+  return _base + _offsets[(next - _times.begin()) - 1];
+}
+
+/** Returns the time of the last reference at or before the given file
+ ** offset, in milliseconds.
+ **/
+uint32 ID3_Mp3LookupTable::ByteOffsetToTime(size_t offset) const
+{
+  if (_offsets.empty() || offset <= _base)
+  {
+    return 0;
+  }
+  std::vector<size_t>::const_iterator next =
+    std::upper_bound(_offsets.begin(), _offsets.end(), offset - _base);
+  return _times[(next - _offsets.begin()) - 1];
+}
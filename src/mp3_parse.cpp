@@ -26,35 +26,7 @@
 // http://download.sourceforge.net/id3lib/
 
 #include "mp3_header.h"
-
-#define FRAMES_FLAG     0x0001
-#define BYTES_FLAG      0x0002
-#define TOC_FLAG        0x0004
-#define SCALE_FLAG      0x0008
-
-static int ExtractI4(unsigned char *buf)
-{
-  int x;
-
-#ifdef WORDS_BIGENDIAN
-
-  return * (int*) buf;
-
-#else
-  // big endian extract
-
-  x = buf[0];
-  x <<= 8;
-  x |= buf[1];
-  x <<= 8;
-  x |= buf[2];
-  x <<= 8;
-  x |= buf[3];
-
-  return x;
-
-#endif
-}
+#include "stats.h"
 
 uint32 fto_nearest_i(float f)
 {
@@ -73,42 +45,66 @@ uint32 fto_nearest_i(float f)
     return i;
 }
 
-uint16 calcCRC(char *pFrame, size_t audiodatasize)
+void Mp3Info::Clean()
 {
-  size_t icounter;
-  int tmpchar, crcmask, tmpi;
-  uint16 crc = 0xffff;
+  if (_mp3_header_output != NULL)
+    delete _mp3_header_output;
+  _mp3_header_output = NULL;
+  delete _frame_index;
+  _frame_index = NULL;
+  delete _vbr_header;
+  _vbr_header = NULL;
+}
 
-  for (icounter = 2;  icounter < audiodatasize;  ++icounter)
+// Sets what Parse() found from a copy of it, as kept by ID3_TagCache.  The
+// vbr header is parsed again from its frame, the size bytes at offset.
+void Mp3Info::Restore(const Mp3_Headerinfo& info, const uchar* frame,
+                      size_t size, size_t offset, size_t mp3size)
+{
+  if (_mp3_header_output == NULL)
+    _mp3_header_output = new Mp3_Headerinfo;
+  *_mp3_header_output = info;
+  delete _frame_index;
+  _frame_index = NULL;
+  delete _vbr_header;
+  _vbr_header = NULL;
+  if (size > 0)
   {
-    if (icounter != 4  &&  icounter != 5) //skip the 2 chars of the crc itself
+    _vbr_header = new ID3_Mp3VbrHeader;
+    if (!_vbr_header->Parse(frame, size, offset, mp3size))
     {
-      crcmask = 1 << 8;
-      tmpchar = pFrame[icounter];
-      while (crcmask >>= 1)
-      {
-        tmpi = crc & 0x8000;
-        crc <<= 1;
-        if (!tmpi ^ !(tmpchar & crcmask))
-          crc ^= 0x8005;
-      }
+      delete _vbr_header;
+      _vbr_header = NULL;
     }
   }
-  crc &= 0xffff;
-  return crc;
 }
 
-void Mp3Info::Clean()
+// Called when the mp3 data was parsed from a stream of unknown length: the
+// number of frames and the playtime derived from the size passed to Parse()
+// are meaningless, unless a vbr header told us the number of frames.
+void Mp3Info::SetSizeUnknown()
 {
-  if (_mp3_header_output != NULL)
-    delete _mp3_header_output;
-  _mp3_header_output = NULL;
+  if (_mp3_header_output == NULL)
+    return;
+  if (_mp3_header_output->vbr_bitrate == 0 || _mp3_header_output->frequency == 0)
+  {
+    _mp3_header_output->frames = 0;
+    _mp3_header_output->time = 0;
+    return;
+  }
+  uint32 samples = 1152; // per frame
+  if (_mp3_header_output->layer == MPEGLAYER_I)
+    samples = 384;
+  else if (_mp3_header_output->layer == MPEGLAYER_III && _mp3_header_output->version != MPEGVERSION_1)
+    samples = 576;
+  _mp3_header_output->time = fto_nearest_i((float)_mp3_header_output->frames * samples / _mp3_header_output->frequency);
 }
 
 using namespace dami;
 
 bool Mp3Info::Parse(ID3_Reader& reader, size_t mp3size)
 {
+  ID3_STATS_TIMER(MP3_PARSE);
   MP3_BitRates _mp3_bitrates[2][3][16] =
   {
     {
@@ -238,7 +234,7 @@ bool Mp3Info::Parse(ID3_Reader& reader, size_t mp3size)
   const size_t HEADERSIZE = 4;//
   char buf[HEADERSIZE+1]; //+1 to hold the \0 char
   ID3_Reader::pos_type beg = reader.getCur() ;
-  ID3_Reader::pos_type end = beg + HEADERSIZE ;
+  const ID3_Reader::pos_type frame_beg = beg;
   reader.setCur(beg);
   int bitrate_index;
 
@@ -399,160 +395,52 @@ bool Mp3Info::Parse(ID3_Reader& reader, size_t mp3size)
   }
 
 //http://www.mp3-tech.org/programmer/frame_header.html
-  if (_mp3_header_output->bitrate != MP3BITRATE_NONE && _mp3_header_output->frequency > 0)
-  {
-
-    switch(_mp3_header_output->layer)
-    {
-      case MPEGLAYER_I: // Layer 1
-        _mp3_header_output->framesize = 4 * (12 * _mp3_header_output->bitrate / _mp3_header_output->frequency + (_tmpheader->padding_bit ? 1 : 0));
-        break;
-      case MPEGLAYER_II: // Layer 2
-        _mp3_header_output->framesize = 144 * _mp3_header_output->bitrate / _mp3_header_output->frequency + (_tmpheader->padding_bit ? 1 : 0);
-        break;
-      case MPEGLAYER_III: // Layer 3
-        if(_mp3_header_output->version == MPEGVERSION_2_5)
-          _mp3_header_output->framesize = 144 * _mp3_header_output->bitrate / _mp3_header_output->frequency + (_tmpheader->padding_bit ? 1 : 0); //Mpeg1
-        else
-          _mp3_header_output->framesize =  72000 * _mp3_header_output->bitrate / _mp3_header_output->frequency + (_tmpheader->padding_bit ? 1 : 0); //Mpeg2 + Mpeg2.5
-        break;
-      default:
-        _mp3_header_output->framesize = 0; //unable to determine
-        break;
-    }
-//    if (_mp3_header_output->layer == MPEGLAYER_I)
-//      _mp3_header_output->framesize = fto_nearest_i((float)((48 * (float)_mp3_header_output->bitrate) / _mp3_header_output->frequency)) + (_tmpheader->padding_bit ? 4 : 0);
-//    else
-//      _mp3_header_output->framesize = fto_nearest_i((float)((144 * (float)_mp3_header_output->bitrate) / _mp3_header_output->frequency)) + (_tmpheader->padding_bit ? 1 : 0);
-  }
-  else
-    _mp3_header_output->framesize = 0; //unable to determine
-
-  const size_t CRCSIZE = 2;
-  size_t sideinfo_len;
+  // 0 for a free format frame, which has no bitrate to tell its size
+  _mp3_header_output->framesize = mp3::frameSize(mp3::readHeader(reinterpret_cast<uchar*>(buf)));
 
-  if (_mp3_header_output->version == MPEGVERSION_1) /* MPEG 1 */
-    sideinfo_len = (_mp3_header_output->channelmode == MP3CHANNELMODE_SINGLE_CHANNEL) ? 4 + 17 : 4 + 32;
-  else                /* MPEG 2 */
-    sideinfo_len = (_mp3_header_output->channelmode == MP3CHANNELMODE_SINGLE_CHANNEL) ? 4 + 9 : 4 + 17;
-
-  int vbr_header_offest = beg + sideinfo_len;
   int vbr_frames = 0;
 
-  sideinfo_len += 2; // add two for the crc itself
-
-  if ((_mp3_header_output->crc == MP3CRC_OK) && mp3size < sideinfo_len)
-    _mp3_header_output->crc = MP3CRC_ERROR_SIZE;
-
+  // a mismatch doesn't mean the file is unusable
+  // it has just some bits in the wrong place
   if (_mp3_header_output->crc == MP3CRC_OK)
   {
-    char audiodata[38 + 1]; //+1 to hold the 0 char
-    uint16 crc16;
-    uint16 crcstored;
-
-    _mp3_header_output->crc = MP3CRC_MISMATCH; //as a starting point, we assume the worst
-
-    reader.setCur(beg);
-
-    reader.readChars(audiodata, sideinfo_len);
-    audiodata[sideinfo_len] = '\0';
-
-    crc16 = calcCRC(audiodata, sideinfo_len);
-
-    beg = end;
-    end = beg + CRCSIZE;
-
-    reader.setCur(beg);
-    crcstored = (uint16)io::readBENumber(reader, CRCSIZE);
-
-    // a mismatch doesn't mean the file is unusable
-    // it has just some bits in the wrong place
-    if (crcstored == crc16)
-      _mp3_header_output->crc = MP3CRC_OK;
+    uchar crcdata[HEADERSIZE + mp3::MAX_CRC_DATA];
+    reader.setCur(frame_beg);
+    const size_t crcsize = reader.readChars(crcdata, min(sizeof(crcdata), mp3size));
+    _mp3_header_output->crc = mp3::checkCrc(crcdata, crcsize);
   }
 
-  // read xing/vbr header if present
-  // derived from code in vbrheadersdk.zip
-  // from http://www.xingtech.com/developer/mp3/
-
-  const size_t VBR_HEADER_MIN_SIZE = 8;     // "xing" + flags are fixed
-  const size_t VBR_HEADER_MAX_SIZE = 120;   // frames, bytes, toc and scale are optional
+  // read the xing, info or vbri header if present, with the lame extension
+  // that may follow it
+  const size_t vbr_frame_size = min<size_t>(mp3::frameSize(mp3::readHeader(reinterpret_cast<uchar*>(buf))), mp3size);
+  int vbr_filesize = 0;
 
-  if (mp3size >= vbr_header_offest + VBR_HEADER_MIN_SIZE)
+  delete _vbr_header;
+  _vbr_header = NULL;
+  if (vbr_frame_size > 0)
   {
-    char vbrheaderdata[VBR_HEADER_MAX_SIZE+1]; //+1 to hold the 0 char
-    unsigned char *pvbrdata = (unsigned char *)vbrheaderdata;
-    int vbr_filesize = 0;
-    int vbr_scale = 0;
-    int vbr_flags = 0;
-
-    // get fixed part of vbr header
-    // and check if valid
-
-    beg = vbr_header_offest;
-    reader.setCur(beg);
-    reader.readChars(vbrheaderdata, VBR_HEADER_MIN_SIZE);
-    vbrheaderdata[VBR_HEADER_MIN_SIZE] = '\0';
-
-    if (pvbrdata[0] == 'X' &&
-        pvbrdata[1] == 'i' &&
-        pvbrdata[2] == 'n' &&
-        pvbrdata[3] == 'g')
+    BString vbrframe(vbr_frame_size, '\0');
+    reader.setCur(frame_beg);
+    vbrframe.resize(reader.readChars(&vbrframe[0], vbr_frame_size));
+
+    _vbr_header = new ID3_Mp3VbrHeader;
+    if (_vbr_header->Parse(vbrframe.data(), vbrframe.size(), frame_beg, mp3size))
     {
-      // get vbr flags
-      pvbrdata += 4;
-      vbr_flags = ExtractI4(pvbrdata);
-      pvbrdata += 4;
-
-      //  read entire vbr header
-      int vbr_header_size = VBR_HEADER_MIN_SIZE
-                           + ((vbr_flags & FRAMES_FLAG)? 4:0)
-                           + ((vbr_flags & BYTES_FLAG)? 4:0)
-                           + ((vbr_flags & TOC_FLAG)? 100:0)
-                           + ((vbr_flags & SCALE_FLAG)? 4:0);
-
-      if (mp3size >= vbr_header_offest + vbr_header_size)
-      {
-        reader.readChars(&vbrheaderdata[VBR_HEADER_MIN_SIZE], vbr_header_size - VBR_HEADER_MIN_SIZE);
-        vbrheaderdata[vbr_header_size] = '\0';
-
-        // get frames, bytes, toc and scale
-
-        if (vbr_flags & FRAMES_FLAG)
-        {
-          vbr_frames = ExtractI4(pvbrdata);
-          pvbrdata +=4;
-        }
-
-        if (vbr_flags & BYTES_FLAG)
-        {
-          vbr_filesize = ExtractI4(pvbrdata);
-          pvbrdata +=4;
-        }
-
-        if (vbr_flags & TOC_FLAG)
-        {
-          // seek offsets
-          // we are not using
-          // for(i=0;i<100;i++) seek_offsets[i] = pvbrdata[i];
-
-          pvbrdata +=100;
-        }
-
-        if (vbr_flags & SCALE_FLAG)
-        {
-          vbr_scale = ExtractI4(pvbrdata);
-          pvbrdata +=4;
-        }
-
-        if (vbr_frames > 0)
-        {
-          _mp3_header_output->vbr_bitrate = (((vbr_filesize!=0) ? vbr_filesize : mp3size) / vbr_frames) * _mp3_header_output->frequency / 144;
-          _mp3_header_output->vbr_bitrate -= _mp3_header_output->vbr_bitrate%1000;   // round the bitrate:
-        }
-      }
+      vbr_frames = _vbr_header->GetFrames();
+      vbr_filesize = _vbr_header->GetBytes();
+    }
+    else
+    {
+      delete _vbr_header;
+      _vbr_header = NULL;
     }
   }
+  // an info header is written for cbr files, where the bitrate says it all
+  if (vbr_frames > 0 && _vbr_header->GetType() != ID3_Mp3VbrHeader::VBR_INFO)
+  {
+    _mp3_header_output->vbr_bitrate = (((vbr_filesize!=0) ? vbr_filesize : mp3size) / vbr_frames) * _mp3_header_output->frequency / 144;
+    _mp3_header_output->vbr_bitrate -= _mp3_header_output->vbr_bitrate%1000;   // round the bitrate:
+  }
 
   if (_mp3_header_output->framesize > 0 && mp3size >= _mp3_header_output->framesize) // this means bitrate is not none too
   {
@@ -562,7 +450,9 @@ bool Mp3Info::Parse(ID3_Reader& reader, size_t mp3size)
       _mp3_header_output->frames = vbr_frames;
 
     // bitrate becomes byterate (per second) if divided by 8
-    if (_mp3_header_output->vbr_bitrate == 0)
+    if (vbr_frames > 0)
+      _mp3_header_output->time = (_vbr_header->GetDuration() + 500) / 1000;
+    else if (_mp3_header_output->vbr_bitrate == 0)
       _mp3_header_output->time = fto_nearest_i( (float)mp3size / (_mp3_header_output->bitrate / 8) );
     else
       _mp3_header_output->time = fto_nearest_i( (float)mp3size / (_mp3_header_output->vbr_bitrate / 8) );
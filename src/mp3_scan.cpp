@@ -0,0 +1,638 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#if defined HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include "mp3_header.h"
+
+#if defined HAVE_PTHREAD_H && defined HAVE_LIBPTHREAD && defined HAVE_UNISTD_H
+#  define ID3_HAVE_SCAN_THREADS 1
+#  include <pthread.h>
+#  include <unistd.h>
+#endif
+
+using namespace dami;
+
+namespace
+{
+  // in kbit/s, by [mpeg 1 or not][layer - 1][bitrate index]
+  const uint16 BITRATES[2][3][16] =
+  {
+    {
+      { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0 },
+      { 0, 32, 48, 56,  64,  80,  96, 112, 128, 160, 192, 224, 256, 320, 384, 0 },
+      { 0, 32, 40, 48,  56,  64,  80,  96, 112, 128, 160, 192, 224, 256, 320, 0 }
+    },
+    {
+      { 0, 32, 48, 56,  64,  80,  96, 112, 128, 144, 160, 176, 192, 224, 256, 0 },
+      { 0,  8, 16, 24,  32,  40,  48,  56,  64,  80,  96, 112, 128, 144, 160, 0 },
+      { 0,  8, 16, 24,  32,  40,  48,  56,  64,  80,  96, 112, 128, 144, 160, 0 }
+    }
+  };
+
+  // by [version id][frequency index]
+  const uint32 FREQUENCIES[4][4] =
+  {
+    { 11025, 12000,  8000, 0 },  // mpeg 2.5
+    {     0,     0,     0, 0 },  // reserved
+    { 22050, 24000, 16000, 0 },  // mpeg 2
+    { 44100, 48000, 32000, 0 }   // mpeg 1
+  };
+
+  uint32 versionId(uint32 header)  { return (header >> 19) & 3; }
+  uint32 layer(uint32 header)      { return 4 - ((header >> 17) & 3); }
+  bool   isMpeg1(uint32 header)    { return versionId(header) == 3; }
+  bool   isValid(uint32 header)
+  {
+    return (header & 0xFFE00000) == 0xFFE00000 && versionId(header) != 1 &&
+           layer(header) != 4 && ((header >> 12) & 15) != 0 &&
+           ((header >> 12) & 15) != 15 && ((header >> 10) & 3) != 3;
+  }
+
+  // the crc-16 of each byte value, for the polynomial 0x8005 of the mpeg
+  // frame crc
+  const uint16 CRC_TABLE[256] =
+  {
+    0x0000, 0x8005, 0x800F, 0x000A, 0x801B, 0x001E, 0x0014, 0x8011,
+    0x8033, 0x0036, 0x003C, 0x8039, 0x0028, 0x802D, 0x8027, 0x0022,
+    0x8063, 0x0066, 0x006C, 0x8069, 0x0078, 0x807D, 0x8077, 0x0072,
+    0x0050, 0x8055, 0x805F, 0x005A, 0x804B, 0x004E, 0x0044, 0x8041,
+    0x80C3, 0x00C6, 0x00CC, 0x80C9, 0x00D8, 0x80DD, 0x80D7, 0x00D2,
+    0x00F0, 0x80F5, 0x80FF, 0x00FA, 0x80EB, 0x00EE, 0x00E4, 0x80E1,
+    0x00A0, 0x80A5, 0x80AF, 0x00AA, 0x80BB, 0x00BE, 0x00B4, 0x80B1,
+    0x8093, 0x0096, 0x009C, 0x8099, 0x0088, 0x808D, 0x8087, 0x0082,
+    0x8183, 0x0186, 0x018C, 0x8189, 0x0198, 0x819D, 0x8197, 0x0192,
+    0x01B0, 0x81B5, 0x81BF, 0x01BA, 0x81AB, 0x01AE, 0x01A4, 0x81A1,
+    0x01E0, 0x81E5, 0x81EF, 0x01EA, 0x81FB, 0x01FE, 0x01F4, 0x81F1,
+    0x81D3, 0x01D6, 0x01DC, 0x81D9, 0x01C8, 0x81CD, 0x81C7, 0x01C2,
+    0x0140, 0x8145, 0x814F, 0x014A, 0x815B, 0x015E, 0x0154, 0x8151,
+    0x8173, 0x0176, 0x017C, 0x8179, 0x0168, 0x816D, 0x8167, 0x0162,
+    0x8123, 0x0126, 0x012C, 0x8129, 0x0138, 0x813D, 0x8137, 0x0132,
+    0x0110, 0x8115, 0x811F, 0x011A, 0x810B, 0x010E, 0x0104, 0x8101,
+    0x8303, 0x0306, 0x030C, 0x8309, 0x0318, 0x831D, 0x8317, 0x0312,
+    0x0330, 0x8335, 0x833F, 0x033A, 0x832B, 0x032E, 0x0324, 0x8321,
+    0x0360, 0x8365, 0x836F, 0x036A, 0x837B, 0x037E, 0x0374, 0x8371,
+    0x8353, 0x0356, 0x035C, 0x8359, 0x0348, 0x834D, 0x8347, 0x0342,
+    0x03C0, 0x83C5, 0x83CF, 0x03CA, 0x83DB, 0x03DE, 0x03D4, 0x83D1,
+    0x83F3, 0x03F6, 0x03FC, 0x83F9, 0x03E8, 0x83ED, 0x83E7, 0x03E2,
+    0x83A3, 0x03A6, 0x03AC, 0x83A9, 0x03B8, 0x83BD, 0x83B7, 0x03B2,
+    0x0390, 0x8395, 0x839F, 0x039A, 0x838B, 0x038E, 0x0384, 0x8381,
+    0x0280, 0x8285, 0x828F, 0x028A, 0x829B, 0x029E, 0x0294, 0x8291,
+    0x82B3, 0x02B6, 0x02BC, 0x82B9, 0x02A8, 0x82AD, 0x82A7, 0x02A2,
+    0x82E3, 0x02E6, 0x02EC, 0x82E9, 0x02F8, 0x82FD, 0x82F7, 0x02F2,
+    0x02D0, 0x82D5, 0x82DF, 0x02DA, 0x82CB, 0x02CE, 0x02C4, 0x82C1,
+    0x8243, 0x0246, 0x024C, 0x8249, 0x0258, 0x825D, 0x8257, 0x0252,
+    0x0270, 0x8275, 0x827F, 0x027A, 0x826B, 0x026E, 0x0264, 0x8261,
+    0x0220, 0x8225, 0x822F, 0x022A, 0x823B, 0x023E, 0x0234, 0x8231,
+    0x8213, 0x0216, 0x021C, 0x8219, 0x0208, 0x820D, 0x8207, 0x0202
+  };
+
+  // the data is read in blocks this big
+  const size_t SCAN_BLOCK = 256 * 1024;
+  // enough for the largest frame and the header of the next one
+  const size_t SCAN_LOOKAHEAD = 4 * 1024;
+
+  // Reads the audio data front to back in large blocks, keeping what is
+  // still needed of the previous block in front of the next one
+  class ScanBuffer
+  {
+  public:
+    ScanBuffer(ID3_Reader& reader, size_t size)
+      : _reader(reader), _data(SCAN_BLOCK + SCAN_LOOKAHEAD, '\0'),
+        _beg(0), _size(0), _left(size)
+    { ; }
+
+    // Points data at the bytes buffered from pos on and returns how many
+    // there are, reading more first if fewer than len are buffered
+    size_t fetch(size_t pos, size_t len, const uchar*& data)
+    {
+      if (pos + len > _beg + _size && _left > 0)
+      {
+        this->refill(pos);
+      }
+      if (pos >= _beg + _size)
+      {
+        return 0;
+      }
+      data = &_data[pos - _beg];
+      return _beg + _size - pos;
+    }
+
+  private:
+    void refill(size_t pos)
+    {
+      size_t keep = 0;
+      if (pos < _beg + _size)
+      {
+        keep = _beg + _size - pos;
+        ::memmove(&_data[0], &_data[pos - _beg], keep);
+      }
+      else
+      {
+        // the rest of a frame that ran past the end of the block
+        size_t skip = pos - (_beg + _size);
+        while (skip > 0 && _left > 0)
+        {
+          skip -= this->read(&_data[0], min<size_t>(skip, _data.size()));
+        }
+      }
+      _beg = pos;
+      _size = keep;
+      while (_size < _data.size() && _left > 0)
+      {
+        _size += this->read(&_data[_size], _data.size() - _size);
+      }
+    }
+
+    size_t read(uchar* buf, size_t len)
+    {
+      size_t numRead = _reader.readChars(buf, min(len, _left));
+      _left = (numRead == 0) ? 0 : _left - numRead;
+      return numRead;
+    }
+
+    ID3_Reader& _reader;
+    BString _data;
+    size_t _beg;   // the position of _data[0]
+    size_t _size;  // the number of bytes in _data
+    size_t _left;  // the number of bytes not read yet
+  };
+
+  struct ScanState
+  {
+    ScanState() : format(0), lowRate(0), highRate(0), first(false),
+                  checkCrc(false) { ; }
+    ID3_Mp3FrameIndex index;
+    uint32 format;    // the masked header of the first frame
+    uint32 lowRate;
+    uint32 highRate;
+    bool first;       // could the first frame hold a vbr header?
+    bool checkCrc;    // check the crc of each frame that has one?
+  };
+}
+
+uint32 mp3::readHeader(const uchar* data)
+{
+  return (uint32(data[0]) << 24) | (uint32(data[1]) << 16) |
+         (uint32(data[2]) << 8) | uint32(data[3]);
+}
+
+uint32 mp3::bitrate(uint32 header)
+{
+  if (!isValid(header))
+  {
+    return 0;
+  }
+  return BITRATES[isMpeg1(header) ? 0 : 1][layer(header) - 1][(header >> 12) & 15] * 1000;
+}
+
+uint32 mp3::frequency(uint32 header)
+{
+  if (!isValid(header))
+  {
+    return 0;
+  }
+  return FREQUENCIES[versionId(header)][(header >> 10) & 3];
+}
+
+uint32 mp3::samplesPerFrame(uint32 header)
+{
+  if (!isValid(header))
+  {
+    return 0;
+  }
+  if (layer(header) == 1)
+  {
+    return 384;
+  }
+  return (layer(header) == 3 && !isMpeg1(header)) ? 576 : 1152;
+}
+
+size_t mp3::frameSize(uint32 header)
+{
+  if (!isValid(header))
+  {
+    return 0;
+  }
+  const uint32 padding = (header >> 9) & 1;
+  const uint32 rate = mp3::bitrate(header);
+  const uint32 freq = mp3::frequency(header);
+  if (layer(header) == 1)
+  {
+    return (12 * rate / freq + padding) * 4;
+  }
+  return mp3::samplesPerFrame(header) / 8 * rate / freq + padding;
+}
+
+// Where a Xing or Info header would be: right after the side information.
+// Like other readers, this doesn't count a crc.
+size_t mp3::xingOffset(uint32 header)
+{
+  const bool mono = ((header >> 6) & 3) == 3;
+  return 4 + (isMpeg1(header) ? (mono ? 17 : 32) : (mono ? 9 : 17));
+}
+
+// Does the frame hold a Xing, Info or VBRI header rather than audio?
+bool mp3::isVbrHeaderFrame(const uchar* frame, size_t size)
+{
+  const size_t xing = mp3::xingOffset(mp3::readHeader(frame));
+  const size_t vbri = 4 + 32;
+  return
+    (xing + 4 <= size && (::memcmp(frame + xing, "Xing", 4) == 0 ||
+                          ::memcmp(frame + xing, "Info", 4) == 0)) ||
+    (vbri + 4 <= size && ::memcmp(frame + vbri, "VBRI", 4) == 0);
+}
+
+// Adds size bytes to the crc-16 of the data before them, a byte at a time
+uint16 mp3::crc16(const uchar* data, size_t size, uint16 crc)
+{
+  for (size_t i = 0; i < size; ++i)
+  {
+    crc = static_cast<uint16>((crc << 8) ^ CRC_TABLE[(crc >> 8) ^ data[i]]);
+  }
+  return crc;
+}
+
+// The number of bytes after the crc that the crc covers: the side
+// information of layer III, or the bit allocation of layer I.  For layer II
+// that depends on tables that only a decoder has, so it is 0, as it is for
+// frames without a crc.
+size_t mp3::crcSize(uint32 header)
+{
+  if (!isValid(header) || ((header >> 16) & 1) != 0)
+  {
+    return 0;
+  }
+  const uint32 mode = (header >> 6) & 3;
+  if (layer(header) == 3)
+  {
+    return mp3::xingOffset(header) - 4;
+  }
+  if (layer(header) == 1)
+  {
+    // four bits for each subband of each channel; in joint stereo, the
+    // subbands from the bound on are shared
+    const size_t bound = (mode == 1) ? 4 * (((header >> 4) & 3) + 1) : 32;
+    return (mode == 3) ? 16 : (bound + 32) / 2;
+  }
+  return 0;
+}
+
+// Checks the crc of a frame, given its first size bytes.
+Mp3_Crc mp3::checkCrc(const uchar* frame, size_t size)
+{
+  if (size < 4)
+  {
+    return MP3CRC_ERROR_SIZE;
+  }
+  const uint32 header = mp3::readHeader(frame);
+  const size_t len = mp3::crcSize(header);
+  if (len == 0)
+  {
+    return MP3CRC_NONE;
+  }
+  if (size < 6 + len)
+  {
+    return MP3CRC_ERROR_SIZE;
+  }
+  // the crc covers the last two bytes of the header and the data after it
+  const uint16 crc = mp3::crc16(frame + 6, len, mp3::crc16(frame + 2, 2));
+  const uint16 stored = static_cast<uint16>((frame[4] << 8) | frame[5]);
+  return (crc == stored) ? MP3CRC_OK : MP3CRC_MISMATCH;
+}
+
+// Looks for the first spot before limit in the size bytes of data where
+// SYNC_FRAMES frames of the same format follow each other; a lone 0xFF
+// byte, or a lone header, could be anything.  When the data is all there
+// is (atEnd), a spot whose frames run to the end of it is good enough.
+// Returns size if there is no such spot.
+size_t mp3::findSync(const uchar* data, size_t size, size_t limit, bool atEnd)
+{
+  limit = min(limit, size);
+  for (size_t pos = 0; pos < limit; ++pos)
+  {
+    const uchar* sync =
+      static_cast<const uchar*>(::memchr(data + pos, 0xFF, limit - pos));
+    if (sync == NULL)
+    {
+      break;
+    }
+    pos = sync - data;
+    if (pos + 4 > size)
+    {
+      break;
+    }
+    const uint32 format = mp3::readHeader(sync) & mp3::HEADER_MASK;
+    size_t next = pos;
+    size_t frames = 0;
+    while (frames < SYNC_FRAMES && next + 4 <= size)
+    {
+      const uint32 header = mp3::readHeader(data + next);
+      const size_t frameSize = mp3::frameSize(header);
+      if (frameSize == 0 || (header & mp3::HEADER_MASK) != format)
+      {
+        break;
+      }
+      next += frameSize;
+      ++frames;
+    }
+    if (frames == SYNC_FRAMES || (atEnd && frames > 0 && next + 4 > size))
+    {
+      return pos;
+    }
+  }
+  return size;
+}
+
+namespace
+{
+  // Walks the frames in the size bytes from the reader's position on, which
+  // is at file offset beg, and adds those that begin in the first limit
+  // bytes to the state's index.  Bytes that aren't part of a frame are
+  // skipped until the next spot that has two consecutive frame headers.
+  void scanFrames(ID3_Reader& reader, size_t beg, size_t size, size_t limit,
+                  bool synced, ScanState& state)
+  {
+    ScanBuffer buffer(reader, size);
+    size_t pos = 0;
+    while (pos < limit)
+    {
+      const uchar* data = NULL;
+      size_t avail = buffer.fetch(pos, SCAN_LOOKAHEAD, data);
+      if (avail < 4)
+      {
+        break;
+      }
+      const uint32 header = mp3::readHeader(data);
+      const size_t size = mp3::frameSize(header);
+      bool valid = size > 0 && size <= avail &&
+                   (state.format == 0 || (header & mp3::HEADER_MASK) == state.format);
+      if (valid && !synced && size + 4 <= avail)
+      {
+        // a lone header could be anything: trust it if the next one follows
+        const uint32 next = mp3::readHeader(data + size);
+        valid = mp3::frameSize(next) > 0 &&
+                (next & mp3::HEADER_MASK) == (header & mp3::HEADER_MASK);
+      }
+      if (!valid)
+      {
+        const uchar* sync =
+          static_cast<const uchar*>(::memchr(data + 1, 0xFF, avail - 1));
+        pos += (sync == NULL) ? avail : sync - data;
+        synced = false;
+        continue;
+      }
+
+      if (state.format == 0)
+      {
+        state.format = header & mp3::HEADER_MASK;
+        state.index.SetFormat(mp3::frequency(header),
+                              mp3::samplesPerFrame(header));
+      }
+      if (!state.first || !mp3::isVbrHeaderFrame(data, size))
+      {
+        const uint32 rate = mp3::bitrate(header);
+        state.lowRate = (state.lowRate == 0) ? rate : min(state.lowRate, rate);
+        state.highRate = max(state.highRate, rate);
+        state.index.AddFrame(beg + pos, size);
+        if (state.checkCrc)
+        {
+          state.index.AddCrcResult(mp3::checkCrc(data, size));
+        }
+      }
+      state.first = false;
+      synced = true;
+      pos += size;
+    }
+  }
+
+#if defined ID3_HAVE_SCAN_THREADS
+  // files are split in chunks of at least this size for scanning
+  const size_t SCAN_MIN_CHUNK = 32 * 1024 * 1024;
+  const size_t SCAN_MAX_THREADS = 8;
+
+  struct ScanChunk
+  {
+    String file;
+    size_t beg;      // the file offset of the chunk
+    size_t size;     // the bytes to read: the chunk and a bit beyond
+    size_t limit;    // the size of the chunk itself
+    ScanState state;
+    bool done;
+  };
+
+  // Scans a chunk with its own reader, on its own thread
+  void* scanChunk(void* arg)
+  {
+    ScanChunk* chunk = static_cast<ScanChunk*>(arg);
+    ifstream file;
+    if (ID3E_NoError == openReadableFile(chunk->file, file))
+    {
+      ID3_IFStreamReader reader(file);
+      reader.setCur(chunk->beg);
+      scanFrames(reader, chunk->beg, chunk->size, chunk->limit, false,
+                 chunk->state);
+      chunk->done = true;
+    }
+    return NULL;
+  }
+
+  size_t scanChunks(size_t mp3size)
+  {
+    long cpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads = (cpus > 0) ? min<size_t>(cpus, SCAN_MAX_THREADS) : 1;
+    return max<size_t>(1, min(threads, mp3size / SCAN_MIN_CHUNK));
+  }
+
+  // Would scanFrames() take the bytes at pos as a frame, right after
+  // another one?
+  bool isFrameAt(ID3_Reader& reader, size_t pos, size_t end, uint32 format)
+  {
+    uchar data[4];
+    if (pos + 4 > end)
+    {
+      return false;
+    }
+    reader.setCur(pos);
+    if (reader.readChars(data, 4) < 4)
+    {
+      return false;
+    }
+    const uint32 header = mp3::readHeader(data);
+    const size_t size = mp3::frameSize(header);
+    return size > 0 && pos + size <= end &&
+           (header & mp3::HEADER_MASK) == format;
+  }
+
+  // Scans the chunks of a large file on several threads.  Each chunk finds
+  // its own first frame; where that doesn't line up with the end of the
+  // last frame of the chunk before it, the chunk is scanned again from
+  // there, so the result is that of a scan from front to back.
+  bool scanParallel(ID3_Reader& reader, String fileName, size_t beg,
+                    size_t mp3size, size_t chunks, ScanState& total)
+  {
+    std::vector<ScanChunk> parts(chunks);
+    const size_t chunkSize = mp3size / chunks;
+    for (size_t k = 0; k < chunks; ++k)
+    {
+      ScanChunk& part = parts[k];
+      part.file = fileName;
+      part.beg = beg + k * chunkSize;
+      part.limit = (k + 1 == chunks) ? mp3size - k * chunkSize : chunkSize;
+      part.size = min(part.limit + SCAN_LOOKAHEAD, mp3size - k * chunkSize);
+      part.state.first = (k == 0);
+      part.state.checkCrc = total.checkCrc;
+      part.done = false;
+    }
+
+    std::vector<pthread_t> threads(chunks);
+    std::vector<bool> started(chunks, false);
+    for (size_t k = 1; k < chunks; ++k)
+    {
+      started[k] = ::pthread_create(&threads[k], NULL, scanChunk, &parts[k]) == 0;
+    }
+    // the first chunk is scanned here, with the reader we have
+    scanFrames(reader, beg, parts[0].size, parts[0].limit, false,
+               parts[0].state);
+    for (size_t k = 1; k < chunks; ++k)
+    {
+      if (started[k])
+      {
+        ::pthread_join(threads[k], NULL);
+      }
+    }
+
+    total = parts[0].state;
+    if (total.index.GetFrameCount() == 0)
+    {
+      return false;
+    }
+    for (size_t k = 1; k < chunks; ++k)
+    {
+      ScanChunk& part = parts[k];
+      const size_t expected = total.index.GetEnd();
+      const size_t count = part.state.index.GetFrameCount();
+      bool stitched = part.done && count > 0 &&
+                      part.state.format == total.format;
+      if (stitched && part.state.index.GetFrameOffset(0) != expected)
+      {
+        // fine if there's junk in between, as long as that has no frame
+        stitched = part.state.index.GetFrameOffset(0) > expected &&
+                   !isFrameAt(reader, expected, beg + mp3size, total.format);
+      }
+      if (!stitched)
+      {
+        ID3D_NOTICE( "scanParallel(): rescanning chunk " << k );
+        const size_t end = part.beg + part.limit;
+        part.state = ScanState();
+        part.state.format = total.format;
+        part.state.checkCrc = parts[0].state.checkCrc;
+        if (expected < end)
+        {
+          reader.setCur(expected);
+          scanFrames(reader, expected,
+                     min(end + SCAN_LOOKAHEAD, beg + mp3size) - expected,
+                     end - expected, true, part.state);
+        }
+      }
+      total.index.Append(part.state.index);
+      if (part.state.lowRate > 0)
+      {
+        total.lowRate = min(total.lowRate, part.state.lowRate);
+        total.highRate = max(total.highRate, part.state.highRate);
+      }
+    }
+    return true;
+  }
+#endif /* ID3_HAVE_SCAN_THREADS */
+}
+
+// Walks all of the frames in the mp3size bytes from the reader's position
+// on, which should be the first frame Parse() looked at.  The number of
+// frames and the playtime are replaced with exact ones, and the offsets of
+// the frames are kept in the frame index.  When the reader reads the file
+// with the given name, large files are scanned in chunks, on several threads.
+// With checkCrc, the crc of each frame that has one is checked as well, and
+// the frames that fail are kept in the frame index.
+bool Mp3Info::Scan(ID3_Reader& reader, size_t mp3size, String fileName,
+                   bool checkCrc)
+{
+  if (_mp3_header_output == NULL)
+  {
+    return false;
+  }
+  const size_t beg = reader.getCur();
+  ScanState state;
+  state.first = true;
+  state.checkCrc = checkCrc;
+  bool scanned = false;
+#if defined ID3_HAVE_SCAN_THREADS
+  const size_t chunks = fileName.empty() ? 1 : scanChunks(mp3size);
+  if (chunks > 1)
+  {
+    scanned = scanParallel(reader, fileName, beg, mp3size, chunks, state);
+    if (!scanned)
+    {
+      state = ScanState();
+      state.first = true;
+      state.checkCrc = checkCrc;
+      reader.setCur(beg);
+    }
+  }
+#endif
+  if (!scanned)
+  {
+    scanFrames(reader, beg, mp3size, mp3size, false, state);
+  }
+
+  if (_frame_index == NULL)
+  {
+    _frame_index = new ID3_Mp3FrameIndex;
+  }
+  *_frame_index = state.index;
+  const size_t frames = _frame_index->GetFrameCount();
+  ID3D_NOTICE( "Mp3Info::Scan(): frames = " << frames << ", skipped = " <<
+               mp3size - _frame_index->GetAudioBytes() << ", crc errors = " <<
+               _frame_index->GetCrcErrorCount() );
+  if (frames == 0)
+  {
+    return false;
+  }
+  const uint32 ms = _frame_index->GetDuration();
+  _mp3_header_output->frames = frames;
+  _mp3_header_output->time = (ms + 500) / 1000;
+  if (state.lowRate != state.highRate && ms > 0)
+  {
+    _mp3_header_output->vbr_bitrate = static_cast<uint32>(
+      (double) _frame_index->GetAudioBytes() * 8 * 1000 / ms);
+    _mp3_header_output->vbr_bitrate -= _mp3_header_output->vbr_bitrate % 1000;
+  }
+  return true;
+}
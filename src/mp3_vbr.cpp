@@ -0,0 +1,366 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#if defined HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <algorithm>
+#include "mp3_header.h"
+
+using namespace dami;
+
+#define FRAMES_FLAG     0x0001
+#define BYTES_FLAG      0x0002
+#define TOC_FLAG        0x0004
+#define SCALE_FLAG      0x0008
+
+namespace
+{
+  uint32 bigEndian(const uchar* data, size_t len)
+  {
+    uint32 val = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+      val = (val << 8) | data[i];
+    }
+    return val;
+  }
+
+  // the size of the lame extension that follows a xing header
+  const size_t LAME_SIZE = 36;
+  // the size of a vbri header, without its table
+  const size_t VBRI_SIZE = 26;
+}
+
+/** \class ID3_Mp3VbrHeader mp3_vbr.h id3/mp3_vbr.h
+ ** \brief The Xing, Info or VBRI header in the first frame of an mp3 file.
+ **
+ ** Vbr encoders write a frame without audio at the start of the file, with
+ ** the number of frames and bytes in the file and a table that maps the
+ ** playtime to a position in the file.  Link() keeps it, see
+ ** ID3_Tag::GetMp3VbrHeader().  LAME adds the encoder delay and padding and
+ ** a few other details to a Xing header, and writes one (as "Info") for cbr
+ ** files as well.
+ **
+ ** TimeToByteOffset() and ByteOffsetToTime() use the table to translate
+ ** between playtime and file offsets in constant time, without looking at
+ ** the audio frames.  Without a table, the mapping is linear.
+ **
+ ** \code
+ **   const ID3_Mp3VbrHeader* vbr = myTag.GetMp3VbrHeader();
+ **   if (vbr)
+ **   {
+ **     file.seekg(vbr->TimeToByteOffset(90 * 1000)); // 1:30 into the song
+ **   }
+ ** \endcode
+ **/
+ID3_Mp3VbrHeader::ID3_Mp3VbrHeader()
+{
+  this->Clear();
+}
+
+void ID3_Mp3VbrHeader::Clear()
+{
+  _type = VBR_NONE;
+  _offset = 0;
+  _audio = 0;
+  _frames = 0;
+  _bytes = 0;
+  _quality = -1;
+  _frequency = 0;
+  _samples_per_frame = 0;
+  ::memset(_toc, 0, sizeof(_toc));
+  _has_toc = false;
+  _sections.clear();
+  _frames_per_section = 0;
+  ::memset(_encoder, 0, sizeof(_encoder));
+  _revision = 0;
+  _vbr_method = 0;
+  _lowpass = 0;
+  _encoder_delay = 0;
+  _encoder_padding = 0;
+  _music_length = 0;
+  _music_crc = 0;
+}
+
+/** Parses the size bytes of a first frame, which is at the given file
+ ** offset, followed by the rest of the mp3size bytes of mpeg data.  Returns
+ ** false if the frame holds no vbr header.
+ **/
+bool ID3_Mp3VbrHeader::Parse(const uchar* frame, size_t size, size_t offset,
+                             size_t mp3size)
+{
+  this->Clear();
+  if (size < 4)
+  {
+    return false;
+  }
+  const uint32 header = mp3::readHeader(frame);
+  const size_t frameSize = mp3::frameSize(header);
+  if (frameSize == 0)
+  {
+    return false;
+  }
+  _offset = offset;
+  _audio = offset + frameSize;
+  _bytes = mp3size;
+  _frequency = mp3::frequency(header);
+  _samples_per_frame = mp3::samplesPerFrame(header);
+
+  if (this->ParseXing(frame, size, mp3::xingOffset(header)) ||
+      this->ParseVbri(frame, size, 4 + 32))
+  {
+    return true;
+  }
+  this->Clear();
+  return false;
+}
+
+bool ID3_Mp3VbrHeader::ParseXing(const uchar* frame, size_t size, size_t pos)
+{
+  if (pos + 8 > size)
+  {
+    return false;
+  }
+  if (::memcmp(frame + pos, "Xing", 4) == 0)
+  {
+    _type = VBR_XING;
+  }
+  else if (::memcmp(frame + pos, "Info", 4) == 0)
+  {
+    _type = VBR_INFO;
+  }
+  else
+  {
+    return false;
+  }
+  const uint32 flags = bigEndian(frame + pos + 4, 4);
+  pos += 8;
+  const size_t fields = ((flags & FRAMES_FLAG) ? 4 : 0) +
+                        ((flags & BYTES_FLAG) ? 4 : 0) +
+                        ((flags & TOC_FLAG) ? 100 : 0) +
+                        ((flags & SCALE_FLAG) ? 4 : 0);
+  if (pos + fields > size)
+  {
+    ID3D_WARNING( "ID3_Mp3VbrHeader::ParseXing(): header too large" );
+    return false;
+  }
+  if (flags & FRAMES_FLAG)
+  {
+    _frames = bigEndian(frame + pos, 4);
+    pos += 4;
+  }
+  if (flags & BYTES_FLAG)
+  {
+    const uint32 bytes = bigEndian(frame + pos, 4);
+    if (bytes > 0)
+    {
+      _bytes = bytes;
+    }
+    pos += 4;
+  }
+  if (flags & TOC_FLAG)
+  {
+    ::memcpy(_toc, frame + pos, sizeof(_toc));
+    _has_toc = true;
+    pos += 100;
+  }
+  if (flags & SCALE_FLAG)
+  {
+    _quality = bigEndian(frame + pos, 4);
+    pos += 4;
+  }
+  if (pos + LAME_SIZE <= size &&
+      (::memcmp(frame + pos, "LAME", 4) == 0 ||
+       ::memcmp(frame + pos, "Lavf", 4) == 0 ||
+       ::memcmp(frame + pos, "Lavc", 4) == 0))
+  {
+    this->ParseLame(frame + pos);
+  }
+  return true;
+}
+
+bool ID3_Mp3VbrHeader::ParseVbri(const uchar* frame, size_t size, size_t pos)
+{
+  if (pos + VBRI_SIZE > size || ::memcmp(frame + pos, "VBRI", 4) != 0)
+  {
+    return false;
+  }
+  _type = VBR_VBRI;
+  // version and delay come first, two bytes each
+  _quality = bigEndian(frame + pos + 8, 2);
+  _bytes = bigEndian(frame + pos + 10, 4);
+  _frames = bigEndian(frame + pos + 14, 4);
+  const size_t entries = bigEndian(frame + pos + 18, 2);
+  const size_t scale = bigEndian(frame + pos + 20, 2);
+  const size_t entrySize = bigEndian(frame + pos + 22, 2);
+  _frames_per_section = bigEndian(frame + pos + 24, 2);
+  pos += VBRI_SIZE;
+
+  if (entries == 0 || entrySize == 0 || entrySize > 4 ||
+      _frames_per_section == 0 || pos + entries * entrySize > size)
+  {
+    return true;
+  }
+  // the table holds the size of each section; keep their offsets instead
+  _sections.reserve(entries + 1);
+  _sections.push_back(_audio);
+  for (size_t i = 0; i < entries; ++i, pos += entrySize)
+  {
+    _sections.push_back(_sections.back() + bigEndian(frame + pos, entrySize) * scale);
+  }
+  return true;
+}
+
+void ID3_Mp3VbrHeader::ParseLame(const uchar* data)
+{
+  for (size_t i = 0; i < 9 && data[i] >= 0x20 && data[i] < 0x7F; ++i)
+  {
+    _encoder[i] = data[i];
+  }
+  _revision = data[9] >> 4;
+  _vbr_method = data[9] & 0x0F;
+  _lowpass = data[10] * 100;
+  _encoder_delay = (data[21] << 4) | (data[22] >> 4);
+  _encoder_padding = ((data[22] & 0x0F) << 8) | data[23];
+  _music_length = bigEndian(data + 28, 4);
+  _music_crc = static_cast<uint16>(bigEndian(data + 32, 2));
+}
+
+/** Returns true if the header has a table for seeking. */
+bool ID3_Mp3VbrHeader::HasToc() const
+{
+  return _has_toc || !_sections.empty();
+}
+
+/** Returns the playtime in milliseconds, 0 if the number of frames isn't
+ ** known.
+ **/
+uint32 ID3_Mp3VbrHeader::GetDuration() const
+{
+  if (_frequency == 0)
+  {
+    return 0;
+  }
+  return static_cast<uint32>((double) _frames * _samples_per_frame * 1000 /
+                             _frequency + 0.5);
+}
+
+/** Returns the file offset of the audio playing at the given time, in
+ ** milliseconds.  Times past the end give the end of the mpeg data.
+ **/
+size_t ID3_Mp3VbrHeader::TimeToByteOffset(uint32 ms) const
+{
+  const uint32 duration = this->GetDuration();
+  const size_t end = _offset + _bytes;
+  if (duration == 0 || ms == 0)
+  {
+    return _audio;
+  }
+  if (ms >= duration)
+  {
+    return end;
+  }
+  size_t offset = 0;
+  if (_has_toc)
+  {
+    const double percent = 100.0 * ms / duration;
+    const size_t a = min<size_t>(static_cast<size_t>(percent), 99);
+    const double fa = _toc[a];
+    const double fb = (a < 99) ? _toc[a + 1] : 256;
+    const double fx = fa + (fb - fa) * (percent - a);
+    offset = _offset + static_cast<size_t>(fx / 256 * _bytes);
+  }
+  else if (!_sections.empty())
+  {
+    const double section = (double) ms * _frequency / 1000 /
+                           _samples_per_frame / _frames_per_section;
+    const size_t i = static_cast<size_t>(section);
+    if (i + 1 >= _sections.size())
+    {
+      return end;
+    }
+    offset = _sections[i] + static_cast<size_t>(
+      (_sections[i + 1] - _sections[i]) * (section - i));
+  }
+  else
+  {
+    offset = _audio + static_cast<size_t>((double) (end - _audio) * ms / duration);
+  }
+  return max(_audio, min(offset, end));
+}
+
+/** Returns the time in milliseconds at which the audio at the given file
+ ** offset plays.  This is the inverse of TimeToByteOffset().
+ **/
+uint32 ID3_Mp3VbrHeader::ByteOffsetToTime(size_t offset) const
+{
+  const uint32 duration = this->GetDuration();
+  const size_t end = _offset + _bytes;
+  if (duration == 0 || offset <= _audio)
+  {
+    return 0;
+  }
+  if (offset >= end)
+  {
+    return duration;
+  }
+  double ms = 0;
+  if (_has_toc)
+  {
+    const double x = (double) (offset - _offset) * 256 / _bytes;
+    size_t a = 0;
+    while (a < 99 && _toc[a + 1] <= x)
+    {
+      ++a;
+    }
+    const double fa = _toc[a];
+    const double fb = (a < 99) ? _toc[a + 1] : 256;
+    const double percent = a + ((fb > fa) ? (x - fa) / (fb - fa) : 0);
+    ms = percent * duration / 100;
+  }
+  else if (!_sections.empty())
+  {
+    std::vector<size_t>::const_iterator next =
+      std::upper_bound(_sections.begin(), _sections.end(), offset);
+    if (next == _sections.end())
+    {
+      return duration;
+    }
+    const size_t i = (next - _sections.begin()) - 1;
+    const double section = i + (double) (offset - _sections[i]) /
+                               (_sections[i + 1] - _sections[i]);
+    ms = section * _frames_per_section * _samples_per_frame * 1000 / _frequency;
+  }
+  else
+  {
+    ms = (double) (offset - _audio) * duration / (end - _audio);
+  }
+  return min(duration, static_cast<uint32>(ms + 0.5));
+}
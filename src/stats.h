@@ -0,0 +1,100 @@
+// -*- C++ -*-
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002  Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#ifndef _ID3LIB_STATS_H_
+#define _ID3LIB_STATS_H_
+
+#include "id3/tag_stats.h"
+
+// Timing of the phases of Link() and Update(), only compiled in with
+// --enable-stats.  ID3_STATS_SCOPE(stats, OPERATION) collects what the
+// timers and counters on this thread record until the end of the block, and
+// then adds it to stats and to the process-wide total; ID3_STATS_TIMER(PHASE)
+// adds the time to the end of the block to a phase.  Phases nest: a frame's
+// time includes that of its fields.  ID3_STATS_SYSCALL(bytes) counts a
+// read or write of the file by the readers and copiers underneath.
+#if defined ID3_ENABLE_STATS
+
+namespace dami
+{
+  namespace stats
+  {
+    class Scope
+    {
+      Scope* _prev;
+      ID3_TagStats* _stats;
+      ID3_TagStats::Operation _op;
+      ID3_TagStats  _added;
+
+      friend class Timer;
+      friend ID3_IOStats& io();
+      friend void countSyscall(size_t);
+
+      Scope(const Scope&);
+      Scope& operator=(const Scope&);
+     public:
+      Scope(ID3_TagStats&, ID3_TagStats::Operation);
+      ~Scope();
+    };
+
+    class Timer
+    {
+      ID3_TagStats* _stats;
+      ID3_TagStats::Phase _phase;
+      uint64 _start;
+
+      Timer(const Timer&);
+      Timer& operator=(const Timer&);
+     public:
+      Timer(ID3_TagStats::Phase);
+      ~Timer();
+    };
+
+    // the I/O counters of the operation in progress on this thread, for the
+    // io::CountingReader and io::CountingWriter that it reads and writes
+    // through
+    ID3_IOStats& io();
+    void countSyscall(size_t bytes);
+  };
+};
+
+#  define ID3_STATS_SCOPE(tagStats, op) \
+     dami::stats::Scope id3_stats_scope_(tagStats, ID3_TagStats::op)
+#  define ID3_STATS_TIMER(phase) \
+     dami::stats::Timer id3_stats_timer_##phase(ID3_TagStats::phase)
+#  define ID3_STATS_SYSCALL(bytes) dami::stats::countSyscall(bytes)
+
+#else
+
+#  define ID3_STATS_SCOPE(tagStats, op)
+#  define ID3_STATS_TIMER(phase)
+#  define ID3_STATS_SYSCALL(bytes)
+
+#endif /* ID3_ENABLE_STATS */
+
+#endif /* _ID3LIB_STATS_H_ */
@@ -455,6 +455,104 @@ bool ID3_Tag::SetPadding(bool pad)
   return _impl->SetPadding(pad);
 }
 
+/** Turns appending of grown tags on or off.
+ **
+ ** Normally, when an updated id3v2 tag no longer fits in the space taken by
+ ** the old one, Update() has to rewrite the entire file to make room for it
+ ** at the beginning.  With appending switched on, Update() writes the tag as
+ ** an id3v2.4.0 tag with a footer at the end of the file instead (before any
+ ** id3v1 or lyrics tags), so only the tags are written and the audio data
+ ** stays where it is.  The old tag at the start of the file is overwritten
+ ** with one of the same size holding only a seek frame, which points readers
+ ** to the appended tag.
+ **
+ ** Once a file has an appended tag, subsequent updates replace it.  Tags that
+ ** still fit in front of the audio data are written there as usual.
+ **
+ ** By default, appending is switched off.
+ **
+ ** \code
+ **   myTag.SetAppend(true);
+ **   myTag.Update(ID3TT_ID3V2);
+ ** \endcode
+ **
+ ** \param append Whether or not to append tags that have outgrown their space
+ **/
+bool ID3_Tag::SetAppend(bool append)
+{
+  return _impl->SetAppend(append);
+}
+
+bool ID3_Tag::GetAppend() const
+{
+  return _impl->GetAppend();
+}
+
+/** Turns the full scan of the mpeg audio frames on or off.
+ **
+ ** Normally, Link() only looks at the first mpeg frame (and the Xing header
+ ** that may be in it) and estimates the number of frames and the playtime
+ ** from the size of the audio data.  For a vbr file without a Xing header,
+ ** that estimate is wrong.  With the full scan switched on, Link() walks
+ ** every frame of the file, reading it front to back in large blocks, so the
+ ** number of frames and the playtime in GetMp3HeaderInfo() are exact.  The
+ ** offset of each frame is kept in GetMp3FrameIndex().
+ **
+ ** By default, the full scan is switched off.  It has no effect on
+ ** LinkStream(), which never reads the audio data.
+ **
+ ** \code
+ **   ID3_Tag myTag;
+ **   myTag.SetFullScan(true);
+ **   myTag.Link("audiobook.mp3");
+ ** \endcode
+ **
+ ** \param scan Whether or not to scan all of the mpeg frames
+ **/
+bool ID3_Tag::SetFullScan(bool scan)
+{
+  return _impl->SetFullScan(scan);
+}
+
+bool ID3_Tag::GetFullScan() const
+{
+  return _impl->GetFullScan();
+}
+
+/** Turns the crc check of the mpeg audio frames on or off.
+ **
+ ** With the crc check switched on, the full scan (see SetFullScan()) checks
+ ** the crc of each frame that has one, which finds damaged audio without
+ ** decoding it.  The number of frames checked and the frames that failed are
+ ** in GetMp3FrameIndex().  Only layer I and layer III frames are checked.
+ ** The crc of the first frame is always checked; see GetMp3HeaderInfo().
+ **
+ ** By default, the crc check is switched off.
+ **
+ ** \code
+ **   ID3_Tag myTag;
+ **   myTag.SetFullScan(true);
+ **   myTag.SetCrcCheck(true);
+ **   myTag.Link("song.mp3");
+ **   const ID3_Mp3FrameIndex* index = myTag.GetMp3FrameIndex();
+ **   if (index && index->GetCrcErrorCount() > 0)
+ **   {
+ **     // the audio is damaged
+ **   }
+ ** \endcode
+ **
+ ** \param check Whether or not to check the crc of the mpeg frames
+ **/
+bool ID3_Tag::SetCrcCheck(bool check)
+{
+  return _impl->SetCrcCheck(check);
+}
+
+bool ID3_Tag::GetCrcCheck() const
+{
+  return _impl->GetCrcCheck();
+}
+
 bool ID3_Tag::SetExperimental(bool exp)
 {
   return _impl->SetExperimental(exp);
@@ -655,11 +753,11 @@ size_t ID3_Tag::Render(ID3_Writer& writer, ID3_TagType tt) const
   ID3_Writer::pos_type beg = writer.getCur();
   if (ID3TT_ID3V2 & tt)
   {
-    id3::v2::render(writer, *this);
+    id3::v2::render(writer, *_impl);
   }
   else if (ID3TT_ID3V1 & tt)
   {
-    id3::v1::render(writer, *this);
+    id3::v1::render(writer, *_impl);
   }
   return writer.getCur() - beg;
 }
@@ -714,6 +812,26 @@ size_t ID3_Tag::Link(ID3_Reader &reader, flags_t flags)
   return _impl->Link(reader, flags);
 }
 
+/**
+ ** Parses a reader that can only be read forward, such as a pipe, a socket
+ ** or the body of an http response.  Unlike Link(ID3_Reader&), the reader is
+ ** never asked for its size and is never repositioned: only the id3v2 tag(s)
+ ** at its beginning and the header of the first mpeg frame are parsed, so
+ ** tags at the end of the data (id3v1, lyrics3, musicmatch) are not found.
+ **
+ ** The id3v2 tag is buffered as a whole, as its size is known from its
+ ** header.  Looking for the first mpeg frame reads ahead a bounded amount
+ ** of data (a few kilobytes at most), which is consumed from the reader.
+ ** The length of the audio isn't known either, so the playtime reported by
+ ** GetMp3HeaderInfo() is only set when the first frame holds a vbr header.
+ **
+ ** Returns the number of bytes in front of the audio data, as Link() does.
+ **/
+size_t ID3_Tag::LinkStream(ID3_Reader &reader, flags_t flags)
+{
+  return _impl->LinkStream(reader, flags);
+}
+
 flags_t ID3_Tag::Update(flags_t flags)
 {
   return _impl->Update(flags);
@@ -729,6 +847,24 @@ const Mp3_Headerinfo* ID3_Tag::GetMp3HeaderInfo() const
   return _impl->GetMp3HeaderInfo();
 }
 
+/**
+ ** Gets the offsets of the mpeg frames, found by Link() when a full scan was
+ ** asked for with SetFullScan().  Returns NULL otherwise.
+ **/
+const ID3_Mp3FrameIndex* ID3_Tag::GetMp3FrameIndex() const
+{
+  return _impl->GetMp3FrameIndex();
+}
+
+/**
+ ** Gets the Xing, Info or VBRI header found in the first mpeg frame by
+ ** Link(), with its table for seeking.  Returns NULL if there is none.
+ **/
+const ID3_Mp3VbrHeader* ID3_Tag::GetMp3VbrHeader() const
+{
+  return _impl->GetMp3VbrHeader();
+}
+
 /** Strips the tag(s) from the attached file. The type of tag stripped
  ** can be specified as a parameter.  The default is to strip all tag types.
  **
@@ -745,6 +881,22 @@ size_t ID3_Tag::GetPrependedBytes() const
   return _impl->GetPrependedBytes();
 }
 
+/** Returns the file offset of the audio data: the first mpeg frame, past
+ ** the tags at the start of the file and any junk after them.
+ **/
+size_t ID3_Tag::GetAudioOffset() const
+{
+  return _impl->GetAudioOffset();
+}
+
+/** Returns the size of the audio data, up to the first tag at the end of the
+ ** file.  See ID3_AudioHash for a hash of just these bytes.
+ **/
+size_t ID3_Tag::GetAudioSize() const
+{
+  return _impl->GetAudioSize();
+}
+
 size_t ID3_Tag::GetAppendedBytes() const
 {
   return _impl->GetAppendedBytes();
@@ -769,6 +921,15 @@ const char* ID3_Tag::GetFileName() const
     return NULL;
 }
 
+/** Returns how often, and for how long, Link(), Update() and Strip() of this
+ ** tag went through each of their phases.  All zero unless id3lib was
+ ** configured with --enable-stats; see ID3_TagStats.
+ **/
+const ID3_TagStats& ID3_Tag::GetStats() const
+{
+  return _impl->GetStats();
+}
+
 /// Finds frame with given frame id
   /** Returns a pointer to the next ID3_Frame with the given ID3_FrameID;
    ** returns NULL if no such frame found.
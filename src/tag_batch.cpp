@@ -0,0 +1,332 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#if defined HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <vector>
+#include "id3/tag_batch.h"
+#include "tag_impl.h" //has <stdio.h> "tag.h" "header_tag.h" "frame.h" "field.h" "spec.h" "id3lib_strings.h" "utils.h"
+#include "io_batch.h"
+
+#if defined HAVE_UNISTD_H
+#  include <unistd.h>
+#endif
+
+using namespace dami;
+
+namespace
+{
+  // files in flight at once, by default
+  const size_t BATCH_DEPTH = 64;
+  // most threads that parse, by default
+  const size_t BATCH_MAX_THREADS = 8;
+
+  size_t cpuThreads()
+  {
+#if defined _SC_NPROCESSORS_ONLN
+    long cpus = ::sysconf(_SC_NPROCESSORS_ONLN);
+    return (cpus > 0) ? min<size_t>(cpus, BATCH_MAX_THREADS) : 1;
+#else
+    return 1;
+#endif
+  }
+}
+
+class ID3_TagBatchImpl
+{
+public:
+  ID3_TagBatchImpl()
+    : _depth(BATCH_DEPTH), _threads(cpuThreads()), _async(true),
+      _isAsync(false), _diskOrder(false)
+  { }
+  ~ID3_TagBatchImpl() { this->clear(); }
+
+  void clear()
+  {
+    for (size_t i = 0; i < _tags.size(); ++i)
+    {
+      delete _tags[i];
+    }
+    _tags.clear();
+    _names.clear();
+    _linked.clear();
+  }
+
+  std::vector<String> _names;
+  std::vector<ID3_Tag*> _tags;
+  std::vector<uchar> _linked;   // set from several threads: not vector<bool>
+  size_t _depth;
+  size_t _threads;
+  bool _async;
+  bool _isAsync;
+  bool _diskOrder;
+};
+
+#if defined ID3_HAVE_FILE_DESCRIPTORS
+namespace
+{
+  struct ParseJob
+  {
+    ID3_TagImpl* tag;
+    io::PrefetchedFile* file;
+    uchar* linked;
+  };
+
+  void parseFile(void* arg, size_t i)
+  {
+    ParseJob& job = static_cast<ParseJob*>(arg)[i];
+    if (job.file->fd < 0)
+    {
+      return;
+    }
+    io::PrefetchFileReader reader(*job.file);
+    job.tag->ParseFile(reader, reader.getFd());
+    *job.linked = true;
+  }
+}
+#endif
+
+/** \class ID3_TagBatch tag_batch.h id3/tag_batch.h
+ ** \brief Links the tags of many files at once.
+ **
+ ** Linking one file after another waits on each of their reads in turn,
+ ** which leaves a disk (and more so an array of them, or a file server)
+ ** mostly idle.  An ID3_TagBatch has the reads of many files in flight at
+ ** once: it opens up to GetDepth() files together, reads the heads and the
+ ** tails of them all as ID3_Tag::Link() would, and then parses them from
+ ** memory on GetThreads() threads.
+ **
+ ** The requests are handed to the kernel through an io_uring where there
+ ** is one (Linux 5.6 and on).  Elsewhere, or after SetAsync(false), they're
+ ** done by a pool of threads instead; IsAsync() tells which was used.  Files
+ ** the ID3_TagCache knows aren't read at all.
+ **
+ ** On rotating disks, where seeking costs more than reading, SetDiskOrder()
+ ** has the files read in the order their data lies on disk rather than in
+ ** the order they were added.  Where the file system won't tell (FIEMAP
+ ** on Linux), they are read in the order of their inodes.
+ **
+ ** Each tag is linked to its file as if by ID3_Tag::Link(), so it can be
+ ** updated after.  The tags belong to the batch.
+ **
+ ** \code
+ **   ID3_TagBatch batch;
+ **   for (size_t i = 0; i < count; ++i)
+ **   {
+ **     batch.Add(names[i]);
+ **   }
+ **   batch.Link();
+ **   for (size_t i = 0; i < batch.NumFiles(); ++i)
+ **   {
+ **     if (batch.IsLinked(i))
+ **     {
+ **       char* title = ID3_GetTitle(batch.GetTag(i));
+ **       ...
+ **     }
+ **   }
+ ** \endcode
+ **/
+ID3_TagBatch::ID3_TagBatch()
+  : _impl(new ID3_TagBatchImpl)
+{
+}
+
+ID3_TagBatch::~ID3_TagBatch()
+{
+  delete _impl;
+}
+
+void ID3_TagBatch::Add(const char* name)
+{
+  if (name != NULL)
+  {
+    _impl->_names.push_back(name);
+    _impl->_tags.push_back(NULL);
+    _impl->_linked.push_back(false);
+  }
+}
+
+/** Forgets all files, and deletes their tags. */
+void ID3_TagBatch::Clear()
+{
+  _impl->clear();
+}
+
+size_t ID3_TagBatch::NumFiles() const
+{
+  return _impl->_names.size();
+}
+
+const char* ID3_TagBatch::GetFileName(size_t i) const
+{
+  return (i < this->NumFiles()) ? _impl->_names[i].c_str() : NULL;
+}
+
+/** Sets how many files are read at once. */
+void ID3_TagBatch::SetDepth(size_t depth)
+{
+  _impl->_depth = max<size_t>(1, depth);
+}
+
+size_t ID3_TagBatch::GetDepth() const
+{
+  return _impl->_depth;
+}
+
+/** Sets how many threads parse the files. */
+void ID3_TagBatch::SetThreads(size_t threads)
+{
+  _impl->_threads = max<size_t>(1, threads);
+}
+
+size_t ID3_TagBatch::GetThreads() const
+{
+  return _impl->_threads;
+}
+
+/** Allows io_uring to be used, or not. */
+void ID3_TagBatch::SetAsync(bool async)
+{
+  _impl->_async = async;
+}
+
+bool ID3_TagBatch::GetAsync() const
+{
+  return _impl->_async;
+}
+
+/** Did the last Link() read the files through io_uring? */
+bool ID3_TagBatch::IsAsync() const
+{
+  return _impl->_isAsync;
+}
+
+/** Reads the files in the order they lie on disk, or not. */
+void ID3_TagBatch::SetDiskOrder(bool diskOrder)
+{
+  _impl->_diskOrder = diskOrder;
+}
+
+bool ID3_TagBatch::GetDiskOrder() const
+{
+  return _impl->_diskOrder;
+}
+
+/** Links the tags of all files, anew if they were before.  Returns the number
+ ** of files linked; the others couldn't be opened.
+ **/
+size_t ID3_TagBatch::Link(flags_t tag_types)
+{
+  const size_t count = this->NumFiles();
+  for (size_t i = 0; i < count; ++i)
+  {
+    delete _impl->_tags[i];
+    _impl->_tags[i] = new ID3_Tag;
+    _impl->_linked[i] = false;
+  }
+
+#if defined ID3_HAVE_FILE_DESCRIPTORS
+  io::BatchPrefetcher prefetcher(_impl->_depth, _impl->_async);
+  std::vector<const char*> names;
+  std::vector<ParseJob> jobs;
+  std::vector<io::PrefetchedFile> files(prefetcher.getDepth());
+  std::vector<size_t> order;
+  if (_impl->_diskOrder)
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      names.push_back(_impl->_names[i].c_str());
+    }
+    io::diskOrder(&names[0], count, order);
+  }
+  else
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      order.push_back(i);
+    }
+  }
+  for (size_t pos = 0; pos < count; )
+  {
+    // what the cache has needn't be read
+    names.clear();
+    jobs.clear();
+    for (; pos < count && names.size() < prefetcher.getDepth(); ++pos)
+    {
+      const size_t i = order[pos];
+      ID3_TagImpl* tag = _impl->_tags[i]->_impl;
+      if (tag->LinkCached(_impl->_names[i].c_str(), tag_types))
+      {
+        _impl->_linked[i] = true;
+        continue;
+      }
+      ParseJob job;
+      job.tag = tag;
+      job.file = &files[names.size()];
+      job.linked = &_impl->_linked[i];
+      jobs.push_back(job);
+      names.push_back(_impl->_names[i].c_str());
+    }
+    if (names.empty())
+    {
+      continue;
+    }
+    prefetcher.prefetch(&names[0], &files[0], names.size());
+    io::forEachParallel(jobs.size(), _impl->_threads, parseFile, &jobs[0]);
+  }
+  _impl->_isAsync = prefetcher.isAsync();
+#else
+  for (size_t i = 0; i < count; ++i)
+  {
+    ID3_Tag* tag = _impl->_tags[i];
+    tag->Link(_impl->_names[i].c_str(), tag_types);
+    // Link() doesn't tell whether the file could be opened
+    _impl->_linked[i] = tag->GetFileSize() > 0 || tag->HasTagType(ID3TT_ID3V2);
+  }
+  _impl->_isAsync = false;
+#endif
+
+  size_t linked = 0;
+  for (size_t i = 0; i < count; ++i)
+  {
+    linked += _impl->_linked[i] ? 1 : 0;
+  }
+  return linked;
+}
+
+bool ID3_TagBatch::IsLinked(size_t i) const
+{
+  return i < this->NumFiles() && _impl->_linked[i];
+}
+
+/** Returns the tag of the i-th file; NULL before Link(). */
+ID3_Tag* ID3_TagBatch::GetTag(size_t i) const
+{
+  return (i < this->NumFiles()) ? _impl->_tags[i] : NULL;
+}
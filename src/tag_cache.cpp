@@ -0,0 +1,812 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#if defined HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <stdio.h>
+#include <map>
+#include <vector>
+#include "tag_impl.h" //has <stdio.h> "tag.h" "header_tag.h" "frame.h" "field.h" "spec.h" "id3lib_strings.h" "utils.h"
+#include "id3/tag_cache.h"
+#include "id3/readers.h"
+#include "io_strings.h"
+#include "io_file.h"
+
+#if defined ID3_HAVE_FILE_DESCRIPTORS && defined HAVE_SYS_MMAN_H && defined HAVE_MMAP
+#  define ID3_HAVE_TAG_CACHE 1
+#  include <unistd.h>
+#  include <fcntl.h>
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#endif
+
+#if defined HAVE_PTHREAD_H && defined HAVE_LIBPTHREAD
+#  define ID3_HAVE_CACHE_LOCK 1
+#  include <pthread.h>
+#endif
+
+using namespace dami;
+
+namespace
+{
+  // A cache file starts with a header and a table of buckets, each the
+  // 64 bit offset of the first entry of a chain (0 for none).  The entries
+  // follow, each starting on a multiple of 8 bytes.  All numbers are little
+  // endian.
+  const uchar CACHE_MAGIC[4] = { 'I', 'D', '3', 'C' };
+  const uint32 CACHE_VERSION = 3;
+  const size_t CACHE_HEADER = 16;   // magic, version, buckets, entries
+  const size_t CACHE_WRITE_BLOCK = 1024 * 1024;
+
+  // Where the fields of an entry are.  The first frame of the mpeg data,
+  // if it holds a vbr header, and the frames of the tag, rendered as id3v2
+  // frames, follow the fixed part.
+  enum
+  {
+    E_NEXT       = 0,   // the offset of the next entry in the chain
+    E_SIZE       = 8,   // of the whole entry
+    E_PARSED     = 12,  // the tag types that Link() was asked for
+    E_DEV        = 16,
+    E_INO        = 24,
+    E_FILESIZE   = 32,
+    E_MTIME      = 40,  // in nanoseconds
+    E_TAGS       = 48,  // the tag types it found
+    E_FLAGS      = 52,
+    E_SPEC       = 56,
+    E_VBRSIZE    = 60,
+    E_DATASIZE   = 64,  // the sizes and offsets in the file, 64 bits each
+    E_PREPENDED  = 72,
+    E_APPENDED   = 80,
+    E_SYNC       = 88,
+    E_V2BEG      = 96,
+    E_V2SIZE     = 104,
+    E_MP3        = 112, // the members of Mp3_Headerinfo
+    E_FRAMESSIZE = 172,
+    ENTRY_HEADER = 176
+  };
+
+  enum
+  {
+    F_UNSYNC   = 1 << 0,
+    F_EXTENDED = 1 << 1,
+    F_PADDED   = 1 << 2,
+    F_MP3      = 1 << 3
+  };
+
+  inline uint32 get32(const uchar* data)
+  {
+    return uint32(data[0]) | (uint32(data[1]) << 8) |
+           (uint32(data[2]) << 16) | (uint32(data[3]) << 24);
+  }
+
+  inline uint64 get64(const uchar* data)
+  {
+    return uint64(get32(data)) | (uint64(get32(data + 4)) << 32);
+  }
+
+  inline void put32(uchar* data, uint32 val)
+  {
+    data[0] = uchar(val);
+    data[1] = uchar(val >> 8);
+    data[2] = uchar(val >> 16);
+    data[3] = uchar(val >> 24);
+  }
+
+  inline void put64(uchar* data, uint64 val)
+  {
+    put32(data, uint32(val));
+    put32(data + 4, uint32(val >> 32));
+  }
+
+  // the file an entry is for, and the state it was in
+  struct FileKey
+  {
+    uint64 dev;
+    uint64 ino;
+    uint64 size;
+    uint64 mtime;
+  };
+
+  typedef std::pair<uint64, uint64> FileId;   // device and inode
+
+  // an entry as it's written
+  struct CacheItem
+  {
+    uint32 hash;
+    const uchar* data;
+    uint32 size;
+    uint64 offset;
+    uint64 next;
+  };
+
+  inline uint32 hashId(uint64 dev, uint64 ino)
+  {
+    const uint64 GOLDEN = (uint64(0x9E3779B9) << 32) | 0x7F4A7C15;
+    const uint64 h = (ino ^ ((dev << 32) | (dev >> 32))) * GOLDEN;
+    return uint32(h >> 32);
+  }
+
+#if defined ID3_HAVE_TAG_CACHE
+  void setKey(const struct stat& st, FileKey& key)
+  {
+    key.dev = st.st_dev;
+    key.ino = st.st_ino;
+    key.size = st.st_size;
+    key.mtime = uint64(st.st_mtime) * 1000000000;
+#  if defined HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+    key.mtime += st.st_mtim.tv_nsec;
+#  elif defined HAVE_STRUCT_STAT_ST_MTIMESPEC_TV_NSEC
+    key.mtime += st.st_mtimespec.tv_nsec;
+#  endif
+  }
+#endif
+
+  bool statFile(const char* name, FileKey& key)
+  {
+#if defined ID3_HAVE_TAG_CACHE
+    struct stat st;
+    if (name == NULL || ::stat(name, &st) != 0)
+    {
+      return false;
+    }
+    setKey(st, key);
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  // the key of a file that is open: unlike the path, the descriptor can't
+  // have been replaced by another file in the meantime
+  bool statFile(int fd, FileKey& key)
+  {
+#if defined ID3_HAVE_TAG_CACHE
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) != 0)
+    {
+      return false;
+    }
+    setKey(st, key);
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  ID3_TagCache* defaultCache = NULL;
+}
+
+class ID3_TagCacheImpl
+{
+public:
+  ID3_TagCacheImpl()
+    : _map(NULL), _mapSize(0), _buckets(0), _count(0), _hits(0), _misses(0)
+  {
+#if defined ID3_HAVE_CACHE_LOCK
+    ::pthread_mutex_init(&_lock, NULL);
+#endif
+  }
+  ~ID3_TagCacheImpl()
+  {
+    this->unmap();
+#if defined ID3_HAVE_CACHE_LOCK
+    ::pthread_mutex_destroy(&_lock);
+#endif
+  }
+
+  void lock()
+  {
+#if defined ID3_HAVE_CACHE_LOCK
+    ::pthread_mutex_lock(&_lock);
+#endif
+  }
+  void unlock()
+  {
+#if defined ID3_HAVE_CACHE_LOCK
+    ::pthread_mutex_unlock(&_lock);
+#endif
+  }
+
+  bool map();
+  void unmap();
+  bool write();
+  const uchar* find(uint64 dev, uint64 ino) const;
+  const uchar* findMapped(uint64 dev, uint64 ino) const;
+
+  String _path;
+  const uchar* _map;
+  size_t _mapSize;
+  uint32 _buckets;
+  uint32 _count;
+  // entries added or replaced since the file was mapped; an empty one was
+  // removed
+  std::map<FileId, BString> _changes;
+  size_t _hits;
+  size_t _misses;
+
+private:
+#if defined ID3_HAVE_CACHE_LOCK
+  pthread_mutex_t _lock;
+#endif
+};
+
+namespace
+{
+  class CacheLock
+  {
+    ID3_TagCacheImpl& _cache;
+  public:
+    CacheLock(ID3_TagCacheImpl& cache) : _cache(cache) { _cache.lock(); }
+    ~CacheLock() { _cache.unlock(); }
+  };
+
+  // an entry of the cache file has to lie inside it
+  bool isEntry(const uchar* map, size_t mapSize, uint64 offset)
+  {
+    if (offset < CACHE_HEADER || offset % 8 != 0 || offset > mapSize ||
+        mapSize - offset < ENTRY_HEADER)
+    {
+      return false;
+    }
+    const uchar* entry = map + size_t(offset);
+    const size_t size = get32(entry + E_SIZE);
+    return size >= ENTRY_HEADER && size <= mapSize - size_t(offset) &&
+           get32(entry + E_VBRSIZE) + get32(entry + E_FRAMESSIZE) <= size - ENTRY_HEADER;
+  }
+}
+
+bool ID3_TagCacheImpl::map()
+{
+  this->unmap();
+#if defined ID3_HAVE_TAG_CACHE
+  const int fd = ::open(_path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    // nothing cached yet
+    return true;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || size_t(st.st_size) < CACHE_HEADER)
+  {
+    ::close(fd);
+    return true;
+  }
+  void* data = ::mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED)
+  {
+    ID3D_WARNING( "ID3_TagCache: can't map " << _path );
+    return false;
+  }
+  _map = static_cast<const uchar*>(data);
+  _mapSize = st.st_size;
+  _buckets = get32(_map + 8);
+  _count = get32(_map + 12);
+  if (::memcmp(_map, CACHE_MAGIC, 4) != 0 || get32(_map + 4) != CACHE_VERSION ||
+      _buckets == 0 || (_buckets & (_buckets - 1)) != 0 ||
+      (_mapSize - CACHE_HEADER) / 8 < _buckets)
+  {
+    // another version, or broken: it will be replaced
+    ID3D_WARNING( "ID3_TagCache: ignoring " << _path );
+    this->unmap();
+  }
+#endif
+  return true;
+}
+
+void ID3_TagCacheImpl::unmap()
+{
+#if defined ID3_HAVE_TAG_CACHE
+  if (_map)
+  {
+    ::munmap(const_cast<uchar*>(_map), _mapSize);
+  }
+#endif
+  _map = NULL;
+  _mapSize = 0;
+  _buckets = 0;
+  _count = 0;
+}
+
+const uchar* ID3_TagCacheImpl::findMapped(uint64 dev, uint64 ino) const
+{
+  if (!_map)
+  {
+    return NULL;
+  }
+  const uchar* bucket = _map + CACHE_HEADER + 8 * (hashId(dev, ino) & (_buckets - 1));
+  uint64 offset = get64(bucket);
+  // a broken chain can't make us loop: it has no more than _count entries
+  for (size_t n = 0; n <= _count && isEntry(_map, _mapSize, offset); ++n)
+  {
+    const uchar* entry = _map + size_t(offset);
+    if (get64(entry + E_DEV) == dev && get64(entry + E_INO) == ino)
+    {
+      return entry;
+    }
+    offset = get64(entry + E_NEXT);
+  }
+  return NULL;
+}
+
+const uchar* ID3_TagCacheImpl::find(uint64 dev, uint64 ino) const
+{
+  std::map<FileId, BString>::const_iterator change =
+    _changes.find(FileId(dev, ino));
+  if (change != _changes.end())
+  {
+    return change->second.empty() ? NULL : change->second.data();
+  }
+  return this->findMapped(dev, ino);
+}
+
+bool ID3_TagCacheImpl::write()
+{
+#if defined ID3_HAVE_TAG_CACHE
+  std::vector<CacheItem> items;
+  CacheItem item;
+  item.next = 0;
+
+  // the mapped entries that haven't changed, then the new ones
+  if (_map)
+  {
+    size_t offset = CACHE_HEADER + 8 * size_t(_buckets);
+    for (size_t n = 0; n < _count && isEntry(_map, _mapSize, offset); ++n)
+    {
+      const uchar* entry = _map + offset;
+      const uint64 dev = get64(entry + E_DEV), ino = get64(entry + E_INO);
+      if (_changes.find(FileId(dev, ino)) == _changes.end())
+      {
+        item.hash = hashId(dev, ino);
+        item.data = entry;
+        item.size = get32(entry + E_SIZE);
+        items.push_back(item);
+      }
+      offset += get32(entry + E_SIZE);
+    }
+  }
+  for (std::map<FileId, BString>::const_iterator change = _changes.begin();
+       change != _changes.end(); ++change)
+  {
+    if (!change->second.empty())
+    {
+      item.hash = hashId(change->first.first, change->first.second);
+      item.data = change->second.data();
+      item.size = change->second.size();
+      items.push_back(item);
+    }
+  }
+
+  uint32 buckets = 64;
+  while (buckets < items.size())
+  {
+    buckets <<= 1;
+  }
+  std::vector<uint64> heads(buckets, 0);
+  uint64 offset = CACHE_HEADER + 8 * uint64(buckets);
+  const size_t count = items.size();
+  for (size_t i = 0; i < count; ++i)
+  {
+    const uint32 b = items[i].hash & (buckets - 1);
+    items[i].offset = offset;
+    items[i].next = heads[b];
+    heads[b] = offset;
+    offset += items[i].size;
+  }
+
+  const String tmpPath = _path + ".tmp";
+  const int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    ID3D_WARNING( "ID3_TagCache: can't write " << tmpPath );
+    return false;
+  }
+  BString buf(CACHE_HEADER + 8 * size_t(buckets), '\0');
+  ::memcpy(&buf[0], CACHE_MAGIC, 4);
+  put32(&buf[4], CACHE_VERSION);
+  put32(&buf[8], buckets);
+  put32(&buf[12], count);
+  for (size_t b = 0; b < buckets; ++b)
+  {
+    put64(&buf[CACHE_HEADER + 8 * b], heads[b]);
+  }
+  bool ok = true;
+  for (size_t i = 0; i < count && ok; ++i)
+  {
+    const size_t beg = buf.size();
+    buf.append(items[i].data, items[i].size);
+    put64(&buf[beg + E_NEXT], items[i].next);
+    if (buf.size() >= CACHE_WRITE_BLOCK)
+    {
+      ok = io::writeAll(fd, buf.data(), buf.size()) == buf.size();
+      buf.erase();
+    }
+  }
+  ok = ok && io::writeAll(fd, buf.data(), buf.size()) == buf.size();
+  ok = (::close(fd) == 0) && ok;
+  if (!ok || ::rename(tmpPath.c_str(), _path.c_str()) != 0)
+  {
+    ID3D_WARNING( "ID3_TagCache: can't write " << _path );
+    ::unlink(tmpPath.c_str());
+    return false;
+  }
+  _changes.clear();
+  return this->map();
+#else
+  return false;
+#endif
+}
+
+/** \class ID3_TagCache tag_cache.h id3/tag_cache.h
+ ** \brief Keeps what Link() found in files, so that it needn't parse them
+ ** again.
+ **
+ ** A cache holds the frames, the tag types and sizes and the mpeg header of
+ ** each file that was linked while it was the default cache, see
+ ** SetDefault().  An entry is used as long as the file's device, inode,
+ ** size and modification time are the same, and Update() and Strip() remove
+ ** it.  Links that scan all mpeg frames (ID3_Tag::SetFullScan()) don't use
+ ** the cache.
+ **
+ ** The cache file is mapped into memory and looked up where it lies, so
+ ** opening a large cache costs nothing.  What was added is written with
+ ** Flush() or Close(), which replace the file.
+ **
+ ** \code
+ **   ID3_TagCache cache;
+ **   cache.Open("/var/cache/library.id3c");
+ **   ID3_TagCache::SetDefault(&cache);
+ **   // ... link the files ...
+ **   ID3_TagCache::SetDefault(NULL);
+ **   cache.Close();
+ ** \endcode
+ **
+ ** Entries are found by device and inode, so a cache can't be shared
+ ** between machines.  The cache is only available where files can be mapped
+ ** into memory.
+ **/
+ID3_TagCache::ID3_TagCache()
+  : _impl(new ID3_TagCacheImpl)
+{
+}
+
+ID3_TagCache::~ID3_TagCache()
+{
+  this->Close();
+  delete _impl;
+}
+
+/** Opens the cache at path, which is created by Flush() if it doesn't
+ ** exist.  Returns false if it can't be used.
+ **/
+bool ID3_TagCache::Open(const char* path)
+{
+  this->Close();
+#if defined ID3_HAVE_TAG_CACHE
+  if (path == NULL)
+  {
+    return false;
+  }
+  CacheLock lock(*_impl);
+  _impl->_path = path;
+  if (!_impl->map())
+  {
+    _impl->_path = "";
+    return false;
+  }
+  return true;
+#else
+  return false;
+#endif
+}
+
+/** Writes the entries added since the cache was opened or last flushed.
+ ** Returns false if the file couldn't be written.
+ **/
+bool ID3_TagCache::Flush()
+{
+  CacheLock lock(*_impl);
+  if (_impl->_path.empty())
+  {
+    return false;
+  }
+  return _impl->_changes.empty() || _impl->write();
+}
+
+/** Flushes and closes the cache. */
+void ID3_TagCache::Close()
+{
+  if (this->IsOpen())
+  {
+    this->Flush();
+  }
+  CacheLock lock(*_impl);
+  _impl->unmap();
+  _impl->_changes.clear();
+  _impl->_path = "";
+  _impl->_hits = 0;
+  _impl->_misses = 0;
+}
+
+bool ID3_TagCache::IsOpen() const
+{
+  CacheLock lock(*_impl);
+  return !_impl->_path.empty();
+}
+
+/** Returns the number of files in the cache, flushed or not. */
+size_t ID3_TagCache::NumEntries() const
+{
+  CacheLock lock(*_impl);
+  size_t count = _impl->_count;
+  for (std::map<FileId, BString>::const_iterator change = _impl->_changes.begin();
+       change != _impl->_changes.end(); ++change)
+  {
+    const bool mapped = _impl->findMapped(change->first.first, change->first.second) != NULL;
+    if (mapped && change->second.empty())
+    {
+      --count;
+    }
+    else if (!mapped && !change->second.empty())
+    {
+      ++count;
+    }
+  }
+  return count;
+}
+
+/** Returns how many links were served from the cache since it was opened. */
+size_t ID3_TagCache::GetHits() const
+{
+  CacheLock lock(*_impl);
+  return _impl->_hits;
+}
+
+/** Returns how many links had to parse their file since it was opened. */
+size_t ID3_TagCache::GetMisses() const
+{
+  CacheLock lock(*_impl);
+  return _impl->_misses;
+}
+
+/** Sets the cache that ID3_Tag::Link(const char*) uses, NULL for none.  The
+ ** cache isn't owned: it has to stay open while it's the default.
+ **/
+void ID3_TagCache::SetDefault(ID3_TagCache* cache)
+{
+  defaultCache = cache;
+}
+
+ID3_TagCache* ID3_TagCache::GetDefault()
+{
+  return defaultCache;
+}
+
+// Fills the tag with what was cached for the file, if it hasn't changed
+// since and the same tag types were asked for
+bool ID3_TagCache::Find(const char* name, ID3_TagImpl& tag)
+{
+  FileKey key;
+  if (!this->IsOpen() || !statFile(name, key))
+  {
+    return false;
+  }
+  // the entry is copied, for the mapping may change when it's flushed
+  BString entry;
+  {
+    CacheLock lock(*_impl);
+    const uchar* e = _impl->find(key.dev, key.ino);
+    if (e && get64(e + E_FILESIZE) == key.size &&
+        get64(e + E_MTIME) == key.mtime &&
+        get32(e + E_PARSED) == tag._tags_to_parse.get())
+    {
+      entry.assign(e, get32(e + E_SIZE));
+      ++_impl->_hits;
+    }
+    else
+    {
+      ++_impl->_misses;
+    }
+  }
+  if (entry.empty())
+  {
+    return false;
+  }
+  const uchar* e = entry.data();
+  const uint32 flags = get32(e + E_FLAGS);
+  const ID3_V2Spec spec = static_cast<ID3_V2Spec>(get32(e + E_SPEC));
+
+  tag._file_tags.set(get32(e + E_TAGS));
+  tag._file_size = static_cast<size_t>(get64(e + E_DATASIZE));
+  tag._prepended_bytes = static_cast<size_t>(get64(e + E_PREPENDED));
+  tag._appended_bytes = static_cast<size_t>(get64(e + E_APPENDED));
+  tag._sync_bytes = static_cast<size_t>(get64(e + E_SYNC));
+  tag._appended_v2_beg = static_cast<size_t>(get64(e + E_V2BEG));
+  tag._appended_v2_size = static_cast<size_t>(get64(e + E_V2SIZE));
+  if (tag.HasTagType(ID3TT_ID3V2) || tag.HasTagType(ID3TT_ID3V2APPENDED))
+  {
+    tag.SetSpec(spec);
+    tag.SetUnsync((flags & F_UNSYNC) != 0);
+    tag.SetExtended((flags & F_EXTENDED) != 0);
+  }
+  if (!(flags & F_PADDED))
+  {
+    tag.SetPadding(false);
+  }
+
+  const size_t vbrSize = get32(e + E_VBRSIZE);
+  ID3_MemoryReader frames(e + ENTRY_HEADER + vbrSize, get32(e + E_FRAMESSIZE));
+  while (!frames.atEnd())
+  {
+    const ID3_Reader::pos_type last = frames.getCur();
+    ID3_Frame* f = new ID3_Frame;
+    f->SetSpec(spec);
+    if (!f->Parse(frames) || frames.getCur() == last)
+    {
+      delete f;
+      break;
+    }
+    tag.AttachFrame(f);
+  }
+
+  delete tag._mp3_info;
+  tag._mp3_info = NULL;
+  if (flags & F_MP3)
+  {
+    Mp3_Headerinfo info;
+    const uchar* mp3 = e + E_MP3;
+    info.layer = static_cast<Mpeg_Layers>(get32(mp3));
+    info.version = static_cast<Mpeg_Version>(get32(mp3 + 4));
+    info.bitrate = static_cast<MP3_BitRates>(get32(mp3 + 8));
+    info.channelmode = static_cast<Mp3_ChannelMode>(get32(mp3 + 12));
+    info.modeext = static_cast<Mp3_ModeExt>(get32(mp3 + 16));
+    info.emphasis = static_cast<Mp3_Emphasis>(get32(mp3 + 20));
+    info.crc = static_cast<Mp3_Crc>(get32(mp3 + 24));
+    info.vbr_bitrate = get32(mp3 + 28);
+    info.frequency = get32(mp3 + 32);
+    info.framesize = get32(mp3 + 36);
+    info.frames = get32(mp3 + 40);
+    info.time = get32(mp3 + 44);
+    info.privatebit = get32(mp3 + 48) != 0;
+    info.copyrighted = get32(mp3 + 52) != 0;
+    info.original = get32(mp3 + 56) != 0;
+    const size_t mp3size = tag._file_size - tag._appended_bytes -
+                           tag.GetAudioOffset();
+    tag._mp3_info = new Mp3Info;
+    tag._mp3_info->Restore(info, e + ENTRY_HEADER, vbrSize,
+                           tag.GetAudioOffset(), mp3size);
+  }
+  ID3D_NOTICE( "ID3_TagCache::Find(): found " << name );
+  return true;
+}
+
+// Keeps what Link() found in the file open as fd, which the reader still
+// reads
+void ID3_TagCache::Store(int fd, const ID3_TagImpl& tag, ID3_Reader& reader)
+{
+  FileKey key;
+  if (!this->IsOpen() || !statFile(fd, key))
+  {
+    return;
+  }
+  // the frames are rendered as the tag's spec, which the tag's own frames
+  // needn't be set to yet
+  BString frames;
+  io::BStringWriter writer(frames);
+  for (ID3_TagImpl::const_iterator iter = tag.begin(); iter != tag.end(); ++iter)
+  {
+    if (*iter)
+    {
+      ID3_Frame frame(**iter);
+      frame.SetSpec(tag.GetSpec());
+      frame.Render(writer);
+    }
+  }
+  // the vbr header can't be kept without the frame it's in
+  BString vbr;
+  const Mp3_Headerinfo* info = tag.GetMp3HeaderInfo();
+  if (info && info->framesize > 0 && tag.GetMp3VbrHeader())
+  {
+    const size_t mp3size = tag._file_size - tag._appended_bytes -
+                           tag.GetAudioOffset();
+    vbr.resize(min<size_t>(info->framesize, mp3size));
+    reader.setCur(tag.GetAudioOffset());
+    vbr.resize(reader.readChars(&vbr[0], vbr.size()));
+  }
+
+  const size_t size = (ENTRY_HEADER + vbr.size() + frames.size() + 7) & ~size_t(7);
+  BString entry(size, '\0');
+  uchar* e = &entry[0];
+  put32(e + E_SIZE, size);
+  put64(e + E_DEV, key.dev);
+  put64(e + E_INO, key.ino);
+  put64(e + E_FILESIZE, key.size);
+  put64(e + E_MTIME, key.mtime);
+  put32(e + E_PARSED, tag._tags_to_parse.get());
+  put32(e + E_TAGS, tag._file_tags.get());
+  put32(e + E_FLAGS, (tag.GetUnsync() ? F_UNSYNC : 0) |
+                     (tag.GetExtended() ? F_EXTENDED : 0) |
+                     (tag._is_padded ? F_PADDED : 0) |
+                     (info ? F_MP3 : 0));
+  put32(e + E_SPEC, tag.GetSpec());
+  put64(e + E_DATASIZE, tag._file_size);
+  put64(e + E_PREPENDED, tag._prepended_bytes);
+  put64(e + E_APPENDED, tag._appended_bytes);
+  put64(e + E_SYNC, tag._sync_bytes);
+  put64(e + E_V2BEG, tag._appended_v2_beg);
+  put64(e + E_V2SIZE, tag._appended_v2_size);
+  if (info)
+  {
+    uchar* mp3 = e + E_MP3;
+    put32(mp3, info->layer);
+    put32(mp3 + 4, info->version);
+    put32(mp3 + 8, info->bitrate);
+    put32(mp3 + 12, info->channelmode);
+    put32(mp3 + 16, info->modeext);
+    put32(mp3 + 20, info->emphasis);
+    put32(mp3 + 24, info->crc);
+    put32(mp3 + 28, info->vbr_bitrate);
+    put32(mp3 + 32, info->frequency);
+    put32(mp3 + 36, info->framesize);
+    put32(mp3 + 40, info->frames);
+    put32(mp3 + 44, info->time);
+    put32(mp3 + 48, info->privatebit);
+    put32(mp3 + 52, info->copyrighted);
+    put32(mp3 + 56, info->original);
+  }
+  put32(e + E_VBRSIZE, vbr.size());
+  put32(e + E_FRAMESSIZE, frames.size());
+  ::memcpy(e + ENTRY_HEADER, vbr.data(), vbr.size());
+  ::memcpy(e + ENTRY_HEADER + vbr.size(), frames.data(), frames.size());
+
+  CacheLock lock(*_impl);
+  _impl->_changes[FileId(key.dev, key.ino)] = entry;
+}
+
+// Forgets the file, which is about to change
+void ID3_TagCache::Remove(const char* name)
+{
+  FileKey key;
+  if (!this->IsOpen() || !statFile(name, key))
+  {
+    return;
+  }
+  CacheLock lock(*_impl);
+  const FileId id(key.dev, key.ino);
+  if (_impl->findMapped(key.dev, key.ino))
+  {
+    _impl->_changes[id] = BString();
+  }
+  else
+  {
+    _impl->_changes.erase(id);
+  }
+}
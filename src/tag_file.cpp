@@ -29,6 +29,9 @@
 #include "writers.h"
 #include "io_strings.h"
 #include "tag_impl.h" //has <stdio.h> "tag.h" "header_tag.h" "frame.h" "field.h" "spec.h" "id3lib_strings.h" "utils.h"
+#include "io_file.h"
+#include "id3/tag_cache.h"
+#include "stats.h"
 
 using namespace dami;
 
@@ -44,6 +47,10 @@ using namespace dami;
 #  include <sys/stat.h>
 #endif
 
+#if defined ID3_HAVE_FILE_DESCRIPTORS
+#  include <fcntl.h>
+#endif
+
 #if defined WIN32 && (!defined(WINCE))
 #  include <windows.h>
 static int truncate(const char *path, size_t length)
@@ -129,20 +136,31 @@ size_t ID3_TagImpl::Link(const char *fileInfo, bool parseID3v1, bool parseLyrics
 }
 
 size_t ID3_TagImpl::Link(const char *fileInfo, flags_t tag_types)
+{
+  if (!this->LinkCached(fileInfo, tag_types))
+  {
+    this->ParseFile();
+  }
+
+  return this->GetPrependedBytes();
+}
+
+// true if there's nothing left to parse: no file, or the cache had it
+bool ID3_TagImpl::LinkCached(const char *fileInfo, flags_t tag_types)
 {
   _tags_to_parse.set(tag_types);
 
   if (NULL == fileInfo)
   {
-    return 0;
+    return true;
   }
 
   _file_name = fileInfo;
   _changed = true;
 
-  this->ParseFile();
-
-  return this->GetPrependedBytes();
+  // the frame index of a full scan isn't cached
+  ID3_TagCache* cache = _is_full_scan ? NULL : ID3_TagCache::GetDefault();
+  return cache && cache->Find(fileInfo, *this);
 }
 
 // used for streaming:
@@ -158,6 +176,19 @@ size_t ID3_TagImpl::Link(ID3_Reader &reader, flags_t tag_types)
   return this->GetPrependedBytes();
 }
 
+// used for pipes and sockets: the reader is only read forward
+size_t ID3_TagImpl::LinkStream(ID3_Reader &reader, flags_t tag_types)
+{
+  _tags_to_parse.set(tag_types);
+
+  _file_name = "";
+  _changed = true;
+
+  this->ParseStream(reader);
+
+  return this->GetPrependedBytes();
+}
+
 size_t RenderV1ToFile(ID3_TagImpl& tag, fstream& file)
 {
   if (!file)
@@ -197,7 +228,12 @@ size_t RenderV1ToFile(ID3_TagImpl& tag, fstream& file)
     }
   }
 
-  ID3_IOStreamWriter out(file);
+  ID3_IOStreamWriter fileWriter(file);
+#if defined ID3_ENABLE_STATS
+  io::CountingWriter out(fileWriter, stats::io());
+#else
+  ID3_Writer& out = fileWriter;
+#endif
 
   id3::v1::render(out, tag);
 
@@ -211,7 +247,7 @@ static String ResolveSymlink(const String& filename, int depth = 0)
   String::size_type pos;
   char tmpBuf[ID3_PATH_LENGTH];
   String abs;
-  if (depth > 32)
+  if (depth > io::SYMLINK_MAX_DEPTH)
   {
     return filename;
   }
@@ -243,6 +279,14 @@ static String ResolveSymlink(const String& filename, int depth = 0)
 }
 #endif //defined(HAVE_UNISTD_H)
 
+// if the new tag fits perfectly within the old and the old one
+// actually existed (ie this isn't the first tag this file has had)
+static bool FitsInPlace(const ID3_TagImpl& tag, size_t tagSize)
+{
+  return ((!tag.GetPrependedBytes() && !ID3_GetDataSize(tag)) ||
+          (tagSize == tag.GetPrependedBytes()));
+}
+
 size_t RenderV2ToFile(const ID3_TagImpl& tag, fstream& file)
 {
   ID3D_NOTICE( "RenderV2ToFile: starting" );
@@ -253,16 +297,19 @@ size_t RenderV2ToFile(const ID3_TagImpl& tag, fstream& file)
   }
 
   String tagString;
-  io::StringWriter writer(tagString);
+  io::StringWriter tagWriter(tagString);
+#if defined ID3_ENABLE_STATS
+  io::CountingWriter writer(tagWriter, stats::io());
+#else
+  ID3_Writer& writer = tagWriter;
+#endif
   id3::v2::render(writer, tag);
   ID3D_NOTICE( "RenderV2ToFile: rendered v2" );
+  ID3_STATS_TIMER(FILE_REWRITE);
 
   const char* tagData = tagString.data();
   size_t tagSize = tagString.size();
-  // if the new tag fits perfectly within the old and the old one
-  // actually existed (ie this isn't the first tag this file has had)
-  if ((!tag.GetPrependedBytes() && !ID3_GetDataSize(tag)) ||
-      (tagSize == tag.GetPrependedBytes()))
+  if (FitsInPlace(tag, tagSize))
   {
     file.seekp(0, ios::beg);
     file.write(tagData, tagSize);
@@ -281,7 +328,47 @@ size_t RenderV2ToFile(const ID3_TagImpl& tag, fstream& file)
     strcpy(sTempFile, filename.c_str());
     strcat(sTempFile, sTmpSuffix.c_str());
 
-#if ((defined(__GNUC__) && __GNUC__ >= 3  ) || !defined(HAVE_MKSTEMP))
+#if defined(ID3_HAVE_FILE_DESCRIPTORS) && defined(HAVE_MKSTEMP)
+    // Write the tag into a temp file, then let the kernel copy the audio
+    // data after it.  Depending on the file system the data is cloned
+    // (when the old and new tag sizes are block aligned), copied in-kernel,
+    // or copied through one large buffer rather than BUFSIZ-sized chunks.
+    int fd = mkstemp(sTempFile);
+    if (fd < 0)
+    {
+      return 0;
+    }
+    int fdIn = open(filename.c_str(), O_RDONLY);
+    struct stat inStat;
+    if (fdIn < 0 || fstat(fdIn, &inStat) != 0)
+    {
+      if (fdIn >= 0)
+      {
+        close(fdIn);
+      }
+      close(fd);
+      remove(sTempFile);
+      return 0;
+    }
+    size_t dataSize = 0;
+    if ((size_t) inStat.st_size > tag.GetPrependedBytes())
+    {
+      dataSize = inStat.st_size - tag.GetPrependedBytes();
+    }
+    bool ok =
+      io::writeAll(fd, tagData, tagSize) == tagSize &&
+      io::copyFileData(fdIn, tag.GetPrependedBytes(), fd, tagSize,
+                       dataSize) == dataSize;
+    close(fdIn);
+    if (close(fd) != 0 || !ok)
+    {
+      ID3D_WARNING( "RenderV2ToFile: couldn't copy the file data" );
+      remove(sTempFile);
+      return 0;
+    }
+    file.close();
+
+#elif ((defined(__GNUC__) && __GNUC__ >= 3  ) || !defined(HAVE_MKSTEMP))
     // This section is for Windows folk && gcc 3.x folk
     fstream tmpOut;
     createFile(sTempFile, tmpOut);
@@ -295,6 +382,8 @@ size_t RenderV2ToFile(const ID3_TagImpl& tag, fstream& file)
       size_t nBytes = file.gcount();
       tmpOut.write((char *)tmpBuffer, nBytes);
     }
+    tmpOut.close();
+    file.close();
 
 #else //((defined(__GNUC__) && __GNUC__ >= 3  ) || !defined(HAVE_MKSTEMP))
 
@@ -330,14 +419,14 @@ size_t RenderV2ToFile(const ID3_TagImpl& tag, fstream& file)
     }
 
     close(fd); //closes the file
-
-#endif ////((defined(__GNUC__) && __GNUC__ >= 3  ) || !defined(HAVE_MKSTEMP))
-
     tmpOut.close();
     file.close();
 
+#endif ////((defined(__GNUC__) && __GNUC__ >= 3  ) || !defined(HAVE_MKSTEMP))
+
     // the following sets the permissions of the new file
     // to be the same as the original
+    ID3_STATS_TIMER(RENAME);
 #if defined(HAVE_SYS_STAT_H)
     struct stat fileStat;
     if(stat(filename.c_str(), &fileStat) == 0)
@@ -366,11 +455,148 @@ size_t RenderV2ToFile(const ID3_TagImpl& tag, fstream& file)
   return tagSize;
 }
 
+// Replaces the appended id3v2.4.0 tag (if any) with newTag, keeping the tags
+// that follow it (lyrics, id3v1...).  Only the end of the file is touched.
+static bool ReplaceAppendedV2(const ID3_TagImpl& tag, fstream& file,
+                              const String& newTag)
+{
+  const size_t tailBeg = tag.GetFileSize() - tag.GetAppendedBytes();
+  String tail;
+  if (tag.GetAppendedBytes() > 0)
+  {
+    tail.resize(tag.GetAppendedBytes());
+    file.seekg(tailBeg, ios::beg);
+    file.read(&tail[0], tail.size());
+    if ((size_t)file.gcount() != tail.size())
+    {
+      ID3D_WARNING( "ReplaceAppendedV2: couldn't read the appended tags" );
+      file.clear();
+      return false;
+    }
+  }
+  if (tag.GetAppendedV2Bytes() > 0 && tag.GetAppendedV2Beg() >= tailBeg)
+  {
+    tail.erase(tag.GetAppendedV2Beg() - tailBeg, tag.GetAppendedV2Bytes());
+  }
+
+  file.clear();
+  file.seekp(tailBeg, ios::beg);
+  file.write(newTag.data(), newTag.size());
+  file.write(tail.data(), tail.size());
+  file.flush();
+  if (!file)
+  {
+    return false;
+  }
+
+  const size_t newFileSize = tailBeg + newTag.size() + tail.size();
+  if (newFileSize < tag.GetFileSize() &&
+      truncate(tag.GetFileName().c_str(), newFileSize) == -1)
+  {
+    return false;
+  }
+  return true;
+}
+
+// Renders a tag of exactly tagSize bytes that holds nothing but a seek frame
+// pointing offset bytes past its end.  Returns an empty string if tagSize is
+// too small for it.
+static String RenderSeekTag(size_t tagSize, uint32 offset)
+{
+  ID3_TagImpl seekTag;
+  seekTag.SetSpec(ID3V2_4_0);
+  seekTag.SetPadding(false);
+  ID3_Frame* frame = new ID3_Frame(ID3FID_SEEKFRAME);
+  frame->GetField(ID3FN_SEEKOFFSET)->Set(offset);
+  seekTag.AttachFrame(frame);
+
+  String tagString;
+  io::StringWriter writer(tagString);
+  id3::v2::render(writer, seekTag);
+  if (tagString.size() < ID3_TagHeader::SIZE || tagString.size() > tagSize)
+  {
+    return String();
+  }
+
+  // grow the tag to the requested size with padding
+  String sizeBytes;
+  io::StringWriter sizeWriter(sizeBytes);
+  io::writeUInt28(sizeWriter, tagSize - ID3_TagHeader::SIZE);
+  tagString.replace(ID3_TagHeader::SIZE_OFFSET, sizeBytes.size(), sizeBytes);
+  tagString.append(tagSize - tagString.size(), '\0');
+  return tagString;
+}
+
+// Writes the tag as an id3v2.4.0 tag with a footer after the audio data, so
+// that a tag which has outgrown its space at the start of the file doesn't
+// force the whole file to be rewritten.  A prepended tag is overwritten in
+// place by a same-sized tag holding only a seek frame that points to the
+// appended one.  Returns the size of the appended tag, or 0 on failure.
+size_t RenderV2AppendedToFile(ID3_TagImpl& tag, fstream& file)
+{
+  ID3D_NOTICE( "RenderV2AppendedToFile: starting" );
+  if (!file)
+  {
+    ID3D_WARNING( "RenderV2AppendedToFile: error in file" );
+    return 0;
+  }
+
+  String seekTag;
+  if (tag.HasTagType(ID3TT_ID3V2))
+  {
+    // the appended tag will start where the audio data ends
+    seekTag = RenderSeekTag(tag.GetPrependedBytes(), ID3_GetDataSize(tag));
+    if (seekTag.empty())
+    {
+      ID3D_WARNING( "RenderV2AppendedToFile: no room for a seek frame" );
+      return 0;
+    }
+  }
+
+  // an appended tag is an id3v2.4.0 one with a footer, whatever the tag is
+  // otherwise rendered as
+  const ID3_V2Spec spec = tag.GetSpec();
+  const bool extended = tag.GetExtended();
+  const bool footer = tag.GetFooter();
+  tag.SetSpec(ID3V2_4_0);
+  tag.SetFooter(true);
+  String tagString;
+  io::StringWriter tagWriter(tagString);
+#if defined ID3_ENABLE_STATS
+  io::CountingWriter writer(tagWriter, stats::io());
+#else
+  ID3_Writer& writer = tagWriter;
+#endif
+  id3::v2::render(writer, tag);
+  tag.SetSpec(spec);
+  tag.SetExtended(extended);
+  tag.SetFooter(footer);
+  if (tagString.empty() || !ReplaceAppendedV2(tag, file, tagString))
+  {
+    return 0;
+  }
+
+  if (!seekTag.empty())
+  {
+    file.seekp(0, ios::beg);
+    file.write(seekTag.data(), seekTag.size());
+    file.flush();
+  }
+  return tagString.size();
+}
 
 flags_t ID3_TagImpl::Update(flags_t ulTagFlag)
 {
+  ID3_STATS_SCOPE(_stats, UPDATE);
   flags_t tags = ID3TT_NONE;
 
+  // what's cached about the file won't hold after this
+  ID3_TagCache* cache = ID3_TagCache::GetDefault();
+  if (cache)
+  {
+    cache->Remove(this->GetFileName().c_str());
+  }
+
   fstream file;
   String filename = this->GetFileName();
   ID3_Err err = openWritableFile(filename, file);
@@ -387,10 +613,47 @@ flags_t ID3_TagImpl::Update(flags_t ulTagFlag)
 
   if ((ulTagFlag & ID3TT_ID3V2) && this->HasChanged())
   {
-    _prepended_bytes = RenderV2ToFile(*this, file);
-    if (_prepended_bytes)
+    bool append = false;
+    if (this->GetAppend())
+    {
+      // once appended, keep appending; otherwise only append if the tag no
+      // longer fits in front of the audio data
+      String tagString;
+      io::StringWriter writer(tagString);
+      id3::v2::render(writer, *this);
+      append = this->HasTagType(ID3TT_ID3V2APPENDED) ||
+               !FitsInPlace(*this, tagString.size());
+    }
+
+    if (append)
+    {
+      const size_t dataEnd = _file_size - _appended_bytes;
+      size_t tag_bytes = RenderV2AppendedToFile(*this, file);
+      if (tag_bytes)
+      {
+        _appended_bytes += tag_bytes - _appended_v2_size;
+        _appended_v2_beg = dataEnd;
+        _appended_v2_size = tag_bytes;
+        tags |= ID3TT_ID3V2APPENDED;
+      }
+    }
+    else
     {
-      tags |= ID3TT_ID3V2;
+      if (this->HasTagType(ID3TT_ID3V2APPENDED) &&
+          ReplaceAppendedV2(*this, file, String()))
+      {
+        // the tag moves back to the front of the file
+        _appended_bytes -= _appended_v2_size;
+        _appended_v2_beg = 0;
+        _appended_v2_size = 0;
+        _file_tags.remove(ID3TT_ID3V2APPENDED);
+        _file_size = getFileSize(file);
+      }
+      _prepended_bytes = RenderV2ToFile(*this, file);
+      if (_prepended_bytes)
+      {
+        tags |= ID3TT_ID3V2;
+      }
     }
   }
 
@@ -417,12 +680,20 @@ flags_t ID3_TagImpl::Update(flags_t ulTagFlag)
 
 flags_t ID3_TagImpl::Strip(flags_t ulTagFlag)
 {
+  ID3_STATS_SCOPE(_stats, UPDATE);
   flags_t ulTags = ID3TT_NONE;
   const size_t data_size = ID3_GetDataSize(*this);
 
+  ID3_TagCache* cache = ID3_TagCache::GetDefault();
+  if (cache)
+  {
+    cache->Remove(this->GetFileName().c_str());
+  }
+
   // First remove the v2 tag, if requested
   if (ulTagFlag & ID3TT_PREPENDED & _file_tags.get())
   {
+    ID3_STATS_TIMER(FILE_REWRITE);
     fstream file;
     if (ID3E_NoError != openWritableFile(this->GetFileName(), file))
     {
@@ -448,13 +719,35 @@ flags_t ID3_TagImpl::Strip(flags_t ulTagFlag)
       nBytesToCopy += this->GetAppendedBytes();
     }
 
-    // The nBytesRemaining variable indicates how many bytes are left to be
-    // moved in the actual file.
     // The nBytesCopied variable keeps track of how many actual bytes were
     // copied (or moved) so far.
-    size_t nBytesRemaining = nBytesToCopy,
-    nBytesCopied = 0;
-    while (!file.eof())
+    size_t nBytesCopied = 0;
+
+    // Let the kernel do the moving where it can; the stream loop below is
+    // used if the file can't be opened as a plain descriptor, and moves what
+    // the kernel didn't.
+#if defined(ID3_HAVE_FILE_DESCRIPTORS)
+    int fd = open(this->GetFileName().c_str(), O_RDWR);
+    if (fd >= 0)
+    {
+      nBytesCopied = io::moveFileData(fd, this->GetPrependedBytes(), 0,
+                                      nBytesToCopy);
+      close(fd);
+      if (nBytesCopied < nBytesToCopy)
+      {
+        // the data is moved to the front, so what wasn't moved yet is still
+        // where it was
+        ID3D_WARNING( "ID3_TagImpl::Strip(): moving the rest after " <<
+                      nBytesCopied << " bytes" );
+        file.seekg(this->GetPrependedBytes() + nBytesCopied, ios::beg);
+      }
+    }
+#endif //defined(ID3_HAVE_FILE_DESCRIPTORS)
+
+    // The nBytesRemaining variable indicates how many bytes are left to be
+    // moved in the actual file.
+    size_t nBytesRemaining = nBytesToCopy;
+    while (nBytesCopied < nBytesToCopy && !file.eof())
     {
 #if (defined(__GNUC__) && __GNUC__ == 2)
       size_t nBytesToRead = (size_t)dami::min((unsigned int)(nBytesRemaining - nBytesCopied), (unsigned int)BUFSIZ);
@@ -484,7 +777,16 @@ flags_t ID3_TagImpl::Strip(flags_t ulTagFlag)
         break;
       }
     }
+    const bool bWritten = !file.bad();
     file.close();
+    if (nBytesCopied < nBytesToCopy || !bWritten)
+    {
+      // nothing is truncated, so what wasn't moved is still in the file,
+      // behind what was
+      ID3D_WARNING( "ID3_TagImpl::Strip(): only moved " << nBytesCopied <<
+                    " of " << nBytesToCopy << " bytes" );
+      return ulTags;
+    }
   }
 
   size_t nNewFileSize = data_size;
@@ -521,6 +823,15 @@ flags_t ID3_TagImpl::Strip(flags_t ulTagFlag)
     //ID3_THROW(ID3E_NoFile);
   }
 
+  if (ulTags & ID3TT_APPENDED)
+  {
+    _appended_v2_beg = 0;
+    _appended_v2_size = 0;
+  }
+  else if (_appended_v2_size && (ulTags & ID3TT_PREPENDED))
+  {
+    _appended_v2_beg -= _prepended_bytes;
+  }
   _prepended_bytes = (ulTags & ID3TT_PREPENDED) ? 0 : _prepended_bytes;
   _appended_bytes  = (ulTags & ID3TT_APPENDED)  ? 0 : _appended_bytes;
   _file_size = data_size + _prepended_bytes + _appended_bytes;
@@ -95,6 +95,7 @@ ID3_TagImpl::ID3_TagImpl(const char *name)
     _file_size(0),
     _prepended_bytes(0),
     _appended_bytes(0),
+    _sync_bytes(0),
     _is_file_writable(false),
     _mp3_info(NULL) // need to do this before this->Clear()
 {
@@ -112,6 +113,7 @@ ID3_TagImpl::ID3_TagImpl(const ID3_Tag &tag)
     _file_size(0),
     _prepended_bytes(0),
     _appended_bytes(0),
+    _sync_bytes(0),
     _is_file_writable(false),
     _mp3_info(NULL) // need to do this before this->Clear()
 {
@@ -123,6 +125,12 @@ ID3_TagImpl::~ID3_TagImpl()
   this->Clear();
 }
 
+size_t ID3_TagImpl::GetAudioSize() const
+{
+  const size_t end = _file_size - _appended_bytes;
+  return (end > this->GetAudioOffset()) ? end - this->GetAudioOffset() : 0;
+}
+
 void ID3_TagImpl::Clear()
 {
   for (iterator cur = _frames.begin(); cur != _frames.end(); ++cur)
@@ -136,6 +144,11 @@ void ID3_TagImpl::Clear()
   _frames.clear();
   _cursor = _frames.begin();
   _is_padded = true;
+  _is_appended = false;
+  _is_full_scan = false;
+  _is_crc_check = false;
+  _appended_v2_beg = 0;
+  _appended_v2_size = 0;
 
   _hdr.Clear();
   _hdr.SetSpec(ID3V2_LATEST);
@@ -255,6 +268,43 @@ bool ID3_TagImpl::SetExperimental(bool exp)
   return changed;
 }
 
+bool ID3_TagImpl::SetFooter(bool footer)
+{
+  bool changed = _hdr.SetFooter(footer);
+  _changed = changed || _changed;
+  return changed;
+}
+
+bool ID3_TagImpl::SetAppend(bool append)
+{
+  bool changed = (_is_appended != append);
+  if (changed)
+  {
+    _is_appended = append;
+  }
+  return changed;
+}
+
+bool ID3_TagImpl::SetFullScan(bool scan)
+{
+  bool changed = (_is_full_scan != scan);
+  if (changed)
+  {
+    _is_full_scan = scan;
+  }
+  return changed;
+}
+
+bool ID3_TagImpl::SetCrcCheck(bool check)
+{
+  bool changed = (_is_crc_check != check);
+  if (changed)
+  {
+    _is_crc_check = check;
+  }
+  return changed;
+}
+
 bool ID3_TagImpl::GetUnsync() const
 {
   return _hdr.GetUnsync();
@@ -33,6 +33,7 @@
 #include <stdio.h>
 #include "tag.h" // has frame.h, field.h
 #include "header_tag.h"
+#include "tag_stats.h"
 #include "mp3_header.h" //has io_decorators.h
 
 class ID3_Reader;
@@ -50,6 +51,7 @@ namespace dami
     namespace v2
     {
       bool parse(ID3_TagImpl& tag, ID3_Reader& rdr);
+      bool parseAppended(ID3_TagImpl& tag, ID3_Reader& rdr);
       void render(ID3_Writer& writer, const ID3_TagImpl& tag);
     };
   };
@@ -68,11 +70,24 @@ namespace dami
   {
     bool parse(ID3_TagImpl&, ID3_Reader&);
   };
+  namespace container
+  {
+    // where things are in a RIFF (wav), AIFF or FLAC file
+    struct Layout
+    {
+      ID3_Reader::pos_type tagBeg;    // an id3v2 tag in a chunk of its own
+      ID3_Reader::size_type tagSize;  // 0 if there is none
+      ID3_Reader::pos_type audioBeg;
+      bool isMpeg;                    // could the audio be mpeg frames?
+    };
+    bool parse(ID3_Reader&, Layout&);
+  };
 };
 
 class ID3_TagImpl
 {
   typedef std::list<ID3_Frame *> Frames;
+  friend class ID3_TagCache;   // saves and restores what Link() found
 public:
   typedef Frames::iterator       iterator;
   typedef Frames::const_iterator const_iterator;
@@ -90,11 +105,18 @@ public:
   bool       SetExtended(bool);
   bool       SetExperimental(bool);
   bool       SetPadding(bool);
+  bool       SetFooter(bool);
+  bool       SetAppend(bool);
+  bool       SetFullScan(bool);
+  bool       SetCrcCheck(bool);
 
   bool       GetUnsync() const;
   bool       GetExtended() const;
   bool       GetExperimental() const;
   bool       GetFooter() const;
+  bool       GetAppend() const { return _is_appended; }
+  bool       GetFullScan() const { return _is_full_scan; }
+  bool       GetCrcCheck() const { return _is_crc_check; }
 
   size_t     GetExtendedBytes() const;
 
@@ -105,13 +127,24 @@ public:
 
   size_t     Link(const char *fileInfo, flags_t = (flags_t) ID3TT_ALL);
   size_t     Link(ID3_Reader &reader, flags_t = (flags_t) ID3TT_ALL);
+  size_t     LinkStream(ID3_Reader &reader, flags_t = (flags_t) ID3TT_ID3V2);
   flags_t    Update(flags_t = (flags_t) ID3TT_ALL);
   flags_t    Strip(flags_t = (flags_t) ID3TT_ALL);
 
+  // Link(fileInfo) in two steps, for ID3_TagBatch which reads the files
+  // itself: the file is only parsed when the cache hasn't got it
+  bool       LinkCached(const char *fileInfo, flags_t = (flags_t) ID3TT_ALL);
+  void       ParseFile(ID3_Reader &reader, int fd);
+
   size_t     GetPrependedBytes() const { return _prepended_bytes; }
   size_t     GetAppendedBytes() const { return _appended_bytes; }
+  size_t     GetAudioOffset() const { return _prepended_bytes + _sync_bytes; }
+  size_t     GetAudioSize() const;
+  size_t     GetAppendedV2Beg() const { return _appended_v2_beg; }
+  size_t     GetAppendedV2Bytes() const { return _appended_v2_size; }
   size_t     GetFileSize() const { return _file_size; }
   dami::String GetFileName() const { return _file_name; }
+  const ID3_TagStats& GetStats() const { return _stats; }
 
   ID3_Frame* Find(ID3_FrameID id) const;
   ID3_Frame* Find(ID3_FrameID id, ID3_FieldID fld, uint32 data) const;
@@ -128,6 +161,8 @@ public:
   static size_t IsV2Tag(ID3_Reader&);
 
   const Mp3_Headerinfo* GetMp3HeaderInfo() const { if (_mp3_info) return _mp3_info->GetMp3HeaderInfo(); else return NULL; }
+  const ID3_Mp3FrameIndex* GetMp3FrameIndex() const { if (_mp3_info) return _mp3_info->GetFrameIndex(); else return NULL; }
+  const ID3_Mp3VbrHeader* GetMp3VbrHeader() const { if (_mp3_info) return _mp3_info->GetVbrHeader(); else return NULL; }
 
   iterator         begin()       { return _frames.begin(); }
   iterator         end()         { return _frames.end(); }
@@ -152,10 +187,14 @@ protected:
 
   void       ParseFile();
   void       ParseReader(ID3_Reader &reader);
+  void       ParseStream(ID3_Reader &reader);
 
 private:
   ID3_TagHeader _hdr;          // information relevant to the tag header
   bool       _is_padded;       // add padding to tags?
+  bool       _is_appended;     // append a v2.4 tag rather than rewrite file?
+  bool       _is_full_scan;    // scan all mpeg frames when parsing?
+  bool       _is_crc_check;    // check their crc while scanning?
 
   Frames     _frames;
 
@@ -167,10 +206,14 @@ private:
   size_t     _file_size;       // the size of the file (without any tag(s))
   size_t     _prepended_bytes; // number of tag bytes at start of file
   size_t     _appended_bytes;  // number of tag bytes at end of file
+  size_t     _sync_bytes;      // bytes between the tag and the mpeg data
+  size_t     _appended_v2_beg; // file position of an appended v2.4 tag
+  size_t     _appended_v2_size;// size of that tag, 0 if there is none
   bool       _is_file_writable;// is the associated file (via Link) writable?
   ID3_Flags  _tags_to_parse;   // which tag types should attempt to be parsed
   ID3_Flags  _file_tags;       // which tag types does the file contain
   Mp3Info    *_mp3_info;   // class used to retrieve _mp3_header
+  ID3_TagStats _stats;         // time spent in Link() and Update(), if kept
 };
 
 size_t     ID3_GetDataSize(const ID3_TagImpl&);
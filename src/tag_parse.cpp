@@ -30,12 +30,15 @@
 //#endif
 
 //#include <zlib.h>
-//#include <string.h>
+#include <string.h>
 //#include <memory.h>
 
 #include "tag_impl.h" //has <stdio.h> "tag.h" "header_tag.h" "frame.h" "field.h" "spec.h" "id3lib_strings.h" "utils.h"
 //#include "id3/io_decorators.h" //has "readers.h" "io_helpers.h" "utils.h"
 #include "io_strings.h"
+#include "io_file.h"
+#include "id3/tag_cache.h"
+#include "stats.h"
 
 using namespace dami;
 
@@ -77,6 +80,13 @@ namespace
         ID3D_WARNING( "id3::v2::parseFrames(): bad parse, deleting frame");
         delete f;
       }
+      else if (f->GetID() == ID3FID_SEEKFRAME)
+      {
+        // a seek frame only describes where this tag was in the file.  The
+        // appended tag it points to is found from the end of the file.
+        ID3D_NOTICE( "id3::v2::parseFrames(): skipping seek frame");
+        delete f;
+      }
       else if (f->GetID() != ID3FID_METACOMPRESSION)
       {
         ID3D_NOTICE( "id3::v2::parseFrames(): attaching non-compressed " <<
@@ -132,6 +142,55 @@ namespace
     }
     return true;
   }
+
+  // the mpeg data is searched for in blocks this big
+  const size_t SYNC_BLOCK = 64 * 1024;
+  // and no further than this past where the search starts
+  const size_t SYNC_SEARCH = 4 * 1024 * 1024;
+  // the tags at the end of the file are looked for in a block this big,
+  // read at once; id3v1, lyrics3 and musicmatch tags usually fit in it
+  const size_t TAIL_SIZE = 16 * 1024;
+
+  // Finds where the mpeg data starts, from the reader's position on: the
+  // first sync that a few frames of the same format follow.  The blocks
+  // overlap by enough to check those frames.  Without such a sync, this is
+  // the first sync byte, or the end.
+  ID3_Reader::pos_type findMpegSync(ID3_Reader& reader)
+  {
+    ID3_STATS_TIMER(SYNC_SEARCH);
+    const ID3_Reader::pos_type beg = reader.getCur();
+    const ID3_Reader::pos_type end = min<ID3_Reader::pos_type>(reader.getEnd(),
+                                                               beg + SYNC_SEARCH);
+    BString buf(SYNC_BLOCK + mp3::SYNC_LOOKAHEAD, '\0');
+    ID3_Reader::pos_type first = reader.getEnd();
+    for (ID3_Reader::pos_type pos = beg; pos < end; pos += SYNC_BLOCK)
+    {
+      reader.setCur(pos);
+      const size_t size = reader.readChars(&buf[0], min<size_t>(buf.size(),
+                                                    reader.getEnd() - pos));
+      const bool atEnd = (pos + size >= reader.getEnd());
+      const size_t limit = min<size_t>(SYNC_BLOCK, end - pos);
+      const size_t sync = mp3::findSync(buf.data(), size, limit, atEnd);
+      if (sync < size)
+      {
+        return pos + sync;
+      }
+      if (first == reader.getEnd())
+      {
+        const void* ff = ::memchr(buf.data(), 0xFF, min(limit, size));
+        if (ff != NULL)
+        {
+          first = pos + (static_cast<const uchar*>(ff) - buf.data());
+        }
+      }
+      if (size == 0 || atEnd)
+      {
+        break;
+      }
+    }
+    ID3D_NOTICE( "findMpegSync(): no run of frames, first sync = " << first );
+    return first;
+  }
 };
 
 bool id3::v2::parse(ID3_TagImpl& tag, ID3_Reader& reader)
@@ -159,12 +218,19 @@ bool id3::v2::parse(ID3_TagImpl& tag, ID3_Reader& reader)
 
   wr.setWindow(wr.getCur(), dataSize);
   et.setExitPos(wr.getEnd());
+  if (hdr.GetFooter() && hdr.GetSpec() == ID3V2_4_0 &&
+      reader.getEnd() >= wr.getEnd() + ID3_TagHeader::SIZE)
+  {
+    // the footer belongs to the tag, too
+    et.setExitPos(wr.getEnd() + ID3_TagHeader::SIZE);
+  }
 
   ID3D_NOTICE( "ID3_TagImpl::Parse(ID3_Reader&): data window beg = " << wr.getBeg() );
   ID3D_NOTICE( "ID3_TagImpl::Parse(ID3_Reader&): data window cur = " << wr.getCur() );
   ID3D_NOTICE( "ID3_TagImpl::Parse(ID3_Reader&): data window end = " << wr.getEnd() );
   tag.SetExtended(hdr.GetExtended());
-  if (!hdr.GetUnsync())
+  // id3v2.4.0 tags are unsynchronised frame by frame, see ID3_FrameImpl::Parse
+  if (!hdr.GetUnsync() || hdr.GetSpec() == ID3V2_4_0)
   {
     tag.SetUnsync(false);
     parseFrames(tag, wr);
@@ -202,8 +268,57 @@ bool id3::v2::parse(ID3_TagImpl& tag, ID3_Reader& reader)
   return true;
 }
 
+bool id3::v2::parseAppended(ID3_TagImpl& tag, ID3_Reader& reader)
+{
+  io::ExitTrigger et(reader);
+
+  ID3_Reader::pos_type end = reader.getCur();
+  if (end < reader.getBeg() + 2 * ID3_TagHeader::SIZE)
+  {
+    return false;
+  }
+  reader.setCur(end - ID3_TagHeader::SIZE);
+  size_t tagSize = ID3_TagHeader::ParseFooter(reader);
+  if (tagSize == 0 || end < reader.getBeg() + tagSize)
+  {
+    return false;
+  }
+  ID3_Reader::pos_type beg = end - tagSize;
+  ID3D_NOTICE( "id3::v2::parseAppended(): found footer, tag at " << beg );
+
+  // the footer has to be closing the tag that its size points to
+  reader.setCur(beg);
+  if (ID3_TagImpl::IsV2Tag(reader) != tagSize - ID3_TagHeader::SIZE)
+  {
+    ID3D_WARNING( "id3::v2::parseAppended(): footer doesn't match header" );
+    return false;
+  }
+  reader.setCur(beg);
+  io::WindowedReader wr(reader);
+  wr.setEnd(end);
+  if (!id3::v2::parse(tag, wr))
+  {
+    return false;
+  }
+  et.setExitPos(beg);
+  return true;
+}
+
 void ID3_TagImpl::ParseFile()
 {
+  ID3_STATS_SCOPE(_stats, LINK);
+#if defined ID3_HAVE_FILE_DESCRIPTORS
+  // read the head and the tail of the file at once, rather than in the many
+  // small reads that parsing them takes
+  io::PrefetchFileReader pfr(this->GetFileName().c_str());
+  if (!pfr.isOpen())
+  {
+    // log this...
+    return;
+  }
+  ParseFile(pfr, pfr.getFd());
+  pfr.close();
+#else
   ifstream file;
   if (ID3E_NoError != openReadableFile(this->GetFileName(), file))
   {
@@ -213,11 +328,30 @@ void ID3_TagImpl::ParseFile()
   ID3_IFStreamReader ifsr(file);
   ParseReader(ifsr);
   file.close();
+#endif
+}
+
+// parses the linked file, open as fd, from reader, and keeps what was found
+// in the cache
+void ID3_TagImpl::ParseFile(ID3_Reader &reader, int fd)
+{
+  ParseReader(reader);
+  ID3_TagCache* cache = _is_full_scan ? NULL : ID3_TagCache::GetDefault();
+  if (cache)
+  {
+    cache->Store(fd, *this, reader);
+  }
 }
 
 //used for streaming media
-void ID3_TagImpl::ParseReader(ID3_Reader &reader)
+void ID3_TagImpl::ParseReader(ID3_Reader &file)
 {
+  ID3_STATS_SCOPE(_stats, LINK);
+#if defined ID3_ENABLE_STATS
+  io::CountingReader reader(file, stats::io());
+#else
+  ID3_Reader& reader = file;
+#endif
   size_t mp3_core_size;
   size_t bytes_till_sync;
 
@@ -226,6 +360,8 @@ void ID3_TagImpl::ParseReader(ID3_Reader &reader)
 
   _file_tags.clear();
   _file_size = reader.getEnd();
+  _appended_v2_beg = 0;
+  _appended_v2_size = 0;
 
   ID3_Reader::pos_type beg  = wr.getBeg();
   ID3_Reader::pos_type cur  = wr.getCur();
@@ -247,24 +383,12 @@ void ID3_TagImpl::ParseReader(ID3_Reader &reader)
       wr.setBeg(cur);
     } while (!wr.atEnd() && cur > last);
   }
-  // add silly padding outside the tag to _prepended_bytes
-  if (!wr.atEnd() && wr.peekChar() == '\0')
   {
-    ID3D_NOTICE( "ID3_TagImpl::ParseReader(): found padding outside tag" );
-    do
+    ID3_STATS_TIMER(PADDING_SKIP);
+    // add silly padding outside the tag to _prepended_bytes
+    if (!wr.atEnd() && wr.peekChar() == '\0')
     {
-      last = cur;
-      cur = wr.getCur() + 1;
-      wr.setBeg(cur);
-      wr.setCur(cur);
-    } while (!wr.atEnd() &&  cur > last && wr.peekChar() == '\0');
-  }
-  if (!wr.atEnd() && _file_size - (cur - beg) > 4 && wr.peekChar() == 255)
-  { //unfortunatly, this is necessary for finding an invalid padding
-    wr.setCur(cur + 1); //cur is known by peekChar
-    if (wr.readChar() == '\0' && wr.readChar() == '\0' && wr.peekChar() == '\0')
-    { //three empty bytes found, enough for me, this is stupid padding
-      cur += 3; //those are now allready read in (excluding the peekChar, since it will be added by do{})
+      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): found padding outside tag" );
       do
       {
         last = cur;
@@ -273,59 +397,64 @@ void ID3_TagImpl::ParseReader(ID3_Reader &reader)
         wr.setCur(cur);
       } while (!wr.atEnd() &&  cur > last && wr.peekChar() == '\0');
     }
-    else
-      wr.setCur(cur);
+    if (!wr.atEnd() && _file_size - (cur - beg) > 4 && wr.peekChar() == 255)
+    { //unfortunatly, this is necessary for finding an invalid padding
+      wr.setCur(cur + 1); //cur is known by peekChar
+      if (wr.readChar() == '\0' && wr.readChar() == '\0' && wr.peekChar() == '\0')
+      { //three empty bytes found, enough for me, this is stupid padding
+        cur += 3; //those are now allready read in (excluding the peekChar, since it will be added by do{})
+        do
+        {
+          last = cur;
+          cur = wr.getCur() + 1;
+          wr.setBeg(cur);
+          wr.setCur(cur);
+        } while (!wr.atEnd() &&  cur > last && wr.peekChar() == '\0');
+      }
+      else
+        wr.setCur(cur);
+    }
   }
   _prepended_bytes = cur - beg;
   // go looking for the first sync byte to add to bytes_till_sync
   // by not adding it to _prepended_bytes, we preserve this 'unknown' data
   // The routine's only effect is helping the lib to find things as bitrate etc.
   beg  = wr.getBeg();
+  bool is_mpeg = true;
   if (!wr.atEnd() && wr.peekChar() != 0xFF) //no sync byte, so, either this is not followed by a mp3 file or it's a fLaC file, or an encapsulating format, better check it
   {
     ID3D_NOTICE( "ID3_TagImpl::ParseReader(): Didn't find mp3 sync byte" );
     if ((_file_size - (cur - beg)) >= 4)
     { //there is room to search for some kind of ID
-      unsigned char buf[5];
-      wr.readChars(buf, 4);
-      buf[4] = '\0';
-      // check for RIFF (an encapsulating format) ID
-      if (strncmp((char*)buf, "RIFF", 4) == 0 || strncmp((char*)buf, "RIFX", 4) == 0)
+      // check for an encapsulating format: RIFF, RIFX, AIFF or fLaC
+      container::Layout layout;
+      wr.setCur(cur);
+      if (container::parse(wr, layout))
       {
-        // next 4 bytes are RIFF size, skip them
-        cur = wr.getCur() + 4;
-        wr.setCur(cur);
-        // loop until first possible sync byte
-        if (!wr.atEnd() && wr.peekChar() != 0xFF)
+        if (layout.tagSize > 0 && _tags_to_parse.test(ID3TT_ID3V2))
         {
-          do
+          io::WindowedReader tr(wr, layout.tagBeg, layout.tagSize);
+          tr.setCur(layout.tagBeg);
+          if (id3::v2::parse(*this, tr))
           {
-            last = cur;
-            cur = wr.getCur() + 1;
-            wr.setCur(cur);
-          } while (!wr.atEnd() &&  cur > last && wr.peekChar() != 0xFF);
+            ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v2 chunk at " << layout.tagBeg );
+            _file_tags.add(ID3TT_ID3V2);
+          }
         }
-      }
-      else if (strncmp((char*)buf, "fLaC", 4) == 0)
-      { //a FLAC file, no need looking for a sync byte
-        beg = cur;
-      }
-      else
-      { //since we set the cursor 4 bytes ahead for looking for RIFF, RIFX or fLaC, better set it back
-        // but peekChar allready checked the first one, so we add one
-        cur = cur + 1;
-        wr.setCur(cur);
-        //go looking for a sync byte
-        if (!wr.atEnd() && wr.peekChar() != 0xFF) //no sync byte, we have an unknown byte
+        cur = layout.audioBeg;
+        is_mpeg = layout.isMpeg;
+        if (is_mpeg)
         {
-          do
-          {
-            last = cur;
-            cur = wr.getCur() + 1;
-            wr.setCur(cur);
-          } while (!wr.atEnd() &&  cur > last && wr.peekChar() != 0xFF);
+          wr.setCur(cur);
+          cur = findMpegSync(wr);
         }
       }
+      else
+      { // peekChar allready checked the first byte, so we add one
+        wr.setCur(cur + 1);
+        //go looking for a sync byte, with frames after it
+        cur = findMpegSync(wr);
+      }
     } //if ((_file_size - (cur - beg)) >= 4)
     else
     { //remaining size is smaller than 4 bytes, can't be useful, but leave it for now
@@ -334,63 +463,90 @@ void ID3_TagImpl::ParseReader(ID3_Reader &reader)
       //return;
     }
   }
+  else if (!wr.atEnd())
+  {
+    // usually the first frame, but make sure it isn't junk that looks like
+    // one
+    wr.setCur(cur);
+    cur = findMpegSync(wr);
+  }
   bytes_till_sync = cur - beg;
+  _sync_bytes = bytes_till_sync;
 
-  cur = wr.setCur(end);
   if (_file_size > _prepended_bytes)
   {
-    do
     {
-      last = cur;
-      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): beg = " << wr.getBeg() );
-      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): cur = " << wr.getCur() );
-      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): end = " << wr.getEnd() );
-      // ...then the tags at the end
-      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): musicmatch? cur = " << wr.getCur() );
-      if (_tags_to_parse.test(ID3TT_MUSICMATCH) && mm::parse(*this, wr))
-      {
-        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): musicmatch! cur = " << wr.getCur() );
-        _file_tags.add(ID3TT_MUSICMATCH);
-        wr.setEnd(wr.getCur());
-      }
-      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): lyr3v1? cur = " << wr.getCur() );
-      if (_tags_to_parse.test(ID3TT_LYRICS3) && lyr3::v1::parse(*this, wr))
-      {
-        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): lyr3v1! cur = " << wr.getCur() );
-        _file_tags.add(ID3TT_LYRICS3);
-        wr.setEnd(wr.getCur());
-      }
-      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): lyr3v2? cur = " << wr.getCur() );
-      if (_tags_to_parse.test(ID3TT_LYRICS3V2) && lyr3::v2::parse(*this, wr))
+      ID3_STATS_TIMER(TAIL_TAGS);
+      // read the end of the file once; the parsers below try their signatures
+      // on it in memory, and only large tag bodies are read from the file
+      io::TailBufferedReader tail(wr, TAIL_SIZE);
+      io::WindowedReader tr(tail);
+      cur = tr.setCur(end);
+      do
       {
-        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): lyr3v2! cur = " << wr.getCur() );
-        _file_tags.add(ID3TT_LYRICS3V2);
-        cur = wr.getCur();
-        wr.setCur(wr.getEnd());//set to end to seek id3v1 tag
-        //check for id3v1 tag and set End accordingly
-        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v1? cur = " << wr.getCur() );
-        if (_tags_to_parse.test(ID3TT_ID3V1) && id3::v1::parse(*this, wr))
+        last = cur;
+        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): beg = " << tr.getBeg() );
+        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): cur = " << tr.getCur() );
+        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): end = " << tr.getEnd() );
+        // ...then the tags at the end
+        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): musicmatch? cur = " << tr.getCur() );
+        if (_tags_to_parse.test(ID3TT_MUSICMATCH) && mm::parse(*this, tr))
+        {
+          ID3D_NOTICE( "ID3_TagImpl::ParseReader(): musicmatch! cur = " << tr.getCur() );
+          _file_tags.add(ID3TT_MUSICMATCH);
+          tr.setEnd(tr.getCur());
+        }
+        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): lyr3v1? cur = " << tr.getCur() );
+        if (_tags_to_parse.test(ID3TT_LYRICS3) && lyr3::v1::parse(*this, tr))
         {
-          ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v1! cur = " << wr.getCur() );
+          ID3D_NOTICE( "ID3_TagImpl::ParseReader(): lyr3v1! cur = " << tr.getCur() );
+          _file_tags.add(ID3TT_LYRICS3);
+          tr.setEnd(tr.getCur());
+        }
+        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): lyr3v2? cur = " << tr.getCur() );
+        if (_tags_to_parse.test(ID3TT_LYRICS3V2) && lyr3::v2::parse(*this, tr))
+        {
+          ID3D_NOTICE( "ID3_TagImpl::ParseReader(): lyr3v2! cur = " << tr.getCur() );
+          _file_tags.add(ID3TT_LYRICS3V2);
+          cur = tr.getCur();
+          tr.setCur(tr.getEnd());//set to end to seek id3v1 tag
+          //check for id3v1 tag and set End accordingly
+          ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v1? cur = " << tr.getCur() );
+          if (_tags_to_parse.test(ID3TT_ID3V1) && id3::v1::parse(*this, tr))
+          {
+            ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v1! cur = " << tr.getCur() );
+            _file_tags.add(ID3TT_ID3V1);
+          }
+          tr.setCur(cur);
+          tr.setEnd(cur);
+        }
+        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v1? cur = " << tr.getCur() );
+        if (_tags_to_parse.test(ID3TT_ID3V1) && id3::v1::parse(*this, tr))
+        {
+          ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v1! cur = " << tr.getCur() );
+          tr.setEnd(tr.getCur());
           _file_tags.add(ID3TT_ID3V1);
         }
-        wr.setCur(cur);
-        wr.setEnd(cur);
-      }
-      ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v1? cur = " << wr.getCur() );
-      if (_tags_to_parse.test(ID3TT_ID3V1) && id3::v1::parse(*this, wr))
-      {
-        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v1! cur = " << wr.getCur() );
-        wr.setEnd(wr.getCur());
-        _file_tags.add(ID3TT_ID3V1);
-      }
-      cur = wr.getCur();
-    } while (cur != last);
-    _appended_bytes = end - cur;
+        ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v2 appended? cur = " << tr.getCur() );
+        cur = tr.getCur();
+        if (_tags_to_parse.test(ID3TT_ID3V2APPENDED) &&
+            !_file_tags.test(ID3TT_ID3V2APPENDED) &&
+            id3::v2::parseAppended(*this, tr))
+        {
+          ID3D_NOTICE( "ID3_TagImpl::ParseReader(): id3v2 appended! cur = " << tr.getCur() );
+          _appended_v2_beg = tr.getCur();
+          _appended_v2_size = cur - tr.getCur();
+          tr.setEnd(tr.getCur());
+          _file_tags.add(ID3TT_ID3V2APPENDED);
+        }
+        cur = tr.getCur();
+      } while (cur != last);
+      _appended_bytes = end - cur;
+    }
 
     // Now get the mp3 header
     mp3_core_size = (_file_size - _appended_bytes) - (_prepended_bytes + bytes_till_sync);
-    if (mp3_core_size >= 4)
+    if (mp3_core_size >= 4 && is_mpeg)
     { //it has at least the size for a mp3 header (a mp3 header is 4 bytes)
       wr.setBeg(_prepended_bytes + bytes_till_sync);
       wr.setCur(_prepended_bytes + bytes_till_sync);
@@ -402,6 +558,12 @@ void ID3_TagImpl::ParseReader(ID3_Reader &reader)
       if (_mp3_info->Parse(wr, mp3_core_size))
       {
         ID3D_NOTICE( "ID3_TagImpl::ParseReader(): mp3header! cur = " << wr.getCur() );
+        if (_is_full_scan)
+        {
+          wr.setCur(_prepended_bytes + bytes_till_sync);
+          _mp3_info->Scan(wr, mp3_core_size, this->GetFileName(),
+                          _is_crc_check);
+        }
       }
       else
       {
@@ -414,3 +576,126 @@ void ID3_TagImpl::ParseReader(ID3_Reader &reader)
     this->SetPadding(false); //no need to pad an empty file
 }
 
+
+namespace
+{
+  // A forward-only reader can't tell whether it is at its end without
+  // seeking (see ID3_IStreamReader::getEnd), so only readChars is used here:
+  // reads until buf holds len bytes or the reader runs dry.
+  bool fillStream(ID3_Reader& reader, BString& buf, size_t len)
+  {
+    const size_t SIZE = 1024;
+    ID3_Reader::char_type bytes[SIZE];
+    while (buf.size() < len)
+    {
+      size_t numRead = reader.readChars(bytes, min(len - buf.size(), SIZE));
+      if (numRead == 0)
+      {
+        break;
+      }
+      buf.append(reinterpret_cast<BString::value_type *>(bytes), numRead);
+    }
+    return buf.size() >= len;
+  }
+
+  // the first mpeg sync must show up within this many bytes of the tag
+  const size_t STREAM_SYNC_LOOKAHEAD = 8 * 1024;
+  // and this much is read from the sync on, for the frame and vbr headers
+  const size_t STREAM_FRAME_LOOKAHEAD = 4 * 1024;
+}
+
+//used for pipes and sockets: never seeks, never asks for the size
+void ID3_TagImpl::ParseStream(ID3_Reader &file)
+{
+  ID3_STATS_SCOPE(_stats, LINK);
+#if defined ID3_ENABLE_STATS
+  io::CountingReader reader(file, stats::io());
+#else
+  ID3_Reader& reader = file;
+#endif
+  const size_t HEADER = ID3_TagHeader::SIZE;
+  BString buf; // read from the reader, but not parsed yet
+
+  _file_tags.clear();
+  _file_size = 0;
+  _prepended_bytes = 0;
+  _appended_bytes = 0;
+  _appended_v2_beg = 0;
+  _appended_v2_size = 0;
+  _sync_bytes = 0;
+  delete _mp3_info;
+  _mp3_info = NULL;
+
+  while (_tags_to_parse.test(ID3TT_ID3V2) && fillStream(reader, buf, HEADER))
+  {
+    io::BStringReader hr(buf);
+    size_t tagSize = ID3_TagImpl::IsV2Tag(hr);
+    if (tagSize == 0)
+    {
+      break;
+    }
+    if (buf[3] == 4 && (buf[5] & ID3_TagHeader::HEADER_FLAG_FOOTER))
+    {
+      tagSize += HEADER;
+    }
+    ID3D_NOTICE( "ID3_TagImpl::ParseStream(): tag size = " << tagSize );
+    if (!fillStream(reader, buf, tagSize))
+    {
+      ID3D_WARNING( "ID3_TagImpl::ParseStream(): stream ends inside the tag" );
+      _prepended_bytes += buf.size();
+      return;
+    }
+    BString tag = buf.substr(0, tagSize);
+    io::BStringReader bsr(tag);
+    if (id3::v2::parse(*this, bsr))
+    {
+      _file_tags.add(ID3TT_ID3V2);
+    }
+    buf.erase(0, tagSize);
+    _prepended_bytes += tagSize;
+  }
+
+  // add silly padding outside the tag to _prepended_bytes
+  size_t pos = 0;
+  while (fillStream(reader, buf, pos + 1) && buf[pos] == '\0' &&
+         pos < STREAM_SYNC_LOOKAHEAD)
+  {
+    ++pos;
+  }
+  _prepended_bytes += pos;
+  buf.erase(0, pos);
+
+  // go looking for the first sync, reading ahead no further than needed
+  for (pos = 0; pos < STREAM_SYNC_LOOKAHEAD; ++pos)
+  {
+    if (!fillStream(reader, buf, pos + 2))
+    {
+      return;
+    }
+    if (buf[pos] == 0xFF && (buf[pos + 1] & 0xE0) == 0xE0)
+    {
+      break;
+    }
+  }
+  if (pos == STREAM_SYNC_LOOKAHEAD)
+  {
+    ID3D_NOTICE( "ID3_TagImpl::ParseStream(): Didn't find mp3 sync byte" );
+    return;
+  }
+  _sync_bytes = pos;
+  fillStream(reader, buf, pos + STREAM_FRAME_LOOKAHEAD);
+
+  io::BStringReader bsr(buf);
+  bsr.setCur(pos);
+  _mp3_info = new Mp3Info;
+  if (_mp3_info->Parse(bsr, buf.size() - pos))
+  {
+    ID3D_NOTICE( "ID3_TagImpl::ParseStream(): mp3header! sync = " << pos );
+    _mp3_info->SetSizeUnknown();
+  }
+  else
+  {
+    delete _mp3_info;
+    _mp3_info = NULL;
+  }
+}
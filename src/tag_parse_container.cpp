@@ -0,0 +1,170 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#include <string.h>
+#include "tag_impl.h" //has <stdio.h> "tag.h" "header_tag.h" "frame.h" "field.h" "spec.h" "id3lib_strings.h" "utils.h"
+#include "id3/io_decorators.h" //has "readers.h" "io_helpers.h" "utils.h"
+
+using namespace dami;
+
+namespace
+{
+  // no file has more chunks than this before its audio or tag
+  const size_t MAX_CHUNKS = 1024;
+
+  uint32 readNumber(ID3_Reader& reader, size_t len, bool bigEndian)
+  {
+    return bigEndian ? io::readBENumber(reader, len) : io::readLENumber(reader, len);
+  }
+
+  bool isTagChunk(const uchar* id)
+  {
+    return ::memcmp(id, "ID3 ", 4) == 0 || ::memcmp(id, "id3 ", 4) == 0;
+  }
+
+  // Walks the chunks of a RIFF (little endian), RIFX or FORM (big endian)
+  // file from the reader's position on, right after the form type, reading
+  // just the header of each
+  bool parseChunks(ID3_Reader& reader, ID3_Reader::pos_type end,
+                   bool bigEndian, bool aiff, container::Layout& layout)
+  {
+    bool audio = false;
+    ID3_Reader::pos_type pos = reader.getCur();
+    for (size_t n = 0; n < MAX_CHUNKS && pos + 8 <= end; ++n)
+    {
+      uchar id[4];
+      reader.setCur(pos);
+      if (reader.readChars(id, 4) < 4)
+      {
+        break;
+      }
+      const uint32 size = readNumber(reader, 4, bigEndian);
+      const ID3_Reader::pos_type data = pos + 8;
+      const ID3_Reader::size_type avail = min<ID3_Reader::size_type>(size, end - data);
+      ID3D_NOTICE( "container::parse(): chunk " << String((char*) id, 4) <<
+                   ", size = " << size );
+      if (isTagChunk(id))
+      {
+        layout.tagBeg = data;
+        layout.tagSize = avail;
+      }
+      else if (!aiff && ::memcmp(id, "fmt ", 4) == 0 && avail >= 2)
+      {
+        const uint32 format = readNumber(reader, 2, bigEndian);
+        // WAVE_FORMAT_MPEG and WAVE_FORMAT_MPEGLAYER3
+        layout.isMpeg = (format == 0x0050 || format == 0x0055);
+      }
+      else if (!aiff && ::memcmp(id, "data", 4) == 0)
+      {
+        layout.audioBeg = data;
+        audio = true;
+      }
+      else if (aiff && ::memcmp(id, "SSND", 4) == 0 && avail >= 8)
+      {
+        // the samples start after an offset and a block size
+        layout.audioBeg = min<ID3_Reader::pos_type>(data + 8 + readNumber(reader, 4, true), end);
+        audio = true;
+      }
+      if (audio && layout.tagSize > 0)
+      {
+        break;
+      }
+      // chunks are padded to an even size
+      const ID3_Reader::pos_type next = data + size + (size & 1);
+      if (next <= pos || size > end - data)
+      {
+        break;
+      }
+      pos = next;
+    }
+    return audio || layout.tagSize > 0;
+  }
+
+  // Skips the metadata blocks of a FLAC file, from right after "fLaC"
+  bool parseFlac(ID3_Reader& reader, ID3_Reader::pos_type end,
+                 container::Layout& layout)
+  {
+    ID3_Reader::pos_type pos = reader.getCur();
+    for (size_t n = 0; n < MAX_CHUNKS && pos + 4 <= end; ++n)
+    {
+      reader.setCur(pos);
+      const uint32 header = io::readBENumber(reader, 4);
+      pos += 4 + (header & 0xFFFFFF);
+      if (header & 0x80000000)
+      {
+        // the last block
+        layout.audioBeg = min(pos, end);
+        return true;
+      }
+    }
+    return false;
+  }
+}
+
+// Finds the id3v2 tag and the audio in a RIFF, RIFX (wav), FORM (AIFF) or
+// FLAC file that starts at the reader's position.  Chunks and metadata
+// blocks are skipped by their size, so only a few bytes of each are read,
+// however large the audio.  Returns false, with the reader where it was, if
+// the file is none of these.
+bool container::parse(ID3_Reader& reader, container::Layout& layout)
+{
+  io::ExitTrigger et(reader);
+  const ID3_Reader::pos_type beg = reader.getCur();
+  const ID3_Reader::pos_type end = reader.getEnd();
+  layout.tagBeg = 0;
+  layout.tagSize = 0;
+  layout.audioBeg = beg;
+  layout.isMpeg = false;
+
+  uchar id[12];
+  const size_t len = reader.readChars(id, sizeof(id));
+  if (len >= 4 && ::memcmp(id, "fLaC", 4) == 0)
+  {
+    reader.setCur(beg + 4);
+    return parseFlac(reader, end, layout);
+  }
+  if (len < sizeof(id))
+  {
+    return false;
+  }
+  const bool riff = ::memcmp(id, "RIFF", 4) == 0;
+  const bool rifx = ::memcmp(id, "RIFX", 4) == 0;
+  const bool form = ::memcmp(id, "FORM", 4) == 0 &&
+                    (::memcmp(id + 8, "AIFF", 4) == 0 || ::memcmp(id + 8, "AIFC", 4) == 0);
+  if (!riff && !rifx && !form)
+  {
+    return false;
+  }
+  reader.setCur(beg + 4);
+  const uint32 size = readNumber(reader, 4, !riff);
+  const ID3_Reader::pos_type formEnd =
+    (size >= 4 && size - 4 <= end - (beg + 12)) ? beg + 8 + size : end;
+  reader.setCur(beg + 12);
+  // an mpeg file in a RIFF container without a format chunk is still mpeg
+  layout.isMpeg = riff || rifx;
+  return parseChunks(reader, formEnd, !riff, form, layout);
+}
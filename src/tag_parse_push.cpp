@@ -0,0 +1,334 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#if defined HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "id3/push_parser.h"
+#include "header_tag.h"
+#include "header_frame.h"
+#include "id3/io_helpers.h"
+#include "io_strings.h"
+
+using namespace dami;
+
+namespace
+{
+  enum
+  {
+    PS_HEADER,        // collecting the tag header
+    PS_EXTSIZE,       // collecting the size of the extended header
+    PS_EXTENDED,      // collecting (and ignoring) the extended header
+    PS_FRAMEHEADER,   // collecting the next frame header
+    PS_FRAME,         // collecting the rest of the frame
+    PS_PADDING,       // skipping the padding after the last frame
+    PS_FOOTER,        // collecting (and ignoring) the id3v2.4.0 footer
+    PS_DONE
+  };
+
+  size_t frameHeaderSize(ID3_V2Spec spec)
+  {
+    ID3_FrameHeader hdr;
+    hdr.SetSpec(spec);
+    return hdr.Size();
+  }
+
+  // ID3_FrameHeader::Parse wants to see at least 10 bytes, even for the
+  // 6 byte headers of id3v2.2.  The bytes added here are never parsed.
+  BString padded(const BString& data)
+  {
+    BString copy(data);
+    if (copy.size() < ID3_TagHeader::SIZE)
+    {
+      copy.resize(ID3_TagHeader::SIZE, '\0');
+    }
+    return copy;
+  }
+}
+
+/** \class ID3_PushParser push_parser.h id3/push_parser.h
+ ** \brief Parses an id3v2 tag from chunks of data, as they come in.
+ **
+ ** Where ID3_Tag::Link() pulls the data it needs from an ID3_Reader, the
+ ** push parser is handed the data by the caller with Feed(), in chunks of
+ ** any size.  This suits event loops, which can't block on a reader.  Every
+ ** frame is passed to the Handler as soon as its last byte has arrived, and
+ ** only one frame is buffered at a time, never the whole tag.
+ **
+ ** Unsynchronisation (of the whole tag, or of a single id3v2.4.0 frame) and
+ ** compressed frames are dealt with as ID3_Tag does.  The frame passed to
+ ** Handler::OnFrame() is only valid during the call; copy it to keep it.
+ **
+ ** \code
+ **   class MyHandler : public ID3_PushParser::Handler
+ **   {
+ **   public:
+ **     ID3_Tag tag;
+ **     void OnFrame(const ID3_Frame& frame) { tag.AddFrame(frame); }
+ **   };
+ **
+ **   MyHandler handler;
+ **   ID3_PushParser parser(handler);
+ **   while (!parser.IsDone() && (len = recv(sock, buf, sizeof(buf), 0)) > 0)
+ **   {
+ **     size_t used = parser.Feed(buf, len);
+ **     // buf + used, len - used is the beginning of the audio
+ **   }
+ ** \endcode
+ **/
+ID3_PushParser::ID3_PushParser(Handler& handler)
+  : _handler(handler)
+{
+  this->Reset();
+}
+
+/** Forgets about the tag parsed so far, so that a new one can be fed. */
+void ID3_PushParser::Reset()
+{
+  _state = PS_HEADER;
+  _buffer.erase();
+  _needed = ID3_TagHeader::SIZE;
+  _remaining = 0;
+  _tag_size = 0;
+  _spec = ID3V2_UNKNOWN;
+  _unsync = false;
+  _footer = false;
+  _last_ff = false;
+}
+
+/** Returns true once the whole tag has been parsed, or as soon as the data
+ ** turned out not to begin with an id3v2 tag (see HasTag()).
+ **/
+bool ID3_PushParser::IsDone() const
+{
+  return _state == PS_DONE;
+}
+
+/** Parses the next len bytes of data.  Returns the number of bytes that
+ ** belong to the tag, which is less than len only for the chunk holding the
+ ** end of the tag: the bytes after the tag are left for the caller.  When the
+ ** data doesn't begin with an id3v2 tag, the first ID3_TagHeader::SIZE
+ ** bytes are consumed before that can be known.
+ **/
+size_t ID3_PushParser::Feed(const uchar* data, size_t len)
+{
+  size_t used = 0;
+  while (used < len && _state != PS_DONE)
+  {
+    if (_state == PS_HEADER || _state == PS_FOOTER)
+    {
+      // not part of the (possibly unsynchronised) frame data
+      size_t size = min(_needed - _buffer.size(), len - used);
+      _buffer.append(data + used, size);
+      used += size;
+    }
+    else if (_state == PS_PADDING)
+    {
+      size_t size = min(_remaining, len - used);
+      _remaining -= size;
+      used += size;
+    }
+    else
+    {
+      used += this->FeedBody(data + used, len - used);
+      if (_state == PS_FRAMEHEADER && !_buffer.empty() && _buffer[0] == '\0')
+      {
+        ID3D_NOTICE( "ID3_PushParser::Feed(): padding" );
+        _buffer.erase();
+        _state = PS_PADDING;
+      }
+    }
+
+    while (_state != PS_PADDING && _state != PS_DONE &&
+           _buffer.size() == _needed)
+    {
+      this->Advance();
+    }
+    if (_remaining == 0 && _state != PS_HEADER && _state != PS_FOOTER &&
+        _state != PS_DONE)
+    {
+      this->EndOfFrames();
+    }
+  }
+  return used;
+}
+
+// Adds the frame data to the buffer, resynchronising it when needed
+size_t ID3_PushParser::FeedBody(const uchar* data, size_t len)
+{
+  size_t used = 0;
+  if (!_unsync)
+  {
+    used = min(min(len, _remaining), _needed - _buffer.size());
+    _buffer.append(data, used);
+    _remaining -= used;
+    return used;
+  }
+  while (used < len && _remaining > 0 && _buffer.size() < _needed)
+  {
+    uchar ch = data[used++];
+    --_remaining;
+    if (!_last_ff || ch != '\0')
+    {
+      _buffer += ch;
+    }
+    _last_ff = (ch == 0xFF);
+  }
+  return used;
+}
+
+// The buffer holds all that is needed for the current state: parse it and
+// move on to the next one
+void ID3_PushParser::Advance()
+{
+  io::BStringReader reader(_buffer);
+  switch (_state)
+  {
+    case PS_HEADER:
+    {
+      ID3_TagHeader hdr;
+      if (!hdr.Parse(reader))
+      {
+        ID3D_NOTICE( "ID3_PushParser::Advance(): not an id3v2 tag" );
+        _state = PS_DONE;
+        break;
+      }
+      _spec = hdr.GetSpec();
+      _remaining = hdr.GetDataSize();
+      // id3v2.4.0 tags are unsynchronised frame by frame, if at all
+      _unsync = hdr.GetUnsync() && _spec != ID3V2_4_0;
+      _footer = hdr.GetFooter() && _spec == ID3V2_4_0;
+      _tag_size = ID3_TagHeader::SIZE + _remaining +
+                  (_footer ? ID3_TagHeader::SIZE : 0);
+      _buffer.erase();
+      _handler.OnTagHeader(_spec, _tag_size);
+      if (ID3V2_UNKNOWN == _spec)
+      {
+        ID3D_WARNING( "ID3_PushParser::Advance(): unknown version, skipping tag" );
+        _state = PS_PADDING;
+      }
+      else if (hdr.GetExtended())
+      {
+        _state = PS_EXTSIZE;
+        _needed = 4;
+      }
+      else
+      {
+        _state = PS_FRAMEHEADER;
+        _needed = frameHeaderSize(_spec);
+      }
+      break;
+    }
+    case PS_EXTSIZE:
+    {
+      // id3v2.4.0 counts the size itself, id3v2.3.0 doesn't
+      size_t size = (_spec == ID3V2_4_0) ? io::readUInt28(reader)
+                                         : io::readBENumber(reader, 4) + 4;
+      if (size <= _needed || size - _needed > _remaining)
+      {
+        ID3D_WARNING( "ID3_PushParser::Advance(): bad extended header size" );
+        _buffer.erase();
+        _state = PS_PADDING;
+        break;
+      }
+      _state = PS_EXTENDED;
+      _needed = size;
+      break;
+    }
+    case PS_EXTENDED:
+    {
+      _buffer.erase();
+      _state = PS_FRAMEHEADER;
+      _needed = frameHeaderSize(_spec);
+      break;
+    }
+    case PS_FRAMEHEADER:
+    {
+      BString data = padded(_buffer);
+      io::BStringReader hr(data);
+      ID3_FrameHeader hdr;
+      hdr.SetSpec(_spec);
+      if (!hdr.Parse(hr))
+      {
+        ID3D_WARNING( "ID3_PushParser::Advance(): bad frame header" );
+        _buffer.erase();
+        _state = PS_PADDING;
+        break;
+      }
+      _state = PS_FRAME;
+      _needed = hdr.Size() + hdr.GetDataSize();
+      break;
+    }
+    case PS_FRAME:
+    {
+      BString data = padded(_buffer);
+      io::BStringReader fr(data);
+      ID3_Frame frame;
+      frame.SetSpec(_spec);
+      if (!frame.Parse(fr))
+      {
+        ID3D_WARNING( "ID3_PushParser::Advance(): bad parse, skipping frame" );
+      }
+      else if (frame.GetID() != ID3FID_SEEKFRAME)
+      {
+        _handler.OnFrame(frame);
+      }
+      _buffer.erase();
+      _state = PS_FRAMEHEADER;
+      _needed = frameHeaderSize(_spec);
+      break;
+    }
+    case PS_FOOTER:
+    {
+      _buffer.erase();
+      _state = PS_DONE;
+      _handler.OnTagEnd();
+      break;
+    }
+  }
+}
+
+// All of the frame data has been fed
+void ID3_PushParser::EndOfFrames()
+{
+  if (_state == PS_FRAME || _state == PS_EXTENDED)
+  {
+    ID3D_WARNING( "ID3_PushParser::EndOfFrames(): tag ends inside a frame" );
+  }
+  _buffer.erase();
+  if (_footer)
+  {
+    _state = PS_FOOTER;
+    _needed = ID3_TagHeader::SIZE;
+  }
+  else
+  {
+    _state = PS_DONE;
+    _handler.OnTagEnd();
+  }
+}
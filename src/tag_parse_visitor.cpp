@@ -0,0 +1,378 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#if defined HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include "id3/frame_visitor.h"
+#include "id3/readers.h"
+#include "id3/utils.h"
+#include "header_tag.h"
+#include "header_frame.h"
+#include "frame_def.h"
+#include "field_def.h"
+#include "zlib.h"
+
+using namespace dami;
+
+namespace
+{
+  // the same test as ID3_FieldImpl::InScope
+  bool inScope(const ID3_FieldDef& def, ID3_V2Spec spec)
+  {
+    return def._spec_begin <= spec &&
+           (spec <= def._spec_end || ID3V2_LATEST == def._spec_end);
+  }
+
+  uint32 bigEndian(const uchar* data, size_t len)
+  {
+    uint32 val = 0;
+    for (size_t i = 0; i < len; ++i)
+    {
+      val = (val << 8) | data[i];
+    }
+    return val;
+  }
+
+  uint32 syncSafe(const uchar* data)
+  {
+    uint32 val = 0;
+    for (size_t i = 0; i < 4; ++i)
+    {
+      val = (val << 7) | (data[i] & 0x7F);
+    }
+    return val;
+  }
+
+  // Undoes unsynchronisation in place, returns the new size
+  size_t resync(uchar* data, size_t size)
+  {
+    size_t out = 0;
+    for (size_t in = 0; in < size; ++in)
+    {
+      data[out++] = data[in];
+      if (data[in] == 0xFF && in + 1 < size && data[in + 1] == 0x00)
+      {
+        ++in;
+      }
+    }
+    return out;
+  }
+
+  // Returns the length of the string at data, up to (not including) its
+  // terminator, and the size of that terminator in term
+  size_t stringLength(const uchar* data, const uchar* end, ID3_TextEnc enc,
+                      size_t& term)
+  {
+    term = 0;
+    if (ID3TE_IS_DOUBLE_BYTE_ENC(enc))
+    {
+      const uchar* cur = data;
+      for (; cur + 1 < end; cur += 2)
+      {
+        if (cur[0] == '\0' && cur[1] == '\0')
+        {
+          term = 2;
+          return cur - data;
+        }
+      }
+      return end - data;
+    }
+    const uchar* nul = static_cast<const uchar*>(memchr(data, '\0', end - data));
+    if (nul == NULL)
+    {
+      return end - data;
+    }
+    term = 1;
+    return nul - data;
+  }
+
+  // Walks the fields of a frame the way parseFields() and the
+  // ID3_FieldImpl::Parse*() methods do, without creating any of them
+  void visitFields(ID3_FrameVisitor& visitor, const ID3_FieldDef* defs,
+                   ID3_V2Spec spec, const uchar* cur, const uchar* end)
+  {
+    ID3_TextEnc enc = ID3TE_ASCII;
+    for (const ID3_FieldDef* def = defs; def->_id != ID3FN_NOFIELD; ++def)
+    {
+      if (!inScope(*def, spec))
+      {
+        continue;
+      }
+      if (cur >= end)
+      {
+        break;
+      }
+      size_t left = end - cur;
+      switch (def->_type)
+      {
+        case ID3FTY_INTEGER:
+        {
+          size_t len = min<size_t>(def->_fixed_size > 0 ? def->_fixed_size : sizeof(uint32), left);
+          uint32 val = bigEndian(cur, len);
+          visitor.VisitInteger(def->_id, val);
+          if (def->_id == ID3FN_TEXTENC)
+          {
+            enc = static_cast<ID3_TextEnc>(val);
+          }
+          cur += len;
+          break;
+        }
+        case ID3FTY_TEXTSTRING:
+        {
+          // as ID3_FieldImpl::SetEncoding(), only encodable fields take the
+          // encoding of the frame; mime types, urls and the like are ascii
+          const ID3_TextEnc fenc = (def->_flags & ID3FF_ENCODABLE) ? enc : ID3TE_ASCII;
+          size_t term = 0;
+          if (def->_fixed_size > 0)
+          {
+            size_t len = min(def->_fixed_size, left);
+            visitor.VisitText(def->_id, fenc, cur, len);
+            cur += len;
+          }
+          else if (def->_flags & ID3FF_LIST)
+          {
+            // lists are always the last field in a frame
+            while (cur < end)
+            {
+              size_t len = stringLength(cur, end, fenc, term);
+              visitor.VisitText(def->_id, fenc, cur, len);
+              cur += len + term;
+            }
+          }
+          else if (def->_flags & ID3FF_CSTR)
+          {
+            size_t len = stringLength(cur, end, fenc, term);
+            visitor.VisitText(def->_id, fenc, cur, len);
+            cur += len + term;
+          }
+          else
+          {
+            visitor.VisitText(def->_id, fenc, cur, left);
+            cur = end;
+          }
+          break;
+        }
+        default:
+        {
+          // binary fields take whatever is left
+          visitor.VisitBinary(def->_id, cur, left);
+          cur = end;
+          break;
+        }
+      }
+    }
+  }
+
+  size_t readAll(ID3_Reader& reader, uchar* buf, size_t len)
+  {
+    size_t total = 0;
+    while (total < len)
+    {
+      size_t numRead = reader.readChars(buf + total, len - total);
+      if (numRead == 0)
+      {
+        break;
+      }
+      total += numRead;
+    }
+    return total;
+  }
+}
+
+/** \class ID3_FrameVisitor frame_visitor.h id3/frame_visitor.h
+ ** \brief Receives the frames of an id3v2 tag, without the object model.
+ **
+ ** ID3_VisitFrames() parses an id3v2 tag much like ID3_Tag::Link() does,
+ ** using the same frame and field definitions, but creates no ID3_Frame
+ ** or ID3_Field objects.  Instead, a visitor is called for every frame and
+ ** every field in it.  Integer fields are decoded; text and binary fields
+ ** are passed as a span of raw bytes, which is only valid during the call.
+ ** A text span holds a single string without its terminator (a text list
+ ** is visited string by string), in the encoding passed along with it.
+ **
+ ** Applications that only count frames or want a couple of strings from
+ ** many files save the allocation and construction of the whole tag.
+ **
+ ** \code
+ **   class FrameCounter : public ID3_FrameVisitor
+ **   {
+ **   public:
+ **     std::map<std::string, size_t> counts;
+ **     bool VisitFrame(ID3_FrameID, const char* textID, flags_t)
+ **     {
+ **       ++counts[textID];
+ **       return false; // not interested in the fields
+ **     }
+ **   };
+ ** \endcode
+ **
+ ** VisitFrame() is called first for each frame, with its id, text id and
+ ** FRAME_* flags.  When it returns true the fields are visited, followed by
+ ** EndFrame().  Encrypted frames can't be decoded: their data is passed as
+ ** a single ID3FN_DATA binary span.
+ **/
+
+/** Visits the frames of the id3v2 tag the reader is positioned at.  Only
+ ** readChars() is used, so this works for pipes, too.  The whole tag is read
+ ** into a single buffer.  Returns the size of the tag, 0 if there is none.
+ **/
+size_t ID3_VisitFrames(ID3_Reader& reader, ID3_FrameVisitor& visitor)
+{
+  const size_t HEADER = ID3_TagHeader::SIZE;
+  uchar header[HEADER];
+  if (readAll(reader, header, HEADER) < HEADER)
+  {
+    return 0;
+  }
+  ID3_MemoryReader mr(header, HEADER);
+  ID3_TagHeader hdr;
+  if (!hdr.Parse(mr))
+  {
+    return 0;
+  }
+  const ID3_V2Spec spec = hdr.GetSpec();
+  const bool footer = hdr.GetFooter() && spec == ID3V2_4_0;
+  size_t tagSize = HEADER + hdr.GetDataSize() + (footer ? HEADER : 0);
+
+  if (hdr.GetDataSize() == 0)
+  {
+    return tagSize;
+  }
+  BString data(hdr.GetDataSize(), '\0');
+  uchar* cur = &data[0];
+  uchar* end = cur + readAll(reader, cur, data.size());
+  if (footer)
+  {
+    readAll(reader, header, HEADER);
+  }
+  if (ID3V2_UNKNOWN == spec)
+  {
+    ID3D_WARNING( "ID3_VisitFrames(): unknown version" );
+    return tagSize;
+  }
+  // id3v2.4.0 tags are unsynchronised frame by frame, if at all
+  if (hdr.GetUnsync() && spec != ID3V2_4_0)
+  {
+    end = cur + resync(cur, end - cur);
+  }
+  if (hdr.GetExtended() && end - cur >= 4)
+  {
+    // id3v2.4.0 counts the size itself, id3v2.3.0 doesn't
+    size_t extSize = (spec == ID3V2_4_0) ? syncSafe(cur) : bigEndian(cur, 4) + 4;
+    cur += min<size_t>(extSize, end - cur);
+  }
+
+  while (cur < end && *cur != '\0')
+  {
+    ID3_MemoryReader fr(cur, end - cur);
+    ID3_FrameHeader fhdr;
+    fhdr.SetSpec(spec);
+    if (!fhdr.Parse(fr) || fhdr.GetDataSize() > size_t(end - cur) - fhdr.Size())
+    {
+      ID3D_WARNING( "ID3_VisitFrames(): bad frame header" );
+      break;
+    }
+    uchar* beg = cur + fhdr.Size();
+    uchar* last = beg + fhdr.GetDataSize();
+    cur = last;
+
+    ID3_FrameID id = fhdr.GetFrameID();
+    if (ID3FID_SEEKFRAME == id)
+    {
+      continue;
+    }
+    flags_t flags =
+      (fhdr.GetCompression() ? ID3_FrameVisitor::FRAME_COMPRESSED : 0) |
+      (fhdr.GetEncryption()  ? ID3_FrameVisitor::FRAME_ENCRYPTED  : 0) |
+      (fhdr.GetGrouping()    ? ID3_FrameVisitor::FRAME_GROUPED    : 0) |
+      (fhdr.GetUnsync()      ? ID3_FrameVisitor::FRAME_UNSYNCED   : 0) |
+      (fhdr.GetReadOnly()    ? ID3_FrameVisitor::FRAME_READONLY   : 0);
+    if (!visitor.VisitFrame(id, fhdr.GetTextID(), flags))
+    {
+      continue;
+    }
+
+    // the extra bytes in front of the data, as in ID3_FrameImpl::Parse
+    size_t extra = 0;
+    size_t origSize = 0;
+    if (spec == ID3V2_4_0)
+    {
+      extra += fhdr.GetGrouping() ? 1 : 0;
+      extra += fhdr.GetEncryption() ? 1 : 0;
+      if (fhdr.GetDataLength() && size_t(last - beg) >= extra + 4)
+      {
+        origSize = syncSafe(beg + extra);
+        extra += 4;
+      }
+    }
+    else
+    {
+      if (fhdr.GetCompression() && last - beg >= 4)
+      {
+        origSize = bigEndian(beg, 4);
+        extra += 4;
+      }
+      extra += fhdr.GetEncryption() ? 1 : 0;
+      extra += fhdr.GetGrouping() ? 1 : 0;
+    }
+    beg += min<size_t>(extra, last - beg);
+    if (fhdr.GetUnsync())
+    {
+      last = beg + resync(beg, last - beg);
+    }
+
+    const ID3_FrameDef* def = fhdr.GetFrameDef();
+    const ID3_FieldDef* fields = def ? def->aeFieldDefs : ID3_FieldDef::DEFAULT;
+    if (fhdr.GetEncryption())
+    {
+      visitor.VisitBinary(ID3FN_DATA, beg, last - beg);
+    }
+    else if (fhdr.GetCompression())
+    {
+      BString inflated(origSize, '\0');
+      uLongf size = origSize;
+      if (origSize > 0 &&
+          ::uncompress(&inflated[0], &size, beg, last - beg) == Z_OK)
+      {
+        visitFields(visitor, fields, spec, &inflated[0], &inflated[0] + size);
+      }
+      else
+      {
+        ID3D_WARNING( "ID3_VisitFrames(): can't uncompress frame" );
+      }
+    }
+    else
+    {
+      visitFields(visitor, fields, spec, beg, last);
+    }
+    visitor.EndFrame();
+  }
+  return tagSize;
+}
@@ -32,6 +32,7 @@
 #include "id3/io_decorators.h" //has "readers.h" "io_helpers.h" "utils.h"
 #include "io_helpers.h"
 #include "io_strings.h"
+#include "stats.h"
 
 #if defined HAVE_SYS_PARAM_H
 #include <sys/param.h>
@@ -69,14 +70,19 @@ namespace
   {
     for (ID3_TagImpl::const_iterator iter = tag.begin(); iter != tag.end(); ++iter)
     {
-      const ID3_Frame* frame = *iter;
-      if (frame) frame->Render(writer);
+      ID3_Frame* frame = *iter;
+      if (frame)
+      {
+        frame->SetSpec(tag.GetSpec());
+        frame->Render(writer);
+      }
     }
   }
 }
 
 void id3::v2::render(ID3_Writer& writer, const ID3_TagImpl& tag)
 {
+  ID3_STATS_TIMER(RENDER);
   // There has to be at least one frame for there to be a tag...
   if (tag.NumFrames() == 0)
   {
@@ -89,14 +95,17 @@ void id3::v2::render(ID3_Writer& writer, const ID3_TagImpl& tag)
   hdr.SetSpec(tag.GetSpec());
   hdr.SetExtended(tag.GetExtended());
   hdr.SetExperimental(tag.GetExperimental());
-  hdr.SetFooter(tag.GetFooter());
+  // only id3v2.4.0 knows about footers
+  hdr.SetFooter(tag.GetFooter() && tag.GetSpec() == ID3V2_4_0);
     
   // set up the encryption and grouping IDs
 
   // ...
   String frms;
   io::StringWriter frmWriter(frms);
-  if (!tag.GetUnsync())
+  // id3v2.4.0 unsynchronises frame by frame; we don't unsync those at all,
+  // since unsynchronisation only ever mattered for pre-id3v2 players
+  if (!tag.GetUnsync() || tag.GetSpec() == ID3V2_4_0)
   {
     ID3D_NOTICE( "id3::v2::render(): rendering frames" );
     renderFrames(frmWriter, tag);
@@ -104,6 +113,7 @@ void id3::v2::render(ID3_Writer& writer, const ID3_TagImpl& tag)
   }
   else
   {
+    ID3_STATS_TIMER(UNSYNC);
     ID3D_NOTICE( "id3::v2::render(): rendering unsynced frames" );
     io::UnsyncedWriter uw(frmWriter);
     renderFrames(uw, tag);
@@ -118,8 +128,9 @@ void id3::v2::render(ID3_Writer& writer, const ID3_TagImpl& tag)
     return;
   }
   
-  // zero the remainder of the buffer so that our padding bytes are zero
-  luint nPadding = tag.PaddingSize(frmSize);
+  // zero the remainder of the buffer so that our padding bytes are zero.  A
+  // tag with a footer must not be padded.
+  luint nPadding = hdr.GetFooter() ? 0 : tag.PaddingSize(frmSize);
   ID3D_NOTICE( "id3::v2::render(): padding size = " << nPadding );
   
   hdr.SetDataSize(frmSize + tag.GetExtendedBytes() + nPadding);
@@ -135,6 +146,11 @@ void id3::v2::render(ID3_Writer& writer, const ID3_TagImpl& tag)
       break;
     }
   }
+
+  if (hdr.GetFooter())
+  {
+    hdr.RenderFooter(writer);
+  }
 }
 
 size_t ID3_TagImpl::Size() const
@@ -170,7 +186,14 @@ size_t ID3_TagImpl::Size() const
     bytesUsed += bytesUsed / 3;
   }
     
-  bytesUsed += this->PaddingSize(bytesUsed);
+  if (this->GetFooter() && this->GetSpec() == ID3V2_4_0)
+  {
+    bytesUsed += ID3_TagHeader::SIZE;
+  }
+  else
+  {
+    bytesUsed += this->PaddingSize(bytesUsed);
+  }
   return bytesUsed;
 }
 
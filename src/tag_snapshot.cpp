@@ -0,0 +1,592 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#if defined HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include "id3/tag_snapshot.h"
+#include "id3/tag.h"
+#include "id3/readers.h"
+#include "id3/writer.h"
+#include "id3/frame_visitor.h"
+#include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
+#include "field_impl.h"
+
+using namespace dami;
+
+namespace
+{
+  // The header of a snapshot, followed by the offset of each frame
+  enum
+  {
+    H_MAGIC     = 0,
+    H_ORDER     = 4,    // ORDER_MARK, as the machine that wrote it saw it
+    H_VERSION   = 8,
+    H_SIZE      = 12,
+    H_TAGS      = 16,
+    H_SPEC      = 20,
+    H_PREPENDED = 24,
+    H_APPENDED  = 28,
+    H_FRAMES    = 32,
+    SNAPSHOT_HEADER = 36
+  };
+
+  // A frame, followed by the offset of each of its fields from the start of
+  // the frame
+  enum
+  {
+    F_ID        = 0,
+    F_SIZE      = 4,
+    F_FLAGS     = 8,    // ID3_FrameVisitor::FRAME_*
+    F_TEXTID    = 12,   // nul terminated
+    F_CRYPT     = 20,
+    F_GROUP     = 21,
+    F_FIELDS    = 24,
+    FRAME_HEADER = 28
+  };
+
+  // A field, followed by its text or binary data
+  enum
+  {
+    D_ID        = 0,
+    D_TYPE      = 4,
+    D_ENC       = 8,
+    D_VALUE     = 12,   // the integer, or the number of text items
+    D_SIZE      = 16,
+    FIELD_HEADER = 20
+  };
+
+  const uchar SNAPSHOT_MAGIC[4] = { 'I', 'D', '3', 'S' };
+  const uint32 ORDER_MARK = 0x01020304;
+  const size_t TEXTID_SIZE = 8;
+
+  inline uint32 get32(const uchar* data)
+  {
+    uint32 val;
+    ::memcpy(&val, data, sizeof(val));
+    return val;
+  }
+
+  inline void put32(BString& data, size_t pos, uint32 val)
+  {
+    ::memcpy(&data[pos], &val, sizeof(val));
+  }
+
+  inline void pad(BString& data)
+  {
+    data.append((4 - data.size() % 4) % 4, static_cast<uchar>(0));
+  }
+
+  // Checks a frame, so that the accessors needn't.  Its offset is known to
+  // be aligned and leave room for its header.
+  bool isFrame(const uchar* data, size_t size, size_t offset)
+  {
+    const uchar* frame = data + offset;
+    const size_t frameSize = get32(frame + F_SIZE);
+    const size_t fields = get32(frame + F_FIELDS);
+    if (frameSize > size - offset || frameSize < FRAME_HEADER ||
+        fields > (frameSize - FRAME_HEADER) / 4 ||
+        frame[F_TEXTID + TEXTID_SIZE - 1] != '\0')
+    {
+      return false;
+    }
+    for (size_t i = 0; i < fields; ++i)
+    {
+      const size_t field = get32(frame + FRAME_HEADER + 4 * i);
+      if (field % 4 != 0 || field < FRAME_HEADER + 4 * fields ||
+          field > frameSize - FIELD_HEADER ||
+          get32(frame + field + D_SIZE) > frameSize - field - FIELD_HEADER)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void writeField(BString& out, const ID3_Field& field)
+  {
+    const size_t beg = out.size();
+    out.append(FIELD_HEADER, static_cast<uchar>(0));
+    put32(out, beg + D_ID, field.GetID());
+    put32(out, beg + D_TYPE, field.GetType());
+    put32(out, beg + D_ENC, field.GetEncoding());
+    switch (field.GetType())
+    {
+      case ID3FTY_INTEGER:
+      {
+        put32(out, beg + D_VALUE, field.Get());
+        break;
+      }
+      case ID3FTY_TEXTSTRING:
+      {
+        // as the field keeps it, so that reading it back is a copy
+        const String text = static_cast<const ID3_FieldImpl&>(field).GetText();
+        put32(out, beg + D_VALUE, field.GetNumTextItems());
+        put32(out, beg + D_SIZE, text.size());
+        out.append(reinterpret_cast<const uchar*>(text.data()), text.size());
+        break;
+      }
+      default:
+      {
+        const size_t size = field.Size();
+        put32(out, beg + D_SIZE, size);
+        if (size > 0)
+        {
+          out.append(field.GetRawBinary(), size);
+        }
+        break;
+      }
+    }
+    pad(out);
+  }
+
+  void writeFrame(BString& out, const ID3_Frame& frame)
+  {
+    const size_t beg = out.size();
+    const size_t fields = frame.NumFields();
+    out.append(FRAME_HEADER + 4 * fields, static_cast<uchar>(0));
+    put32(out, beg + F_ID, frame.GetID());
+    flags_t flags = 0;
+    if (frame.GetCompression())
+    {
+      flags |= ID3_FrameVisitor::FRAME_COMPRESSED;
+    }
+    if (frame.GetEncryptionID())
+    {
+      flags |= ID3_FrameVisitor::FRAME_ENCRYPTED;
+      out[beg + F_CRYPT] = frame.GetEncryptionID();
+    }
+    if (frame.GetGroupingID())
+    {
+      flags |= ID3_FrameVisitor::FRAME_GROUPED;
+      out[beg + F_GROUP] = frame.GetGroupingID();
+    }
+    put32(out, beg + F_FLAGS, flags);
+    const char* textID = frame.GetTextID();
+    if (textID)
+    {
+      ::memcpy(&out[beg + F_TEXTID], textID,
+               min<size_t>(::strlen(textID), TEXTID_SIZE - 1));
+    }
+
+    ID3_Frame::ConstIterator* iter = frame.CreateIterator();
+    size_t n = 0;
+    for (const ID3_Field* field; n < fields && (field = iter->GetNext()) != NULL; ++n)
+    {
+      put32(out, beg + FRAME_HEADER + 4 * n, out.size() - beg);
+      writeField(out, *field);
+    }
+    delete iter;
+    put32(out, beg + F_FIELDS, n);
+    put32(out, beg + F_SIZE, out.size() - beg);
+  }
+
+  // A frame id3lib doesn't know is kept as it was read: its data is parsed
+  // back as an id3v2.3 frame, or an id3v2.2 one for a three letter id
+  ID3_Frame* readUnknownFrame(const ID3_TagSnapshot& snapshot, size_t i)
+  {
+    const String textID = snapshot.GetTextID(i);
+    if (textID.size() != 3 && textID.size() != 4)
+    {
+      return NULL;
+    }
+    size_t size = 0;
+    const uchar* data = snapshot.GetRawData(i, snapshot.FindField(i, ID3FN_DATA), size);
+    const bool v22 = textID.size() == 3;
+    BString raw(reinterpret_cast<const uchar*>(textID.data()), textID.size());
+    for (int shift = v22 ? 16 : 24; shift >= 0; shift -= 8)
+    {
+      raw += static_cast<uchar>(size >> shift);
+    }
+    if (!v22)
+    {
+      raw.append(2, static_cast<uchar>(0));
+    }
+    if (size > 0)
+    {
+      raw.append(data, size);
+    }
+
+    ID3_Frame* frame = new ID3_Frame;
+    frame->SetSpec(v22 ? ID3V2_2_0 : ID3V2_3_0);
+    ID3_MemoryReader mr(raw.data(), raw.size());
+    if (!frame->Parse(mr))
+    {
+      delete frame;
+      frame = NULL;
+    }
+    return frame;
+  }
+
+  ID3_Frame* readFrame(const ID3_TagSnapshot& snapshot, size_t i)
+  {
+    const ID3_FrameID id = snapshot.GetFrameID(i);
+    if (id == ID3FID_NOFRAME)
+    {
+      return readUnknownFrame(snapshot, i);
+    }
+    ID3_Frame* frame = new ID3_Frame(id);
+    ID3_Frame::Iterator* iter = frame->CreateIterator();
+    for (ID3_Field* field; (field = iter->GetNext()) != NULL; )
+    {
+      const size_t n = snapshot.FindField(i, field->GetID());
+      if (n >= snapshot.NumFields(i) ||
+          snapshot.GetFieldType(i, n) != field->GetType())
+      {
+        continue;
+      }
+      size_t size = 0;
+      const uchar* data = snapshot.GetRawData(i, n, size);
+      switch (field->GetType())
+      {
+        case ID3FTY_INTEGER:
+        {
+          field->Set(snapshot.GetInteger(i, n));
+          break;
+        }
+        case ID3FTY_TEXTSTRING:
+        {
+          static_cast<ID3_FieldImpl*>(field)->SetRawText(
+            String(reinterpret_cast<const char*>(data), size),
+            snapshot.GetEncoding(i, n), snapshot.GetNumTextItems(i, n));
+          break;
+        }
+        default:
+        {
+          field->Set(data, size);
+          break;
+        }
+      }
+    }
+    delete iter;
+
+    const flags_t flags = snapshot.GetFrameFlags(i);
+    frame->SetCompression((flags & ID3_FrameVisitor::FRAME_COMPRESSED) != 0);
+    if (flags & ID3_FrameVisitor::FRAME_ENCRYPTED)
+    {
+      frame->SetEncryptionID(snapshot.GetEncryptionID(i));
+    }
+    if (flags & ID3_FrameVisitor::FRAME_GROUPED)
+    {
+      frame->SetGroupingID(snapshot.GetGroupingID(i));
+    }
+    return frame;
+  }
+}
+
+/** \class ID3_TagSnapshot tag_snapshot.h id3/tag_snapshot.h
+ ** \brief A copy of a tag's frames in one flat block of memory.
+ **
+ ** Write() lays out the frames of a tag, and what Link() found about the
+ ** file, in a single block: frame and field ids as integers, each value
+ ** with its length, and offsets instead of pointers.  The block can be
+ ** passed to another process or kept in shared memory.  Read() builds the
+ ** frames again; a snapshot is much cheaper to read than an id3v2 tag is to
+ ** parse, for the fields are copied as they are.
+ **
+ ** An ID3_TagSnapshot also reads a snapshot where it lies, without creating
+ ** any ID3_Frame: Open() checks the whole block once, after which frames
+ ** and fields are looked at by number.  The data isn't copied, so it has to
+ ** outlive the snapshot.
+ **
+ ** \code
+ **   BString data;
+ **   io::BStringWriter writer(data);
+ **   ID3_TagSnapshot::Write(myTag, writer);
+ **   // ... send it ...
+ **   ID3_TagSnapshot snapshot(data.data(), data.size());
+ **   size_t frame = snapshot.FindFrame(ID3FID_TITLE);
+ **   size_t field = snapshot.FindField(frame, ID3FN_TEXT);
+ **   size_t size;
+ **   const uchar* title = snapshot.GetRawData(frame, field, size);
+ ** \endcode
+ **
+ ** Text is kept in the encoding of its field and as id3lib keeps it, items
+ ** separated by a null character; unicode text is in the byte order of the
+ ** machine that wrote it.  Numbers are in that byte order, too: a snapshot
+ ** is meant for the processes of one machine, and Open() refuses one from
+ ** a machine with another byte order.  Find*() return NumFrames() or
+ ** NumFields() when there's nothing to find.
+ **/
+ID3_TagSnapshot::ID3_TagSnapshot()
+  : _data(NULL), _size(0)
+{
+}
+
+ID3_TagSnapshot::ID3_TagSnapshot(const uchar* data, size_t size)
+  : _data(NULL), _size(0)
+{
+  this->Open(data, size);
+}
+
+/** Writes a snapshot of the tag, returns its size. */
+size_t ID3_TagSnapshot::Write(const ID3_Tag& tag, ID3_Writer& writer)
+{
+  BString out(SNAPSHOT_HEADER + 4 * tag.NumFrames(), static_cast<uchar>(0));
+  ::memcpy(&out[H_MAGIC], SNAPSHOT_MAGIC, 4);
+  put32(out, H_ORDER, ORDER_MARK);
+  put32(out, H_VERSION, SNAPSHOT_VERSION);
+  flags_t tags = 0;
+  for (flags_t tt = ID3TT_ID3V1; tt <= ID3TT_ID3V2APPENDED; tt <<= 1)
+  {
+    if (tag.HasTagType(static_cast<ID3_TagType>(tt)))
+    {
+      tags |= tt;
+    }
+  }
+  put32(out, H_TAGS, tags);
+  put32(out, H_SPEC, tag.GetSpec());
+  put32(out, H_PREPENDED, tag.GetPrependedBytes());
+  put32(out, H_APPENDED, tag.GetAppendedBytes());
+
+  ID3_Tag::ConstIterator* iter = tag.CreateIterator();
+  size_t n = 0;
+  for (const ID3_Frame* frame; n < tag.NumFrames() && (frame = iter->GetNext()) != NULL; ++n)
+  {
+    put32(out, SNAPSHOT_HEADER + 4 * n, out.size());
+    writeFrame(out, *frame);
+  }
+  delete iter;
+  put32(out, H_FRAMES, n);
+  put32(out, H_SIZE, out.size());
+  return writer.writeChars(out.data(), out.size());
+}
+
+/** Adds the frames of a snapshot to the tag, and sets its spec.  Returns
+ ** false if the data isn't a snapshot.
+ **/
+bool ID3_TagSnapshot::Read(ID3_Tag& tag, const uchar* data, size_t size)
+{
+  ID3_TagSnapshot snapshot(data, size);
+  if (!snapshot.IsValid())
+  {
+    return false;
+  }
+  tag.SetSpec(snapshot.GetSpec());
+  for (size_t i = 0; i < snapshot.NumFrames(); ++i)
+  {
+    ID3_Frame* frame = readFrame(snapshot, i);
+    if (frame)
+    {
+      tag.AttachFrame(frame);
+    }
+  }
+  return true;
+}
+
+/** Checks the snapshot at data and reads it from there on.  Returns false
+ ** if it isn't one.
+ **/
+bool ID3_TagSnapshot::Open(const uchar* data, size_t size)
+{
+  _data = NULL;
+  _size = 0;
+  if (data == NULL || size < SNAPSHOT_HEADER ||
+      ::memcmp(data + H_MAGIC, SNAPSHOT_MAGIC, 4) != 0 ||
+      get32(data + H_ORDER) != ORDER_MARK)
+  {
+    return false;
+  }
+  if (get32(data + H_VERSION) != SNAPSHOT_VERSION)
+  {
+    ID3D_WARNING( "ID3_TagSnapshot::Open(): unknown version" );
+    return false;
+  }
+  const size_t total = get32(data + H_SIZE);
+  const size_t frames = get32(data + H_FRAMES);
+  if (total > size || total < SNAPSHOT_HEADER ||
+      frames > (total - SNAPSHOT_HEADER) / 4)
+  {
+    return false;
+  }
+  for (size_t i = 0; i < frames; ++i)
+  {
+    const size_t offset = get32(data + SNAPSHOT_HEADER + 4 * i);
+    if (offset % 4 != 0 || offset < SNAPSHOT_HEADER + 4 * frames ||
+        offset > total - FRAME_HEADER || !isFrame(data, total, offset))
+    {
+      ID3D_WARNING( "ID3_TagSnapshot::Open(): bad frame " << i );
+      return false;
+    }
+  }
+  _data = data;
+  _size = total;
+  return true;
+}
+
+/** Returns the ID3TT_* tag types that the file had. */
+flags_t ID3_TagSnapshot::GetFileTags() const
+{
+  return _data ? get32(_data + H_TAGS) : 0;
+}
+
+ID3_V2Spec ID3_TagSnapshot::GetSpec() const
+{
+  return _data ? static_cast<ID3_V2Spec>(get32(_data + H_SPEC)) : ID3V2_LATEST;
+}
+
+size_t ID3_TagSnapshot::GetPrependedBytes() const
+{
+  return _data ? get32(_data + H_PREPENDED) : 0;
+}
+
+size_t ID3_TagSnapshot::GetAppendedBytes() const
+{
+  return _data ? get32(_data + H_APPENDED) : 0;
+}
+
+size_t ID3_TagSnapshot::NumFrames() const
+{
+  return _data ? get32(_data + H_FRAMES) : 0;
+}
+
+/** Returns the first frame with the id from the given one on. */
+size_t ID3_TagSnapshot::FindFrame(ID3_FrameID id, size_t from) const
+{
+  const size_t frames = this->NumFrames();
+  for (size_t i = from; i < frames; ++i)
+  {
+    if (this->GetFrameID(i) == id)
+    {
+      return i;
+    }
+  }
+  return frames;
+}
+
+const uchar* ID3_TagSnapshot::GetFrame(size_t frame) const
+{
+  if (frame >= this->NumFrames())
+  {
+    return NULL;
+  }
+  return _data + get32(_data + SNAPSHOT_HEADER + 4 * frame);
+}
+
+ID3_FrameID ID3_TagSnapshot::GetFrameID(size_t frame) const
+{
+  const uchar* data = this->GetFrame(frame);
+  return data ? static_cast<ID3_FrameID>(get32(data + F_ID)) : ID3FID_NOFRAME;
+}
+
+/** Returns the four (or three) letter id of the frame. */
+const char* ID3_TagSnapshot::GetTextID(size_t frame) const
+{
+  const uchar* data = this->GetFrame(frame);
+  return data ? reinterpret_cast<const char*>(data + F_TEXTID) : "";
+}
+
+/** Returns the ID3_FrameVisitor::FRAME_* flags of the frame. */
+flags_t ID3_TagSnapshot::GetFrameFlags(size_t frame) const
+{
+  const uchar* data = this->GetFrame(frame);
+  return data ? get32(data + F_FLAGS) : 0;
+}
+
+uchar ID3_TagSnapshot::GetEncryptionID(size_t frame) const
+{
+  const uchar* data = this->GetFrame(frame);
+  return data ? data[F_CRYPT] : 0;
+}
+
+uchar ID3_TagSnapshot::GetGroupingID(size_t frame) const
+{
+  const uchar* data = this->GetFrame(frame);
+  return data ? data[F_GROUP] : 0;
+}
+
+size_t ID3_TagSnapshot::NumFields(size_t frame) const
+{
+  const uchar* data = this->GetFrame(frame);
+  return data ? get32(data + F_FIELDS) : 0;
+}
+
+size_t ID3_TagSnapshot::FindField(size_t frame, ID3_FieldID id) const
+{
+  const size_t fields = this->NumFields(frame);
+  for (size_t i = 0; i < fields; ++i)
+  {
+    if (this->GetFieldID(frame, i) == id)
+    {
+      return i;
+    }
+  }
+  return fields;
+}
+
+const uchar* ID3_TagSnapshot::GetField(size_t frame, size_t field) const
+{
+  if (field >= this->NumFields(frame))
+  {
+    return NULL;
+  }
+  const uchar* data = this->GetFrame(frame);
+  return data + get32(data + FRAME_HEADER + 4 * field);
+}
+
+ID3_FieldID ID3_TagSnapshot::GetFieldID(size_t frame, size_t field) const
+{
+  const uchar* data = this->GetField(frame, field);
+  return data ? static_cast<ID3_FieldID>(get32(data + D_ID)) : ID3FN_NOFIELD;
+}
+
+ID3_FieldType ID3_TagSnapshot::GetFieldType(size_t frame, size_t field) const
+{
+  const uchar* data = this->GetField(frame, field);
+  return data ? static_cast<ID3_FieldType>(get32(data + D_TYPE)) : ID3FTY_NONE;
+}
+
+ID3_TextEnc ID3_TagSnapshot::GetEncoding(size_t frame, size_t field) const
+{
+  const uchar* data = this->GetField(frame, field);
+  return data ? static_cast<ID3_TextEnc>(get32(data + D_ENC)) : ID3TE_NONE;
+}
+
+size_t ID3_TagSnapshot::GetNumTextItems(size_t frame, size_t field) const
+{
+  const uchar* data = this->GetField(frame, field);
+  return (data && get32(data + D_TYPE) == ID3FTY_TEXTSTRING) ? get32(data + D_VALUE) : 0;
+}
+
+uint32 ID3_TagSnapshot::GetInteger(size_t frame, size_t field) const
+{
+  const uchar* data = this->GetField(frame, field);
+  return (data && get32(data + D_TYPE) == ID3FTY_INTEGER) ? get32(data + D_VALUE) : 0;
+}
+
+/** Returns the text or binary data of a field, and its size in bytes.  The
+ ** text isn't terminated.
+ **/
+const uchar* ID3_TagSnapshot::GetRawData(size_t frame, size_t field,
+                                         size_t& size) const
+{
+  const uchar* data = this->GetField(frame, field);
+  size = data ? get32(data + D_SIZE) : 0;
+  return data ? data + FIELD_HEADER : NULL;
+}
@@ -0,0 +1,295 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#if defined HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "stats.h"
+#include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
+
+#if defined ID3_ENABLE_STATS
+#  if defined HAVE_CLOCK_GETTIME
+#    include <time.h>
+#  endif
+#  if defined HAVE_PTHREAD_H && defined HAVE_LIBPTHREAD
+#    define ID3_HAVE_STATS_LOCK 1
+#    include <pthread.h>
+#  endif
+#  if defined __GNUC__
+#    define ID3_THREAD_LOCAL __thread
+#  elif defined _MSC_VER
+#    define ID3_THREAD_LOCAL __declspec(thread)
+#  else
+     // the stats of threads that link at once get mixed up
+#    define ID3_THREAD_LOCAL
+#  endif
+#endif
+
+using namespace dami;
+
+namespace
+{
+  const char* const PHASE_NAMES[ID3_TagStats::NUM_PHASES] =
+  {
+    "v2 header",
+    "frame parse",
+    "field decode",
+    "text conversion",
+    "tail tags",
+    "padding skip",
+    "sync search",
+    "mp3 parse",
+    "render",
+    "compression",
+    "unsync",
+    "file rewrite",
+    "rename"
+  };
+
+#if defined ID3_ENABLE_STATS
+  // the operation whose stats the timers of this thread add to, if any
+  ID3_THREAD_LOCAL stats::Scope* current = NULL;
+  // what counters used outside of an operation add to, and nobody reads
+  ID3_IOStats dropped;
+
+  ID3_TagStats total;
+#  if defined ID3_HAVE_STATS_LOCK
+  pthread_mutex_t totalLock = PTHREAD_MUTEX_INITIALIZER;
+#  endif
+
+  void lockTotal()
+  {
+#  if defined ID3_HAVE_STATS_LOCK
+    ::pthread_mutex_lock(&totalLock);
+#  endif
+  }
+
+  void unlockTotal()
+  {
+#  if defined ID3_HAVE_STATS_LOCK
+    ::pthread_mutex_unlock(&totalLock);
+#  endif
+  }
+
+  uint64 now()
+  {
+#  if defined HAVE_CLOCK_GETTIME
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#  else
+    return 0;
+#  endif
+  }
+#endif /* ID3_ENABLE_STATS */
+}
+
+/** \struct ID3_IOStats tag_stats.h id3/tag_stats.h
+ ** \brief What was read and written during a Link() or an Update(), and
+ ** what it took.
+ **
+ ** The calls and bytes are those the parsers and renderers made through an
+ ** io::CountingReader or io::CountingWriter; the syscalls and their bytes
+ ** those the file readers and copiers underneath made of the file.  Set one
+ ** against the other for the I/O amplification of the decorators in
+ ** between.  Files read or written through a stream rather than a file
+ ** descriptor don't count syscalls.
+ **/
+void ID3_IOStats::Clear()
+{
+  bytesRead = 0;
+  bytesWritten = 0;
+  readCharCalls = 0;
+  readCharsCalls = 0;
+  peekCharCalls = 0;
+  writeCharCalls = 0;
+  writeCharsCalls = 0;
+  seeks = 0;
+  getEndCalls = 0;
+  syscalls = 0;
+  syscallBytes = 0;
+}
+
+void ID3_IOStats::Add(const ID3_IOStats& rhs)
+{
+  bytesRead += rhs.bytesRead;
+  bytesWritten += rhs.bytesWritten;
+  readCharCalls += rhs.readCharCalls;
+  readCharsCalls += rhs.readCharsCalls;
+  peekCharCalls += rhs.peekCharCalls;
+  writeCharCalls += rhs.writeCharCalls;
+  writeCharsCalls += rhs.writeCharsCalls;
+  seeks += rhs.seeks;
+  getEndCalls += rhs.getEndCalls;
+  syscalls += rhs.syscalls;
+  syscallBytes += rhs.syscallBytes;
+}
+
+/** \struct ID3_TagStats tag_stats.h id3/tag_stats.h
+ ** \brief How often, and for how long, Link() and Update() went through
+ ** each of their phases.
+ **
+ ** id3lib only keeps these when configured with --enable-stats; otherwise
+ ** the timers aren't compiled in, IsEnabled() is false and the stats stay
+ ** zero.  ID3_Tag::GetStats() returns the stats of one tag, added up over
+ ** all its Link(), Update() and Strip() calls; GetTotal() those of all tags
+ ** of the process.
+ **
+ ** The phases nest: the time of a frame includes that of decoding its
+ ** fields, and that in turn the time of converting their text.  Times are
+ ** in nanoseconds of a monotonic clock.  Next to the phases, calls and io
+ ** hold how many Link()s and Update()s there were, and the I/O they did.
+ **/
+void ID3_TagStats::Clear()
+{
+  for (size_t i = 0; i < NUM_PHASES; ++i)
+  {
+    count[i] = 0;
+    nanos[i] = 0;
+  }
+  for (size_t i = 0; i < NUM_OPERATIONS; ++i)
+  {
+    calls[i] = 0;
+    io[i].Clear();
+  }
+}
+
+void ID3_TagStats::Add(const ID3_TagStats& rhs)
+{
+  for (size_t i = 0; i < NUM_PHASES; ++i)
+  {
+    count[i] += rhs.count[i];
+    nanos[i] += rhs.nanos[i];
+  }
+  for (size_t i = 0; i < NUM_OPERATIONS; ++i)
+  {
+    calls[i] += rhs.calls[i];
+    io[i].Add(rhs.io[i]);
+  }
+}
+
+const char* ID3_TagStats::GetPhaseName(Phase phase)
+{
+  return (phase < NUM_PHASES) ? PHASE_NAMES[phase] : NULL;
+}
+
+bool ID3_TagStats::IsEnabled()
+{
+#if defined ID3_ENABLE_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+/** Returns the stats of all tags of the process so far. */
+ID3_TagStats ID3_TagStats::GetTotal()
+{
+  ID3_TagStats stats;
+#if defined ID3_ENABLE_STATS
+  lockTotal();
+  stats = total;
+  unlockTotal();
+#endif
+  return stats;
+}
+
+void ID3_TagStats::ClearTotal()
+{
+#if defined ID3_ENABLE_STATS
+  lockTotal();
+  total.Clear();
+  unlockTotal();
+#endif
+}
+
+#if defined ID3_ENABLE_STATS
+
+stats::Scope::Scope(ID3_TagStats& stats, ID3_TagStats::Operation op)
+  : _prev(current), _stats(&stats), _op(op)
+{
+  if (_prev && _prev->_stats == _stats)
+  {
+    // Link() within Link(): the outer one counts it
+    return;
+  }
+  _added.calls[op] = 1;
+  current = this;
+}
+
+stats::Scope::~Scope()
+{
+  if (current != this)
+  {
+    return;
+  }
+  current = _prev;
+  _stats->Add(_added);
+  lockTotal();
+  total.Add(_added);
+  unlockTotal();
+}
+
+stats::Timer::Timer(ID3_TagStats::Phase phase)
+  : _stats(current ? &current->_added : NULL), _phase(phase), _start(0)
+{
+  if (_stats)
+  {
+    _start = now();
+  }
+}
+
+stats::Timer::~Timer()
+{
+  if (_stats)
+  {
+    _stats->count[_phase] += 1;
+    _stats->nanos[_phase] += now() - _start;
+  }
+}
+
+ID3_IOStats& stats::io()
+{
+  if (current)
+  {
+    return current->_added.io[current->_op];
+  }
+  return dropped;
+}
+
+void stats::countSyscall(size_t bytes)
+{
+  if (current)
+  {
+    ID3_IOStats& counts = current->_added.io[current->_op];
+    counts.syscalls += 1;
+    counts.syscallBytes += bytes;
+  }
+}
+
+#endif /* ID3_ENABLE_STATS */
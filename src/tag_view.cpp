@@ -0,0 +1,214 @@
+// $Id$
+
+// id3lib: a C++ library for creating and manipulating id3v1/v2 tags
+// Copyright 1999, 2000  Scott Thomas Haug
+// Copyright 2002 Thijmen Klok (thijmen@id3lib.org)
+
+// This library is free software; you can redistribute it and/or modify it
+// under the terms of the GNU Library General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at your
+// option) any later version.
+//
+// This library is distributed in the hope that it will be useful, but WITHOUT
+// ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Library General Public
+// License for more details.
+//
+// You should have received a copy of the GNU Library General Public License
+// along with this library; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+
+// The id3lib authors encourage improvements and optimisations to be sent to
+// the id3lib coordinator.  Please see the README file for details on where to
+// send such submissions.  See the AUTHORS file for a list of people who have
+// contributed to id3lib.  See the ChangeLog file for a list of changes to
+// id3lib.  These files are distributed with id3lib at
+// http://download.sourceforge.net/id3lib/
+
+#if defined HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include "id3/tag_view.h"
+#include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
+#include "io_strings.h"
+
+using namespace dami;
+
+namespace
+{
+  // the snapshot of a tag, in a block of its own
+  uchar* snapshotOf(const ID3_Tag& tag, size_t& size)
+  {
+    BString data;
+    io::BStringWriter writer(data);
+    size = ID3_TagSnapshot::Write(tag, writer);
+    uchar* copy = new uchar[size];
+    ::memcpy(copy, data.data(), size);
+    return copy;
+  }
+}
+
+/** \class ID3_TagView tag_view.h id3/tag_view.h
+ ** \brief A read-only copy of a tag that many threads can read at once.
+ **
+ ** An ID3_Tag can't be shared between threads, not even for reading: Find()
+ ** moves the tag's cursor.  An ID3_TagView is made once from a tag and
+ ** never changes after.  It keeps the tag's ID3_TagSnapshot in a single
+ ** block it owns and reads the frames from there, so a lookup neither
+ ** locks, allocates nor writes anything.
+ **
+ ** Frames are found by number rather than through a cursor: the Find()
+ ** methods return the first match from the given frame on, or NumFrames()
+ ** if there is none.  Fields are read in the encoding they were parsed in;
+ ** GetText() copies only ascii text into a char buffer and only unicode
+ ** text into a unicode_t buffer, as ID3_Field::Get() does.
+ **
+ ** \code
+ **   ID3_TagView view(myTag);
+ **   // from any number of threads
+ **   char title[256];
+ **   size_t frame = view.Find(ID3FID_TITLE);
+ **   view.GetText(frame, ID3FN_TEXT, title, sizeof(title));
+ ** \endcode
+ **/
+ID3_TagView::ID3_TagView(const ID3_Tag& tag)
+  : _data(NULL)
+{
+  size_t size = 0;
+  _data = snapshotOf(tag, size);
+  _snapshot.Open(_data, size);
+}
+
+/** Makes a view of a copy of the snapshot at data. */
+ID3_TagView::ID3_TagView(const uchar* data, size_t size)
+  : _data(NULL)
+{
+  if (data != NULL && size > 0)
+  {
+    _data = new uchar[size];
+    ::memcpy(_data, data, size);
+    _snapshot.Open(_data, size);
+  }
+}
+
+ID3_TagView::~ID3_TagView()
+{
+  delete [] _data;
+}
+
+size_t ID3_TagView::Find(ID3_FrameID id, size_t from) const
+{
+  return _snapshot.FindFrame(id, from);
+}
+
+/** Returns the first frame whose integer field has the given value. */
+size_t ID3_TagView::Find(ID3_FrameID id, ID3_FieldID fld, uint32 data,
+                         size_t from) const
+{
+  const size_t frames = this->NumFrames();
+  for (size_t i = this->Find(id, from); i < frames; i = this->Find(id, i + 1))
+  {
+    const size_t field = _snapshot.FindField(i, fld);
+    if (_snapshot.GetFieldType(i, field) == ID3FTY_INTEGER &&
+        _snapshot.GetInteger(i, field) == data)
+    {
+      return i;
+    }
+  }
+  return frames;
+}
+
+/** Returns the first frame whose text field is the given string. */
+size_t ID3_TagView::Find(ID3_FrameID id, ID3_FieldID fld, const char* data,
+                         size_t from) const
+{
+  const size_t frames = this->NumFrames();
+  const size_t length = (data == NULL) ? 0 : ::strlen(data);
+  for (size_t i = this->Find(id, from); i < frames; i = this->Find(id, i + 1))
+  {
+    const size_t field = _snapshot.FindField(i, fld);
+    size_t size = 0;
+    const uchar* text = _snapshot.GetRawData(i, field, size);
+    if (_snapshot.GetFieldType(i, field) == ID3FTY_TEXTSTRING &&
+        size == length && (length == 0 || ::memcmp(text, data, length) == 0))
+    {
+      return i;
+    }
+  }
+  return frames;
+}
+
+bool ID3_TagView::Contains(size_t frame, ID3_FieldID fld) const
+{
+  return _snapshot.FindField(frame, fld) < _snapshot.NumFields(frame);
+}
+
+uint32 ID3_TagView::GetInteger(size_t frame, ID3_FieldID fld) const
+{
+  return _snapshot.GetInteger(frame, _snapshot.FindField(frame, fld));
+}
+
+/** Copies at most maxLength characters of an ascii text field, and a
+ ** terminating null if there's room.  Returns the number of characters.
+ **/
+size_t ID3_TagView::GetText(size_t frame, ID3_FieldID fld, char* buffer,
+                            size_t maxLength) const
+{
+  const size_t field = _snapshot.FindField(frame, fld);
+  size_t size = 0;
+  const uchar* text = _snapshot.GetRawData(frame, field, size);
+  if (_snapshot.GetFieldType(frame, field) != ID3FTY_TEXTSTRING ||
+      _snapshot.GetEncoding(frame, field) != ID3TE_ASCII ||
+      buffer == NULL || maxLength == 0)
+  {
+    return 0;
+  }
+  size = min(maxLength, size);
+  ::memcpy(buffer, text, size);
+  if (size < maxLength)
+  {
+    buffer[size] = '\0';
+  }
+  return size;
+}
+
+/** Copies at most maxLength characters of a unicode text field, and a
+ ** terminating null if there's room.  Returns the number of characters.
+ **/
+size_t ID3_TagView::GetText(size_t frame, ID3_FieldID fld, unicode_t* buffer,
+                            size_t maxLength) const
+{
+  const size_t field = _snapshot.FindField(frame, fld);
+  size_t size = 0;
+  const uchar* text = _snapshot.GetRawData(frame, field, size);
+  if (_snapshot.GetFieldType(frame, field) != ID3FTY_TEXTSTRING ||
+      _snapshot.GetEncoding(frame, field) != ID3TE_UNICODE ||
+      buffer == NULL || maxLength == 0)
+  {
+    return 0;
+  }
+  const size_t length = min(maxLength, size / sizeof(unicode_t));
+  ::memcpy(buffer, text, length * sizeof(unicode_t));
+  if (length < maxLength)
+  {
+    buffer[length] = NULL_UNICODE;
+  }
+  return length;
+}
+
+/** Returns the data of a binary field, and its size; NULL if the frame has
+ ** no such field.
+ **/
+const uchar* ID3_TagView::GetBinary(size_t frame, ID3_FieldID fld,
+                                    size_t& size) const
+{
+  const size_t field = _snapshot.FindField(frame, fld);
+  if (_snapshot.GetFieldType(frame, field) != ID3FTY_BINARY)
+  {
+    size = 0;
+    return NULL;
+  }
+  return _snapshot.GetRawData(frame, field, size);
+}
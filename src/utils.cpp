@@ -36,6 +36,7 @@
 #endif
 
 #include "id3/utils.h" // has <config.h> "id3/id3lib_streams.h" "id3/globals.h" "id3/id3lib_strings.h"
+#include "stats.h"
 
 #if defined HAVE_ICONV_H
 // check if we have all unicodes
@@ -125,9 +126,11 @@ namespace
 #if defined(ID3LIB_ICONV_CONSTSOURCE)
     const char* source_str = source.data();
 #else
-    char *source_str = new char[source.size()+1];
-    source.copy(source_str, String::npos);
-    source_str[source.length()] = 0;
+    // iconv() moves source_str along, so keep the start to delete
+    char *source_buf = new char[source.size()+1];
+    source.copy(source_buf, String::npos);
+    source_buf[source.length()] = 0;
+    char *source_str = source_buf;
 #endif
 
 #define ID3LIB_BUFSIZ 1024
@@ -145,7 +148,7 @@ namespace
       {
 // errno is probably EILSEQ here, which means either an invalid byte sequence or a valid but unconvertible byte sequence 
 #if !defined(ID3LIB_ICONV_CONSTSOURCE)
-        delete [] source_str;
+        delete [] source_buf;
 #endif
         return target;
       }
@@ -155,7 +158,7 @@ namespace
     }
     while (source_size > 0);
 #if !defined(ID3LIB_ICONV_CONSTSOURCE)
-    delete [] source_str;
+    delete [] source_buf;
 #endif
     return target;
   }
@@ -191,6 +194,7 @@ namespace
 
 String dami::convert(String data, ID3_TextEnc sourceEnc, ID3_TextEnc targetEnc)
 {
+  ID3_STATS_TIMER(TEXT_CONVERT);
   String target;
   if ((sourceEnc != targetEnc) && (data.size() > 0 ))
   {